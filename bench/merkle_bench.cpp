@@ -0,0 +1,110 @@
+/**
+ * @file   merkle_bench.cpp
+ * @author JoaoAJMatos
+ *
+ * @brief Merkle root construction benchmark
+ *
+ * @details Times the Merkle root of 1k to 100k leaves built by the calling thread
+ *          and on thread pools of 2, 4 and 8 threads. Every run starts from a fresh
+ *          copy of the leaves, since the tree is reduced in place.
+ *
+ * @version 0.1
+ * @date 2023-11-07
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+/* C++ includes */
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Skynet includes */
+#include <merkle_tree.hpp>
+#include <crypto/sha256.hpp>
+#include <threading/threadpool.hpp>
+
+/** Leaf counts to benchmark */
+static const std::size_t LEAF_COUNTS[] = { 1000, 6000, 10000, 50000, 100000 };
+/** Thread counts to benchmark, 1 builds on the calling thread */
+static const std::size_t THREAD_COUNTS[] = { 1, 2, 4, 8 };
+/** Repetitions per measurement, the best one is reported */
+static const int RUNS = 20;
+
+/**
+ * @brief Returns the best time, in microseconds, to build the root of `leaves`.
+ */
+static double time_root(const std::vector<byte> &leaves, std::size_t count, const threading::ThreadPool *pool) {
+      skynet::MerkleTree tree(count);
+      double best = 0;
+
+      for (int run = 0; run < RUNS; ++run) {
+            memcpy(tree.Leaf(0), leaves.data(), leaves.size());
+
+            auto start = std::chrono::steady_clock::now();
+            if (pool) tree.Build(*pool);
+            else tree.Build();
+            auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            if (run == 0 || elapsed < best) best = elapsed;
+      }
+
+      return best;
+}
+
+int main() {
+      std::printf("SHA-256 backend: %s\n\n", crypto::hashing::BackendToString(crypto::hashing::GetBackend()).c_str());
+      std::printf("%10s", "leaves");
+      for (std::size_t threads : THREAD_COUNTS) {
+            std::printf("%12s", (std::to_string(threads) + (threads == 1 ? " thread" : " threads")).c_str());
+      }
+      std::printf("\n");
+
+      std::vector<std::unique_ptr<threading::ThreadPool>> pools;
+      for (std::size_t threads : THREAD_COUNTS) {
+            std::unique_ptr<threading::ThreadPool> pool;
+            if (threads > 1) {
+                  pool = std::make_unique<threading::ThreadPool>(threads);
+                  pool->Init();
+            }
+            pools.push_back(std::move(pool));
+      }
+
+      for (std::size_t count : LEAF_COUNTS) {
+            std::vector<byte> leaves(count * skynet::MERKLE_NODE_SIZE);
+            for (std::size_t i = 0; i < leaves.size(); ++i) leaves[i] = static_cast<byte>(i * 131 + 7);
+
+            std::printf("%10zu", count);
+            for (const auto &pool : pools) {
+                  std::printf("%10.0fus", time_root(leaves, count, pool.get()));
+            }
+            std::printf("\n");
+      }
+
+      return 0;
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -6,8 +6,11 @@
 #include "base_miner.hpp"
 
 /** Skynet Includes */
+#include <macros.hpp>
 #include <time.hpp>
+#include <consensus.hpp>
 #include <transaction.hpp>
+#include <crypto/sha256.hpp>
 
 /**
  * @brief Returns the list of transactions selected for being added to a block.
@@ -33,6 +36,42 @@ static std::vector<skynet::Transaction> select_transactions(skynet::MemPool &mem
       return selected_transactions;
 }
 
+/**
+ * @brief Searches for a nonce that makes the header meet its difficulty target.
+ *
+ * @details The nonce is the last field of the serialized header, so everything before
+ *          it is compressed once into a midstate and each attempt only hashes the final
+ *          block. When every nonce has been tried, the timestamp is bumped and the
+ *          midstate rebuilt.
+ *
+ * @param header The header to mine, its nonce (and maybe timestamp) is updated in place
+ */
+static void find_nonce(skynet::BlockHeader &header) {
+      byte serialized[skynet::BlockHeader::SERIALIZED_SIZE];
+      Hash256 hash;
+
+      loop() {
+            header.Serialize(serialized);
+            crypto::hashing::SHA256Midstate midstate(serialized, sizeof(serialized), sizeof(header.nonce));
+
+            for (uint64_t nonce = 0; nonce <= UINT32_MAX; ++nonce) {
+                  const byte *tail = serialized + skynet::BlockHeader::NONCE_OFFSET;
+                  serialized[skynet::BlockHeader::NONCE_OFFSET] = static_cast<byte>(nonce);
+                  serialized[skynet::BlockHeader::NONCE_OFFSET + 1] = static_cast<byte>(nonce >> 8);
+                  serialized[skynet::BlockHeader::NONCE_OFFSET + 2] = static_cast<byte>(nonce >> 16);
+                  serialized[skynet::BlockHeader::NONCE_OFFSET + 3] = static_cast<byte>(nonce >> 24);
+
+                  midstate.DoubleHash(tail, hash.data());
+                  if (skynet::MeetsDifficultyTarget(hash, header.difficultyTarget)) {
+                        header.nonce = static_cast<uint32_t>(nonce);
+                        return;
+                  }
+            }
+
+            header.timestamp++;
+      }
+}
+
 /**
  * @brief Mines a block.
  */
@@ -48,15 +87,26 @@ void skynet::Miner::Mine() {
       /** Add the coinbase transaction */
       block.AddCoinbaseTransaction(this->destinationAddress);
 
-      /** Mine the block */
-      //block.Mine();
+      /** Mine the block on top of the current tip */
+      const Block& tip = chain->GetLastBlock();
+      const auto now = util::time::timestamp();
+      BlockHeader header(
+            consensus::BLOCK_VERSION,
+            tip.Hash(),
+            CalculateMerkleRoot(block.GetTransactions()),
+            static_cast<uint32_t>(now),
+            static_cast<uint32_t>(consensus::AdjustDifficulty(tip.GetHeader().difficultyTarget, tip.GetHeader().timestamp, now)),
+            0
+      );
+      find_nonce(header);
+      block.SetHeader(header);
 
       /** Broadcast the block */
       callback(block);
 
       /** Remove the transactions from the mempool */
       for (auto &transaction : selected_transactions) {
-            mempool->RemoveTransaction(transaction.Hash().get());
+            mempool->RemoveTransaction(transaction.Hash());
       }
 }
 
@@ -50,11 +50,11 @@ namespace skynet
 
             /**
              * @brief Mines a block
-             * @details This function should be implemented by the user.
-             *          It should create a block, add transactions to it, mine it and
-             *          call the callback function with the mined block.
+             * @details Creates a block, adds transactions to it, mines it and
+             *          calls the callback function with the mined block.
+             *          Miners for other hardware override it.
              */
-            void Mine() = 0;
+            virtual void Mine();
       private:
             std::shared_ptr<MemPool> mempool;         /** Mempool */
             std::shared_ptr<Chain> chain;             /** Blockchain */
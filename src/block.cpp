@@ -2,6 +2,11 @@
 // Created by JoaoAJMatos on 29/10/2023.
 //
 
+/** C++ Includes */
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
 /** Skynet Includes */
 #include <time.hpp>
 #include <consensus.hpp>
@@ -12,23 +17,97 @@
 #include "block.hpp"
 
 
+/**
+ * @brief Writes the canonical serialization of the header
+ *
+ * @param out The 80 byte buffer
+ */
+void skynet::BlockHeader::Serialize(byte *out) const {
+      serialize::WriteLE32(out, this->version);
+      memcpy(out + 4, this->prevHash.data(), this->prevHash.size());
+      memcpy(out + 36, this->merkleRoot.data(), this->merkleRoot.size());
+      serialize::WriteLE32(out + 68, this->timestamp);
+      serialize::WriteLE32(out + 72, this->difficultyTarget);
+      serialize::WriteLE32(out + NONCE_OFFSET, this->nonce);
+}
+
+/**
+ * @brief Reads a header from its canonical serialization
+ *
+ * @param in The 80 byte buffer
+ * @return BlockHeader The header
+ */
+skynet::BlockHeader skynet::BlockHeader::Deserialize(const byte *in) {
+      BlockHeader header;
+      header.version = serialize::ReadLE32(in);
+      memcpy(header.prevHash.data(), in + 4, header.prevHash.size());
+      memcpy(header.merkleRoot.data(), in + 36, header.merkleRoot.size());
+      header.timestamp = serialize::ReadLE32(in + 68);
+      header.difficultyTarget = serialize::ReadLE32(in + 72);
+      header.nonce = serialize::ReadLE32(in + NONCE_OFFSET);
+      return header;
+}
+
+/**
+ * @brief Returns the double SHA-256 of the canonical serialization
+ *
+ * @return Hash256 The hash of the header
+ */
+Hash256 skynet::BlockHeader::Hash() const {
+      byte serialized[SERIALIZED_SIZE];
+      Serialize(serialized);
+
+      Hash256 hash;
+      crypto::hashing::DoubleSHA256(serialized, SERIALIZED_SIZE, hash.data());
+      return hash;
+}
+
+bool skynet::BlockHeader::operator==(const BlockHeader &header) const {
+      return version == header.version && prevHash == header.prevHash && merkleRoot == header.merkleRoot &&
+             timestamp == header.timestamp && difficultyTarget == header.difficultyTarget && nonce == header.nonce;
+}
+
+/**
+ * @brief Checks a hash against a difficulty target
+ *
+ * @param hash The block hash
+ * @param difficultyTarget The required number of leading zero bits
+ * @return true If the hash has enough leading zero bits
+ */
+bool skynet::MeetsDifficultyTarget(const Hash256 &hash, uint32_t difficultyTarget) {
+      if (difficultyTarget > hash.size() * 8) return false;
+
+      const std::size_t zero_bytes = difficultyTarget / 8;
+      for (std::size_t i = 0; i < zero_bytes; ++i) {
+            if (hash[i] != 0) return false;
+      }
+
+      const uint32_t remaining_bits = difficultyTarget % 8;
+      return remaining_bits == 0 || (hash[zero_bytes] >> (8 - remaining_bits)) == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+skynet::Block::Block() : transactionCount(0) {}
+
+skynet::Block::Block(BlockHeader header, std::vector<Transaction> transactions)
+      : header(header), transactions(std::move(transactions)) {
+      this->transactionCount = static_cast<int>(this->transactions.size());
+}
+
 /** 
 * @brief Returns the hash of the block
 *
-* @return std::unique_ptr<byte[]> The hash of the block 
+* @details Only the header is hashed, the Merkle root in it commits to the transactions.
+*
+* @return const Hash256& The cached hash of the block 
 */
-std::unique_ptr<byte[]> skynet::Block::Hash() const {
-      auto hash = std::make_unique<byte[]>(crypto::hashing::SHA256_HASH_SIZE);
-      auto data = std::make_unique<byte[]>(sizeof(BlockHeader) + this->transactionCount * sizeof(Transaction));
-
-      /** Combine all the block's data into a single byte array */
-      memcpy(data.get(), &this->header, sizeof(BlockHeader));
-      memcpy(data.get() + sizeof(BlockHeader), this->transactions.data(), this->transactionCount * sizeof(Transaction));
-
-      /** Hash the contents of the block */
-      crypto::hashing::SHA256(data.get(), sizeof(BlockHeader) + this->transactionCount * sizeof(Transaction), hash.get());
+const Hash256& skynet::Block::Hash() const {
+      if (!hashCached) {
+            hash = this->header.Hash();
+            hashCached = true;
+      }
 
-      /** Return the hash */
       return hash;
 }
 
@@ -47,6 +126,51 @@ void skynet::Block::AddTransaction(Transaction transaction) {
       this->transactionCount++;
 }
 
+/**
+ * @brief Checks everything but the Merkle root: the transaction count, the proof of work
+ *        and that no transaction appears twice (which would let a different block share
+ *        the Merkle root)
+ *
+ * @details Every TXID is computed here, the Merkle root then reuses the cached hashes.
+ *
+ * @param block
+ * @return true If the block passes the checks
+ */
+static bool has_valid_layout(const skynet::Block& block) {
+      const auto& transactions = block.GetTransactions();
+      if (block.GetTransactionCount() != static_cast<int>(transactions.size())) return false;
+      if (transactions.size() > static_cast<std::size_t>(skynet::MAX_TRANSACTIONS_PER_BLOCK)) return false;
+      if (!skynet::MeetsDifficultyTarget(block.Hash(), block.GetHeader().difficultyTarget)) return false;
+
+      std::vector<skynet::TransactionHash> txids;
+      txids.reserve(transactions.size());
+      for (const auto& transaction : transactions) txids.push_back(transaction.Hash());
+      std::sort(txids.begin(), txids.end());
+      return std::adjacent_find(txids.begin(), txids.end()) == txids.end();
+}
+
+/**
+ * @brief Checks the transaction count, the proof of work, duplicate transactions and the
+ *        Merkle root of the block
+ *
+ * @return true If the block is well formed and its hash meets its difficulty target
+ */
+bool skynet::Block::HasValidContent() const {
+      if (!has_valid_layout(*this)) return false;
+      return CalculateMerkleRoot(this->transactions) == this->header.merkleRoot;
+}
+
+/**
+ * @brief Checks the block like HasValidContent(), hashing the Merkle tree on a thread pool
+ *
+ * @param pool The thread pool to run on
+ * @return true If the block is well formed and its hash meets its difficulty target
+ */
+bool skynet::Block::HasValidContent(const threading::ThreadPool& pool) const {
+      if (!has_valid_layout(*this)) return false;
+      return CalculateMerkleRoot(this->transactions, pool) == this->header.merkleRoot;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 inline std::unique_ptr<skynet::Block> skynet::Block::GenesisBlock() {
@@ -54,12 +178,12 @@ inline std::unique_ptr<skynet::Block> skynet::Block::GenesisBlock() {
 
       auto block = std::make_unique<Block>(
             BlockHeader(
-                  consensus::VERSION,                                               // Version
-                  std::make_unique<byte[]>(crypto::hashing::SHA256_HASH_SIZE),      // Previous hash
+                  consensus::BLOCK_VERSION,                                         // Version
+                  Hash256{},                                                        // Previous hash
                   CalculateMerkleRoot(transactions),                                // Merkle root
-                  util::time::timestamp(),                                          // Timestamp
+                  static_cast<uint32_t>(util::time::timestamp()),                   // Timestamp
                   consensus::INITIAL_DIFFICULTY,                                    // Difficulty target
-                  crypto::random::randint(0, INT32_MAX)                             // Nonce
+                  static_cast<uint32_t>(crypto::random::randint(0, INT32_MAX))      // Nonce
             ), 
             transactions
       );
@@ -69,22 +193,48 @@ inline std::unique_ptr<skynet::Block> skynet::Block::GenesisBlock() {
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief Lays the transaction hashes out back to back as the leaves of a tree
+ */
+static void fill_leaves(skynet::MerkleTree& tree, const std::vector<skynet::Transaction>& transactions) {
+      for (std::size_t i = 0; i < transactions.size(); ++i) {
+            memcpy(tree.Leaf(i), transactions[i].Hash().data(), skynet::MERKLE_NODE_SIZE);
+      }
+}
+
 /**
  * @brief Returns the merkle root of a vector of transactions
  * 
  * @param transactions The vector of transactions
- * @return std::unique_ptr<byte[]> The merkle root of the vector of transactions
+ * @return Hash256 The merkle root of the vector of transactions
  */
-std::unique_ptr<byte[]> skynet::CalculateMerkleRoot(std::vector<Transaction> transactions) {
-      if (transactions.size() == 0) {
-            return std::make_unique<byte[]>(crypto::hashing::SHA256_HASH_SIZE);
-      }
+Hash256 skynet::CalculateMerkleRoot(const std::vector<Transaction>& transactions) {
+      Hash256 root;
 
-      MerkleTree tree;
-      for (auto& transaction : transactions) {
-            tree.AddLeaf(transaction.Hash());
-      }
-      return tree.Root();
+      MerkleTree tree(transactions.size());
+      fill_leaves(tree, transactions);
+      tree.Build();
+
+      memcpy(root.data(), tree.Root(), MERKLE_NODE_SIZE);
+      return root;
+}
+
+/**
+ * @brief Returns the merkle root of a vector of transactions, hashing large trees on a thread pool
+ * 
+ * @param transactions The vector of transactions
+ * @param pool The thread pool to run on
+ * @return Hash256 The merkle root of the vector of transactions
+ */
+Hash256 skynet::CalculateMerkleRoot(const std::vector<Transaction>& transactions, const threading::ThreadPool& pool) {
+      Hash256 root;
+
+      MerkleTree tree(transactions.size());
+      fill_leaves(tree, transactions);
+      tree.Build(pool);
+
+      memcpy(root.data(), tree.Root(), MERKLE_NODE_SIZE);
+      return root;
 }
 
 // MIT License
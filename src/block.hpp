@@ -18,63 +18,87 @@
 #define SKYNET_BLOCK_HPP
 
 /** C++ Includes */
-#include <vector>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 /** Skynet Includes */
 #include <types.hpp>
+#include <serialize.hpp>
 #include <transaction.hpp>
 #include <consensus.hpp>
 
+namespace threading { class ThreadPool; }
+
 namespace skynet
 {
       /** Constants */
       constexpr int MAX_TRANSACTIONS_PER_BLOCK = 1000;
 
+      /**
+       * @brief The block header, the part of a block that gets hashed and mined.
+       *
+       * @details Trivially copyable with the hashes inline, so copies never allocate.
+       *          Its canonical form is SERIALIZED_SIZE bytes, fields in declaration order,
+       *          integers little endian, with the nonce last so the miner can cache the
+       *          hash state of everything before it.
+       */
       struct BlockHeader {
-            float version;                         /** Version of the blockchain when the block was created */
-            std::unique_ptr<byte[]> prevHash;      /** Hash of the previous block */
-            std::unique_ptr<byte[]> merkleRoot;    /** Merkle root of the block */
-            std::time_t timestamp;                 /** Timestamp of the block */
-            int difficultyTarget;                  /** Difficulty target of the block */
-            int nonce;                             /** Nonce of the block */
+            uint32_t version;                      /** Version of the block format (consensus::BLOCK_VERSION) */
+            Hash256 prevHash;                      /** Hash of the previous block */
+            Hash256 merkleRoot;                    /** Merkle root of the block */
+            uint32_t timestamp;                    /** Timestamp of the block (seconds since the epoch) */
+            uint32_t difficultyTarget;             /** Difficulty target of the block (leading zero bits) */
+            uint32_t nonce;                        /** Nonce of the block */
+
+            /** Size of the canonical serialization */
+            static constexpr std::size_t SERIALIZED_SIZE = 80;
+            /** Offset of the nonce in the canonical serialization */
+            static constexpr std::size_t NONCE_OFFSET = 76;
 
             /** Constructors */
             BlockHeader() = default;
 
-            BlockHeader(float version, std::unique_ptr<byte[]> prevHash, std::unique_ptr<byte[]> merkleRoot, std::time_t timestamp, int difficultyTarget, int nonce) {
-                  this->version = version;
-                  this->prevHash = std::move(prevHash);
-                  this->merkleRoot = std::move(merkleRoot);
-                  this->timestamp = timestamp;
-                  this->difficultyTarget = difficultyTarget;
-                  this->nonce = nonce;
-            }
+            BlockHeader(uint32_t version, const Hash256 &prevHash, const Hash256 &merkleRoot, uint32_t timestamp, uint32_t difficultyTarget, uint32_t nonce)
+                  : version(version), prevHash(prevHash), merkleRoot(merkleRoot), timestamp(timestamp), difficultyTarget(difficultyTarget), nonce(nonce) {}
 
-            BlockHeader(const BlockHeader &header) {
-                  version = header.version;
-                  prevHash = std::make_unique<byte[]>(crypto::hashing::SHA256_HASH_SIZE);
-                  std::copy(header.prevHash.get(), header.prevHash.get() + crypto::hashing::SHA256_HASH_SIZE, prevHash.get());
-                  merkleRoot = std::make_unique<byte[]>(crypto::hashing::SHA256_HASH_SIZE);
-                  std::copy(header.merkleRoot.get(), header.merkleRoot.get() + crypto::hashing::SHA256_HASH_SIZE, merkleRoot.get());
-                  timestamp = header.timestamp;
-                  difficultyTarget = header.difficultyTarget;
-                  nonce = header.nonce;
-            }
+            /**
+             * @brief Writes the canonical serialization of the header
+             * 
+             * @param out SERIALIZED_SIZE bytes
+             */
+            void Serialize(byte *out) const;
 
-            BlockHeader &operator=(const BlockHeader &header) {
-                  version = header.version;
-                  prevHash = std::make_unique<byte[]>(crypto::hashing::SHA256_HASH_SIZE);
-                  std::copy(header.prevHash.get(), header.prevHash.get() + crypto::hashing::SHA256_HASH_SIZE, prevHash.get());
-                  merkleRoot = std::make_unique<byte[]>(crypto::hashing::SHA256_HASH_SIZE);
-                  std::copy(header.merkleRoot.get(), header.merkleRoot.get() + crypto::hashing::SHA256_HASH_SIZE, merkleRoot.get());
-                  timestamp = header.timestamp;
-                  difficultyTarget = header.difficultyTarget;
-                  nonce = header.nonce;
-                  return *this;
-            }
+            /**
+             * @brief Reads a header from its canonical serialization
+             * 
+             * @param in SERIALIZED_SIZE bytes
+             * @return BlockHeader The header
+             */
+            static BlockHeader Deserialize(const byte *in);
+
+            /**
+             * @brief Returns the double SHA-256 of the canonical serialization
+             */
+            Hash256 Hash() const;
+
+            bool operator==(const BlockHeader &header) const;
+            bool operator!=(const BlockHeader &header) const { return !(*this == header); }
       };
 
+      static_assert(std::is_trivially_copyable<BlockHeader>::value, "BlockHeader must be trivially copyable");
+
+      /**
+       * @brief Checks a hash against a difficulty target
+       * 
+       * @param hash The block hash
+       * @param difficultyTarget The required number of leading zero bits
+       * @return true If the hash has at least difficultyTarget leading zero bits
+       */
+      bool MeetsDifficultyTarget(const Hash256 &hash, uint32_t difficultyTarget);
+
       class Block
       {
       public:
@@ -83,11 +107,15 @@ namespace skynet
             ~Block() = default;
 
             /** 
-             * @brief Returns the hash of the block
+             * @brief Returns the hash of the block, the hash of its header
+             * @details The transactions are committed to through the Merkle root, so the
+             *          hash is computed once from the header and cached with the block.
+             *          Call it once before sharing the block across threads, the first
+             *          call fills the cache.
              *
-             * @return std::unique_ptr<byte[]> The hash of the block 
+             * @return const Hash256& The cached hash of the block 
              */
-            std::unique_ptr<byte[]> Hash() const;
+            const Hash256& Hash() const;
 
             /** 
              * @brief Adds a transaction to the Block
@@ -105,6 +133,24 @@ namespace skynet
              */
             void AddCoinbaseTransaction(std::string minerAddress);
 
+            /**
+             * @brief Checks the parts of the block that don't depend on the chain: the
+             *        transaction count, the proof of work, duplicate transactions and the
+             *        Merkle root, cheapest first
+             *
+             * @return true If the block is well formed and meets its difficulty target
+             */
+            bool HasValidContent() const;
+
+            /**
+             * @brief Checks the parts of the block that don't depend on the chain, building
+             *        the Merkle tree of large blocks on a thread pool
+             *
+             * @param pool The thread pool to run on
+             * @return true If the block is well formed and meets its difficulty target
+             */
+            bool HasValidContent(const threading::ThreadPool& pool) const;
+
             /** 
              * @brief Returns the formatted string representation of a block 
              * 
@@ -112,6 +158,9 @@ namespace skynet
              */
             std::string ToString() const;
 
+            bool operator==(const Block &block) const { return Hash() == block.Hash(); }
+            bool operator!=(const Block &block) const { return !(*this == block); }
+
             /**
             * @brief Returns the Genesis block of the Blockchain
             * 
@@ -120,31 +169,87 @@ namespace skynet
             static std::unique_ptr<Block> GenesisBlock();
 
             /** Getters */
-            BlockHeader GetHeader() const { return header; }
-            std::vector<Transaction> GetTransactions() const { return transactions; }
+            const BlockHeader& GetHeader() const { return header; }
+            const std::vector<Transaction>& GetTransactions() const { return transactions; }
             int GetTransactionCount() const { return transactionCount; }
 
             /** Setters */
-            void SetHeader(BlockHeader header) { this->header = header; }
+            void SetHeader(const BlockHeader& header) { this->header = header; hashCached = false; }
             void SetTransactions(std::vector<Transaction> transactions) { this->transactions = transactions; }
 
       private:
             BlockHeader header;                       /** The block header */
             std::vector<Transaction> transactions;    /** Transactions in the block */
             int transactionCount;                     /** Number of transactions in the block */
+            mutable Hash256 hash;                     /** Cached hash of the header */
+            mutable bool hashCached = false;          /** Whether hash holds the hash of the current header */
+
+            friend struct serialize::Serializer<Block>;
       };
 
       /**
        * @brief Calculates the Merkle Root of a vector of transactions
        * 
        * @param transactions The vector of transactions
-       * @return std::unique_ptr<byte[]> The Merkle Root of the vector of transactions
-       * @throws std::runtime_error If the vector of transactions is empty
+       * @return Hash256 The Merkle Root of the vector of transactions (all zeros if it is empty)
+       */
+      Hash256 CalculateMerkleRoot(const std::vector<Transaction>& transactions);
+
+      /**
+       * @brief Calculates the Merkle Root of a vector of transactions, hashing
+       *        large trees on a thread pool
+       * 
+       * @param transactions The vector of transactions
+       * @param pool The (initialized) thread pool to run on
+       * @return Hash256 The Merkle Root of the vector of transactions (all zeros if it is empty)
        */
-      std::unique_ptr<byte[]> CalculateMerkleRoot(std::vector<Transaction> transactions);
+      Hash256 CalculateMerkleRoot(const std::vector<Transaction>& transactions, const threading::ThreadPool& pool);
 
 } // namespace skynet
 
+/**
+ * @brief Block serialization: the canonical 80 byte header, then the
+ *        transactions as a CompactSize count followed by each transaction
+ */
+template<>
+struct serialize::Serializer<skynet::BlockHeader> {
+      template<typename Stream>
+      static void Write(Stream& stream, const skynet::BlockHeader& header) {
+            byte serialized[skynet::BlockHeader::SERIALIZED_SIZE];
+            header.Serialize(serialized);
+            stream.Write(serialized, sizeof(serialized));
+      }
+
+      static void Read(ReadBuffer& reader, skynet::BlockHeader& header) {
+            header = skynet::BlockHeader::Deserialize(reader.View(skynet::BlockHeader::SERIALIZED_SIZE));
+      }
+};
+
+template<>
+struct serialize::Serializer<skynet::Block> {
+      template<typename Stream>
+      static void Write(Stream& stream, const skynet::Block& block) {
+            Serialize(stream, block.header);
+            Serialize(stream, block.transactions);
+      }
+
+      /** @throws SerializationError If the block holds more than MAX_TRANSACTIONS_PER_BLOCK transactions */
+      static void Read(ReadBuffer& reader, skynet::Block& block) {
+            Unserialize(reader, block.header);
+
+            const auto count = static_cast<std::size_t>(ReadCompactSize(reader, skynet::MAX_TRANSACTIONS_PER_BLOCK));
+            block.transactions.clear();
+            block.transactions.reserve(count);
+            for (std::size_t i = 0; i < count; i++) {
+                  block.transactions.emplace_back();
+                  Unserialize(reader, block.transactions.back());
+            }
+
+            block.transactionCount = static_cast<int>(block.transactions.size());
+            block.hashCached = false;
+      }
+};
+
 #endif // SKYNET_BLOCK_HPP
 
 // MIT License
@@ -0,0 +1,142 @@
+//
+// Created by JoaoAJMatos on 16/11/2023.
+//
+
+/** C++ Includes */
+#include <algorithm>
+
+/** Local Includes */
+#include "block_index.hpp"
+
+
+/** The table grows once it is half full */
+static constexpr std::size_t MAX_LOAD_FACTOR_INVERSE = 2;
+
+/**
+ * @brief Returns the smallest power of two not below n
+ */
+static std::size_t round_up_to_power_of_two(std::size_t n) {
+      std::size_t power = 1;
+      while (power < n) power <<= 1;
+      return power;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+skynet::ChainWork skynet::ChainWork::ForTarget(uint32_t difficultyTarget) {
+      const uint32_t bit = std::min<uint32_t>(difficultyTarget, 255);
+
+      ChainWork work;
+      work.limbs[bit / 64] = uint64_t(1) << (bit % 64);
+      return work;
+}
+
+skynet::ChainWork& skynet::ChainWork::operator+=(const ChainWork& work) {
+      uint64_t carry = 0;
+      for (std::size_t i = 0; i < limbs.size(); i++) {
+            const uint64_t sum = limbs[i] + work.limbs[i];
+            const uint64_t next_carry = (sum < limbs[i]) || (sum == UINT64_MAX && carry);
+            limbs[i] = sum + carry;
+            carry = next_carry;
+      }
+      return *this;
+}
+
+bool skynet::ChainWork::operator<(const ChainWork& work) const {
+      for (std::size_t i = limbs.size(); i-- > 0; ) {
+            if (limbs[i] != work.limbs[i]) return limbs[i] < work.limbs[i];
+      }
+      return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+skynet::BlockIndex::BlockIndex(std::size_t capacity)
+      : slots(round_up_to_power_of_two(capacity * MAX_LOAD_FACTOR_INVERSE)) {}
+
+/**
+ * @brief Returns the slot holding the given block, or the empty slot it would go in
+ *
+ * @param hash The hash of the block
+ * @param key The table key of the hash
+ */
+std::size_t skynet::BlockIndex::Probe(const Hash256& hash, uint64_t key) const {
+      const std::size_t mask = slots.size() - 1;
+      std::size_t i = static_cast<std::size_t>(key) & mask;
+
+      while (slots[i].node != nullptr) {
+            if (slots[i].key == key && slots[i].node->hash == hash) break;
+            i = (i + 1) & mask;
+      }
+      return i;
+}
+
+/**
+ * @brief Doubles the table, reinserting every node
+ */
+void skynet::BlockIndex::Grow() {
+      std::vector<Slot> old(slots.size() * 2);
+      old.swap(slots);
+
+      const std::size_t mask = slots.size() - 1;
+      for (const Slot& slot : old) {
+            if (slot.node == nullptr) continue;
+
+            std::size_t i = static_cast<std::size_t>(slot.key) & mask;
+            while (slots[i].node != nullptr) i = (i + 1) & mask;
+            slots[i] = slot;
+      }
+}
+
+std::pair<skynet::BlockNode*, bool> skynet::BlockIndex::Insert(const Hash256& hash) {
+      if ((nodes.size() + 1) * MAX_LOAD_FACTOR_INVERSE > slots.size()) {
+            Grow();
+      }
+
+      const uint64_t key = Hash256Hasher{}(hash);
+      Slot& slot = slots[Probe(hash, key)];
+      if (slot.node != nullptr) {
+            return { slot.node, false };
+      }
+
+      nodes.emplace_back();
+      nodes.back().hash = hash;
+      slot.key = key;
+      slot.node = &nodes.back();
+      return { slot.node, true };
+}
+
+skynet::BlockNode* skynet::BlockIndex::Find(const Hash256& hash) {
+      return slots[Probe(hash, Hash256Hasher{}(hash))].node;
+}
+
+const skynet::BlockNode* skynet::BlockIndex::Find(const Hash256& hash) const {
+      return slots[Probe(hash, Hash256Hasher{}(hash))].node;
+}
+
+void skynet::BlockIndex::Clear() {
+      nodes.clear();
+      std::fill(slots.begin(), slots.end(), Slot{});
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
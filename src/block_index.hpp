@@ -0,0 +1,148 @@
+/**
+ * @file    block_index.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   In memory index of the known blocks.
+ *
+ *          Every block the node knows about gets a BlockNode (its hash, header, height,
+ *          parent and the total work of the chain ending in it), looked up by hash in an
+ *          open addressing table. The nodes form a tree rooted at the genesis block, the
+ *          main chain being the path to the node with the most work. Block hashes are
+ *          already uniformly distributed (apart from their leading zeros), so the table
+ *          uses the last 8 bytes of the hash as is instead of hashing it again.
+ *
+ * @date    2023-11-16
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ */
+
+#ifndef SKYNET_BLOCK_INDEX_HPP
+#define SKYNET_BLOCK_INDEX_HPP
+
+/** C++ Includes */
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/** Skynet Includes */
+#include <types.hpp>
+#include <block.hpp>
+#include <coins.hpp>
+
+namespace skynet
+{
+      /**
+       * @brief Amount of proof of work, as a 256 bit unsigned integer
+       */
+      struct ChainWork {
+            std::array<uint64_t, 4> limbs{};          /** Least significant limb first */
+
+            /**
+             * @brief Returns the expected number of hashes needed to meet a difficulty target
+             *
+             * @param difficultyTarget The number of leading zero bits
+             * @return ChainWork 2^difficultyTarget (capped at 2^255)
+             */
+            static ChainWork ForTarget(uint32_t difficultyTarget);
+
+            ChainWork& operator+=(const ChainWork& work);
+            ChainWork operator+(const ChainWork& work) const { return ChainWork(*this) += work; }
+
+            bool operator<(const ChainWork& work) const;
+            bool operator>(const ChainWork& work) const { return work < *this; }
+            bool operator==(const ChainWork& work) const { return limbs == work.limbs; }
+            bool operator!=(const ChainWork& work) const { return limbs != work.limbs; }
+      };
+
+      /**
+       * @brief A block known to the node
+       */
+      struct BlockNode {
+            Hash256 hash{};                           /** Hash of the block */
+            BlockHeader header{};                     /** Header of the block */
+            uint32_t height = 0;                      /** Height of the block */
+            BlockNode *parent = nullptr;              /** The previous block, nullptr for the genesis block */
+            ChainWork chainWork;                      /** Total work of the chain ending in this block */
+            std::shared_ptr<const Block> block;       /** The block, while it is kept in memory */
+            std::shared_ptr<const BlockUndo> undo;    /** The coins it spent, while it is connected and not stored */
+            bool invalid = false;                     /** Set once connecting the block (or one of its parents) failed */
+      };
+
+      /**
+       * @brief Open addressing (linear probing) hash table of BlockNodes, keyed by block hash
+       *
+       * @details Nodes are never removed and never move, pointers to them stay valid for
+       *          the lifetime of the index. Not thread safe.
+       */
+      class BlockIndex
+      {
+      public:
+            /**
+             * @param capacity The number of blocks to make room for up front
+             */
+            explicit BlockIndex(std::size_t capacity = 1024);
+
+            BlockIndex(const BlockIndex&) = delete;
+            BlockIndex& operator=(const BlockIndex&) = delete;
+
+            /**
+             * @brief Returns the node of a block, adding an empty one if the block is not indexed
+             *
+             * @param hash The hash of the block
+             * @return std::pair<BlockNode*, bool> The node, and whether it was just added
+             */
+            std::pair<BlockNode*, bool> Insert(const Hash256& hash);
+
+            /** Returns the node of the block with the given hash, or nullptr if it is not indexed */
+            BlockNode* Find(const Hash256& hash);
+            const BlockNode* Find(const Hash256& hash) const;
+
+            /** Drops every node */
+            void Clear();
+
+            /** Returns the number of indexed blocks */
+            std::size_t Size() const { return nodes.size(); }
+
+      private:
+            /** The hash bits of a node are kept next to it, so most probes don't touch the node */
+            struct Slot {
+                  uint64_t key = 0;
+                  BlockNode *node = nullptr;
+            };
+
+            std::deque<BlockNode> nodes;              /** The nodes, a deque so they never move */
+            std::vector<Slot> slots;                  /** The table, its size is a power of two */
+
+            std::size_t Probe(const Hash256& hash, uint64_t key) const;
+            void Grow();
+      };
+
+} // namespace skynet
+
+#endif // SKYNET_BLOCK_INDEX_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
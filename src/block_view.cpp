@@ -0,0 +1,137 @@
+//
+// Created by JoaoAJMatos on 13/11/2023.
+//
+
+/** C++ Includes */
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+/** Skynet Includes */
+#include <serialize.hpp>
+#include <crypto/sha256.hpp>
+
+/** Local Includes */
+#include "block_view.hpp"
+
+
+float skynet::TransactionView::Version() const {
+      const uint32_t bits = serialize::ReadLE32(data + VERSION_OFFSET);
+      float version;
+      memcpy(&version, &bits, sizeof(version));
+      return version;
+}
+
+int64_t skynet::TransactionView::Timestamp() const {
+      return static_cast<int64_t>(serialize::ReadLE64(data + TIMESTAMP_OFFSET));
+}
+
+int32_t skynet::TransactionView::PrevTransactionOutputIndex() const {
+      return static_cast<int32_t>(serialize::ReadLE32(data + PREV_OUTPUT_INDEX_OFFSET));
+}
+
+int32_t skynet::TransactionView::Sequence() const {
+      return static_cast<int32_t>(serialize::ReadLE32(data + SEQUENCE_OFFSET));
+}
+
+int32_t skynet::TransactionView::Value() const {
+      return static_cast<int32_t>(serialize::ReadLE32(data + VALUE_OFFSET));
+}
+
+int64_t skynet::TransactionView::Locktime() const {
+      return static_cast<int64_t>(serialize::ReadLE64(data + LOCKTIME_OFFSET));
+}
+
+/**
+ * @brief Returns the hash of the transaction (TXID)
+ *
+ * @details The TXID is the SHA-256 of the serialization, which is exactly the viewed bytes.
+ *
+ * @return TransactionHash The hash of the transaction
+ */
+skynet::TransactionHash skynet::TransactionView::Hash() const {
+      TransactionHash hash;
+      crypto::hashing::SHA256(data, SERIALIZED_SIZE, hash.data());
+      return hash;
+}
+
+skynet::Transaction skynet::TransactionView::ToTransaction() const {
+      serialize::ReadBuffer reader(data, SERIALIZED_SIZE);
+      Transaction transaction;
+      serialize::Unserialize(reader, transaction);
+      return transaction;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Wraps a serialized block, recording where each transaction starts
+ *
+ * @param data The serialized block
+ * @param size The size of the serialized block
+ * @throws serialize::SerializationError If the block is truncated, has too many transactions
+ *                                       or is followed by trailing bytes
+ */
+skynet::BlockView::BlockView(const byte *data, std::size_t size) : data(data), size(size) {
+      serialize::ReadBuffer reader(data, size);
+      reader.View(BlockHeader::SERIALIZED_SIZE);
+
+      const auto count = static_cast<std::size_t>(serialize::ReadCompactSize(reader, MAX_TRANSACTIONS_PER_BLOCK));
+      this->offsets.reserve(count);
+      for (std::size_t i = 0; i < count; i++) {
+            this->offsets.push_back(static_cast<uint32_t>(reader.Position()));
+            reader.View(TransactionView::SERIALIZED_SIZE);
+      }
+
+      if (!reader.Empty()) {
+            throw serialize::SerializationError("Trailing bytes after the block");
+      }
+}
+
+/**
+ * @brief Returns the hash of the block, the double SHA-256 of the header
+ *
+ * @return Hash256 The hash of the block
+ */
+Hash256 skynet::BlockView::Hash() const {
+      Hash256 hash;
+      crypto::hashing::DoubleSHA256(data, BlockHeader::SERIALIZED_SIZE, hash.data());
+      return hash;
+}
+
+skynet::TransactionView skynet::BlockView::GetTransaction(std::size_t index) const {
+      if (index >= this->offsets.size()) {
+            throw std::out_of_range("Block has no transaction " + std::to_string(index));
+      }
+
+      return TransactionView(this->data + this->offsets[index]);
+}
+
+skynet::Block skynet::BlockView::ToBlock() const {
+      serialize::ReadBuffer reader(data, size);
+      Block block;
+      serialize::Unserialize(reader, block);
+      return block;
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,151 @@
+/**
+ * @file    block_view.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   Read only views over serialized blocks and transactions.
+ *          A view wraps bytes owned by someone else (a network buffer, a memory
+ *          mapped block file) and reads fields straight out of them, so blocks
+ *          can be relayed and inspected without materializing a Block and its
+ *          vector of Transactions.
+ *
+ * @date    2023-11-13
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ */
+
+#ifndef SKYNET_BLOCK_VIEW_HPP
+#define SKYNET_BLOCK_VIEW_HPP
+
+/** C++ Includes */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Skynet Includes */
+#include <types.hpp>
+#include <block.hpp>
+#include <transaction.hpp>
+
+namespace skynet
+{
+      /**
+       * @brief View over a serialized transaction
+       *
+       * @details Field offsets follow serialize::Serializer<Transaction>, the accessors
+       *          decode a single field on every call.
+       */
+      class TransactionView
+      {
+      public:
+            /** Size of a serialized transaction */
+            static constexpr std::size_t SERIALIZED_SIZE = 194;
+
+            /** Offsets of the fields in the serialization */
+            static constexpr std::size_t VERSION_OFFSET = 0;
+            static constexpr std::size_t TIMESTAMP_OFFSET = 4;
+            static constexpr std::size_t PREV_OUTPUT_OFFSET = 12;
+            static constexpr std::size_t PREV_OUTPUT_INDEX_OFFSET = 44;
+            static constexpr std::size_t SENDER_OFFSET = 48;
+            static constexpr std::size_t SIGNATURE_OFFSET = 81;
+            static constexpr std::size_t SEQUENCE_OFFSET = 145;
+            static constexpr std::size_t VALUE_OFFSET = 149;
+            static constexpr std::size_t RECIPIENT_OFFSET = 153;
+            static constexpr std::size_t LOCKTIME_OFFSET = 186;
+
+            /**
+             * @param data SERIALIZED_SIZE bytes, they must outlive the view
+             */
+            explicit TransactionView(const byte *data) : data(data) {}
+
+            float Version() const;
+            int64_t Timestamp() const;
+            const byte* PrevTransactionOutput() const { return data + PREV_OUTPUT_OFFSET; }
+            int32_t PrevTransactionOutputIndex() const;
+            const byte* Sender() const { return data + SENDER_OFFSET; }
+            const byte* Signature() const { return data + SIGNATURE_OFFSET; }
+            int32_t Sequence() const;
+            int32_t Value() const;
+            const byte* Recipient() const { return data + RECIPIENT_OFFSET; }
+            int64_t Locktime() const;
+
+            /** Returns the hash of the transaction (TXID), same as Transaction::Hash */
+            TransactionHash Hash() const;
+
+            /** Deserializes the transaction */
+            Transaction ToTransaction() const;
+
+            const byte* Data() const { return data; }
+            std::size_t Size() const { return SERIALIZED_SIZE; }
+
+      private:
+            const byte *data;
+      };
+
+      /**
+       * @brief View over a serialized block
+       *
+       * @details The constructor walks the block once, checking its bounds and recording
+       *          where every transaction starts. After that the header and transactions
+       *          are read in place.
+       */
+      class BlockView
+      {
+      public:
+            /**
+             * @param data The serialized block, it must outlive the view
+             * @param size The size of the serialized block
+             * @throws serialize::SerializationError If the bytes are not exactly one block
+             */
+            BlockView(const byte *data, std::size_t size);
+
+            /** Returns the header, decoded from its 80 bytes */
+            BlockHeader Header() const { return BlockHeader::Deserialize(data); }
+            /** Returns the hash of the block, same as Block::Hash */
+            Hash256 Hash() const;
+
+            std::size_t TransactionCount() const { return offsets.size(); }
+
+            /**
+             * @brief Returns a view over the i-th transaction
+             * @throws std::out_of_range If there is no such transaction
+             */
+            TransactionView GetTransaction(std::size_t index) const;
+
+            /** Deserializes the block */
+            Block ToBlock() const;
+
+            const byte* Data() const { return data; }
+            std::size_t Size() const { return size; }
+
+      private:
+            const byte *data;
+            std::size_t size;
+            std::vector<uint32_t> offsets;          /** Offset of each transaction in data */
+      };
+
+} // namespace skynet
+
+#endif // SKYNET_BLOCK_VIEW_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -2,31 +2,23 @@
 // Created by JoaoAJMatos on 29/10/2023.
 //
 
+/** C++ Includes */
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <unordered_set>
+
+/** Skynet Includes */
+#include <time.hpp>
+#include <validation.hpp>
+
 /** Local Includes */
 #include "blockchain.hpp"
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
-/**
- * @brief Sends the transactions inside a block to the mempool
- *
- * @details Used when a fork is resolved to send the transactions
- *          that were in the block that got replaced back to the mempool
- *          so they can be added to a block again.
- *
- * @param block
- * @param mempool
- */
-static void send_block_transactions_back_to_mempool(
-       const skynet::Block& block,
-       const std::shared_ptr<skynet::MemPool>& mempool
-) {
-      for (const auto& transaction : block.GetTransactions()) {
-            mempool->AddTransaction(transaction);
-      }
-}
-
 /**
  * @brief Checks if the given block corresponds to the Genesis block
  *
@@ -37,42 +29,135 @@ static void send_block_transactions_back_to_mempool(
  * @return
  */
 static inline bool is_genesis_block(
-       const std::vector<std::unique_ptr<skynet::Block>>& chain,
+       const std::vector<skynet::BlockNode*>& chain,
        const skynet::Block& block
 ) {
-      return chain.empty() && block.Height() == 0;
+      return chain.empty() && block.GetHeader().prevHash == Hash256{};
 }
 
 /**
- * @brief Pushes a block into the given chain if it has valid content
+ * @brief Adds a block to the block tree, on top of its parent, keeping it in memory
  *
- * @param chain
+ * @param index The block index
  * @param block
- * @throws skynet::ChainException If the block is invalid
+ * @param parent The node of the previous block, nullptr for the genesis block
+ * @return skynet::BlockNode* The node of the block
  */
-static inline void push_block_if_valid(
-       std::vector<std::unique_ptr<skynet::Block>>& chain,
-       const skynet::Block& block
+static skynet::BlockNode* index_block(
+       skynet::BlockIndex& index,
+       std::shared_ptr<const skynet::Block> block,
+       skynet::BlockNode *parent
 ) {
-      if (!block.HasValidContent()) {
-            throw skynet::ChainException("Invalid block");
+      skynet::BlockNode *node = index.Insert(block->Hash()).first;
+      node->header = block->GetHeader();
+      node->parent = parent;
+      node->height = parent ? parent->height + 1 : 0;
+      node->chainWork = skynet::ChainWork::ForTarget(node->header.difficultyTarget);
+      if (parent) node->chainWork += parent->chainWork;
+      node->block = std::move(block);
+      return node;
+}
+
+/**
+ * @brief Applies the transactions of a block to a view of the UTXO set
+ *
+ * @details Transactions are applied in order, so a transaction can spend an output created
+ *          earlier in the same block. A block has at most one coinbase transaction, its first
+ *          one, which only creates its output (it may overwrite an unspent coinbase output
+ *          with the same TXID) and can't pay more than the block subsidy plus the fees of the
+ *          block. Other transactions can't send more than the output they spend. The
+ *          signature of every spend is queued on the control, to be verified while the rest
+ *          of the block is applied.
+ *
+ * @param block
+ * @param height The height of the block
+ * @param view The view to update
+ * @param control Where the signature checks go, nullptr to skip them (blocks already validated)
+ * @return skynet::BlockUndo The coins spent by the block, in order
+ * @throws ChainException If the block spends an output that is missing, already spent or
+ *                        not owned by the sender, creates coins out of nothing or has
+ *                        misplaced coinbase transactions
+ */
+static skynet::BlockUndo connect_coins(const skynet::Block& block, uint32_t height, skynet::CoinsCache& view, skynet::CheckQueueControl *control) {
+      skynet::BlockUndo undo;
+      const auto& transactions = block.GetTransactions();
+      int64_t fees = 0;
+
+      for (std::size_t i = 0; i < transactions.size(); i++) {
+            const skynet::Transaction& transaction = transactions[i];
+            const bool coinbase = transaction.IsCoinbase();
+            const int value = transaction.GetOutput().value;
+            if (value < 0) {
+                  throw skynet::ChainException("Block has a negative output");
+            }
+
+            if (coinbase && i > 0) {
+                  throw skynet::ChainException("Block has a coinbase transaction that is not its first");
+            }
+            if (!coinbase) {
+                  const skynet::TransactionInput input = transaction.GetInput();
+                  skynet::Coin spent;
+                  if (input.prevTransactionOutputIndex < 0 ||
+                      !view.SpendCoin({ input.prevTransactionOutput, static_cast<uint32_t>(input.prevTransactionOutputIndex) }, &spent)) {
+                        throw skynet::ChainException("Block spends a missing or spent output");
+                  }
+                  if (memcmp(input.sender, spent.output.recipient, sizeof(input.sender)) != 0) {
+                        throw skynet::ChainException("Block spends an output its sender doesn't own");
+                  }
+                  if (value > spent.output.value) {
+                        throw skynet::ChainException("Block sends more than the output it spends");
+                  }
+                  fees += spent.output.value - value;
+                  if (control != nullptr) control->Add(&transaction);
+                  undo.spent.push_back(std::move(spent));
+            }
+
+            view.AddCoin({ transaction.Hash(), 0 }, skynet::Coin(transaction.GetOutput(), height, coinbase), coinbase);
       }
 
-      chain.push_back(std::make_unique<skynet::Block>(block));
+      if (!transactions.empty() && transactions[0].IsCoinbase() &&
+          transactions[0].GetOutput().value > skynet::consensus::GetBlockSubsidy(static_cast<int>(height)) + fees) {
+            throw skynet::ChainException("Block pays more than its subsidy and fees");
+      }
+      return undo;
 }
 
 /**
- * @brief Checks if two hashes match
+ * @brief Reverts the transactions of a block on a view of the UTXO set
  *
- * @param hash1
- * @param hash2
- * @return
+ * @param block
+ * @param undo The coins spent by the block
+ * @param view The view to update
+ * @throws ChainException If the undo data doesn't match the block
  */
-static inline bool hashes_do_match(
-       const std::unique_ptr<byte[]>& hash1,
-       const std::unique_ptr<byte[]>& hash2
-) {
-      return crypto::hashing::SHA256::CompareHash(hash1.get(), hash2.get());
+static void disconnect_coins(const skynet::Block& block, const skynet::BlockUndo& undo, skynet::CoinsCache& view) {
+      std::size_t spent = undo.spent.size();
+      const auto& transactions = block.GetTransactions();
+
+      for (auto it = transactions.rbegin(); it != transactions.rend(); ++it) {
+            view.SpendCoin({ it->Hash(), 0 });
+            if (it->IsCoinbase()) continue;
+
+            if (spent == 0) {
+                  throw skynet::ChainException("Undo data does not match the block");
+            }
+            const skynet::TransactionInput input = it->GetInput();
+            view.AddCoin({ input.prevTransactionOutput, static_cast<uint32_t>(input.prevTransactionOutputIndex) }, undo.spent[--spent], true);
+      }
+}
+
+/**
+ * @brief Returns whether a block descends from a block that failed to connect
+ *
+ * @param chain The main chain, whose blocks are all valid
+ * @param node
+ */
+static bool has_invalid_ancestor(const std::vector<skynet::BlockNode*>& chain, const skynet::BlockNode *node) {
+      for (; node != nullptr; node = node->parent) {
+            if (node->invalid) return true;
+            if (node->height < chain.size() && chain[node->height] == node) return false;
+      }
+      return false;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -80,97 +165,630 @@ static inline bool hashes_do_match(
 /**
  * @brief Adds a block to the Blockchain
  *
- * @details Performs the necessary checks and adds the block to the Blockchain.
+ * @details Performs the necessary checks and adds the block to the block tree, along with
+ *          the orphans that were waiting for it. The main chain then moves to the added
+ *          block with the most work if it beats the tip: extending the tip is the common
+ *          case, a branch that overtakes the main chain triggers a reorganization.
  *
  * @param block
- * @throws std::runtime_error If the block is invalid
+ * @throws ChainException If the block is invalid or already known
  */
-void skynet::Chain::AddBlock(const skynet::Block& block) {
-      /** Genesis block */
-      if (is_genesis_block(blocks, block)) {
-            push_block_if_valid(blocks, block); // Can throw ChainException
-            return;
+void skynet::Chain::AddBlock(const skynet::Block& block, bool contentChecked) {
+      if (index.Find(block.Hash()) != nullptr || orphans.Contains(block.Hash())) {
+            throw ChainException("Block already known");
       }
 
-      /** Normal cases */
-      if (BlockHasExpectedHeight(block) && BlockExtendsMainChain(block)) {
-            push_block_if_valid(blocks, block); // Can throw ChainException
-            return;
-      } else if (BlockIsFork(block)) {
-            HandleForkResolution(block);
+      BlockNode *parent = nullptr;
+      if (!is_genesis_block(mainChain, block)) {
+            parent = index.Find(block.GetHeader().prevHash);
+            if (parent == nullptr) {
+                  /** Checked before pooling, so junk can't push real orphans out */
+                  if (!contentChecked && !block.HasValidContent()) {
+                        throw ChainException("Invalid block");
+                  }
+                  orphans.Add(std::make_shared<const Block>(block), util::time::timestamp());
+                  return;
+            }
+      }
+
+      /** The block, then every orphan descending from it (checked before they were pooled), parents first */
+      std::vector<BlockNode*> added { AcceptBlock(std::make_shared<const Block>(block), parent, contentChecked) };
+      for (std::size_t i = 0; i < added.size(); i++) {
+            for (auto& child : orphans.TakeChildren(added[i]->hash)) {
+                  try {
+                        added.push_back(AcceptBlock(std::move(child), added[i], true));
+                  } catch (const ChainException&) {
+                        /** An invalid orphan is dropped, with its descendants left to expire */
+                  }
+            }
+      }
+
+      /**
+       * The first block seen wins between branches with the same work. A branch that fails
+       * to connect is marked invalid, and the next best one is tried
+       */
+      std::exception_ptr failure;
+      for (;;) {
+            BlockNode *tip = mainChain.empty() ? nullptr : mainChain.back();
+            BlockNode *best = tip;
+            for (BlockNode *node : added) {
+                  if ((best == nullptr || best->chainWork < node->chainWork) && !has_invalid_ancestor(mainChain, node)) best = node;
+            }
+            if (best == tip) break;
+
+            try {
+                  ActivateBestChain(best);
+                  break;
+            } catch (const ChainException&) {
+                  if (!best->invalid) throw;
+                  failure = std::current_exception();
+            }
+      }
+
+      /** Blocks left on other branches only need to be stored, invalid ones are dropped */
+      for (BlockNode *node : added) {
+            if (IsInMainChain(*node)) continue;
+            if (has_invalid_ancestor(mainChain, node)) {
+                  node->invalid = true;
+                  node->block.reset();
+            } else if (store) {
+                  store->WriteBlock(*node->block, node->height, storage::BLOCK_HAVE_DATA);
+                  node->block.reset();
+            }
+      }
+
+      if (failure) std::rethrow_exception(failure);
+}
+
+/**
+ * @brief Validates a block and adds it to the block tree
+ *
+ * @param block
+ * @param parent The node of the previous block
+ * @param contentChecked Whether HasValidContent already passed, skipping it
+ * @return skynet::BlockNode* The node of the block
+ * @throws ChainException If the block is invalid
+ */
+skynet::BlockNode* skynet::Chain::AcceptBlock(std::shared_ptr<const Block> block, BlockNode *parent, bool contentChecked) {
+      if (!contentChecked && !(validationPool ? block->HasValidContent(*validationPool) : block->HasValidContent())) {
+            throw ChainException("Invalid block");
+      }
+      if (parent != nullptr && parent->invalid) {
+            throw ChainException("Block builds on an invalid block");
+      }
+
+      return index_block(index, std::move(block), parent);
+}
+
+/**
+ * @brief Reorganizes the main chain so it ends in tip
+ *
+ * @details Only the blocks above the fork point are touched, whatever the depth of the
+ *          reorganization, so extending the tip is the same as a reorganization that
+ *          disconnects nothing. Blocks that aren't stored yet are written as they are
+ *          connected, the status changes of the others go to the block store in one
+ *          batch per side, and the displaced transactions go back to the mempool in one batch.
+ *
+ *          The UTXO set is updated through a cache stacked on it, written back only once
+ *          every block of the new branch connected, so a failure changes nothing but the
+ *          invalid flags of the failing block and its descendants.
+ *
+ * @param tip The node with the most work
+ * @throws ChainException If a block of the new branch can't be connected
+ */
+void skynet::Chain::ActivateBestChain(BlockNode *tip) {
+      /** Walk the new branch back to the main chain */
+      std::vector<BlockNode*> connect;
+      BlockNode *fork = tip;
+      while (fork != nullptr && !IsInMainChain(*fork)) {
+            connect.push_back(fork);
+            fork = fork->parent;
+      }
+      std::reverse(connect.begin(), connect.end());
+
+      const std::size_t forkHeight = fork ? fork->height + 1 : 0;
+      std::vector<std::pair<Hash256, uint8_t>> disconnected, connected;
+      std::vector<std::shared_ptr<const Block>> displaced;
+
+      /** Apply the UTXO changes first, the chain is only touched once they all succeeded */
+      CoinsCache view(&coins);
+      for (std::size_t height = mainChain.size(); height-- > forkHeight; ) {
+            const std::shared_ptr<const Block> block = GetBlock(*mainChain[height]);
+            const std::shared_ptr<const BlockUndo> undo = GetUndo(*mainChain[height]);
+            if (!block || !undo) {
+                  throw ChainException("Missing block data to disconnect a block");
+            }
+            disconnect_coins(*block, *undo, view);
+            if (mempool) displaced.push_back(block);
+      }
+
+      std::vector<std::shared_ptr<const BlockUndo>> undos;
+      std::size_t assumed_valid = 0;
+      for (std::size_t i = 0; i < connect.size(); i++) {
+            try {
+                  const std::shared_ptr<const Block> block = GetBlock(*connect[i]);
+                  if (!block) {
+                        throw ChainException("Missing block data to connect a block");
+                  }
+                  const bool assumed = IsAssumedValid(*connect[i]);
+                  CheckQueueControl control(validationPool.get());
+                  undos.push_back(std::make_shared<const BlockUndo>(connect_coins(*block, connect[i]->height, view, assumed ? nullptr : &control)));
+                  if (assumed) assumed_valid++;
+                  if (!control.Wait()) {
+                        throw ChainException("Block has an invalid signature");
+                  }
+            } catch (const ChainException&) {
+                  for (std::size_t j = i; j < connect.size(); j++) connect[j]->invalid = true;
+                  throw;
+            }
+      }
+      view.SetBestBlock(tip->hash);
+      view.Flush();
+      assumedValidBlocks += assumed_valid;
+
+      /** Disconnect the old branch */
+      for (std::size_t height = forkHeight; height < mainChain.size(); height++) {
+            BlockNode *node = mainChain[height];
+            if (store) {
+                  disconnected.emplace_back(node->hash, store->Lookup(node->hash)->status & ~storage::BLOCK_MAIN_CHAIN);
+                  node->block.reset();
+            }
+            node->undo.reset();
+      }
+      mainChain.resize(forkHeight);
+      if (store && !disconnected.empty()) store->SetStatus(disconnected);
+
+      /** Connect the new one */
+      for (std::size_t i = 0; i < connect.size(); i++) {
+            BlockNode *node = connect[i];
+            mainChain.push_back(node);
+            assumeValidAncestors.erase(node->hash);
+            if (!store) {
+                  node->undo = std::move(undos[i]);
+                  continue;
+            }
+
+            const storage::BlockIndexEntry *entry = store->Lookup(node->hash);
+            if (entry == nullptr) entry = &store->WriteBlock(*node->block, node->height);
+            if (!(entry->status & storage::BLOCK_HAVE_UNDO)) store->WriteUndo(node->hash, *undos[i]);
+            if (!(entry->status & storage::BLOCK_MAIN_CHAIN)) connected.emplace_back(node->hash, entry->status | storage::BLOCK_MAIN_CHAIN);
+      }
+
+      if (store && !connected.empty()) store->SetStatus(connected);
+      UpdateBlocksInMemory();
+      FlushCoins();
+      PruneBlockFiles();
+
+      /**
+       * Transactions of the old branch go back to the mempool if they can still be mined:
+       * their input must be unspent on the new branch, or come from another of them. The
+       * blocks are walked up from the fork so those come first. Coinbases can't be mined
+       * again, and the transactions the new branch includes spend their input there.
+       */
+      if (!displaced.empty()) {
+            std::vector<Transaction> transactions;
+            std::unordered_set<OutPoint, OutPointHasher> created;
+            for (auto block = displaced.rbegin(); block != displaced.rend(); ++block) {
+                  for (const auto& transaction : (*block)->GetTransactions()) {
+                        if (transaction.IsCoinbase()) continue;
+
+                        const TransactionInput input = transaction.GetInput();
+                        const OutPoint outpoint{ input.prevTransactionOutput, static_cast<uint32_t>(input.prevTransactionOutputIndex) };
+                        if (created.erase(outpoint) == 0 && !coins.HaveCoin(outpoint)) continue;
+
+                        created.insert({ transaction.Hash(), 0 });
+                        transactions.push_back(transaction);
+                  }
+            }
+            mempool->AddTransactions(std::move(transactions));
+      }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+const skynet::BlockNode* skynet::Chain::GetBlockNode(std::size_t height) const {
+      return height < mainChain.size() ? mainChain[height] : nullptr;
+}
+
+bool skynet::Chain::IsInMainChain(const BlockNode& node) const {
+      return node.height < mainChain.size() && mainChain[node.height] == &node;
+}
+
+std::vector<Hash256> skynet::Chain::GetLocator() const {
+      std::vector<Hash256> locator;
+      std::size_t step = 1;
+
+      for (std::size_t height = mainChain.size(); height-- > 0; ) {
+            locator.push_back(mainChain[height]->hash);
+            if (height == 0) break;
+            if (locator.size() >= 10) step *= 2;
+            height = height > step ? height - step + 1 : 1;
+      }
+      return locator;
+}
+
+void skynet::Chain::SetAssumeValid(const Hash256& hash) {
+      this->assumeValid = hash;
+      this->assumeValidAncestors.clear();
+      this->assumeValidIndexed = false;
+}
+
+std::size_t skynet::Chain::AddAssumeValidHeaders(const std::vector<BlockHeader>& headers) {
+      if (assumeValid == Hash256{}) return 0;
+
+      std::vector<Hash256> hashes;
+      for (const BlockHeader& header : headers) {
+            if (!hashes.empty() && header.prevHash != hashes.back()) {
+                  throw ChainException("Headers are not linked");
+            }
+            hashes.push_back(header.Hash());
+
+            if (hashes.back() == assumeValid) {
+                  assumeValidAncestors.insert(hashes.begin(), hashes.end());
+                  return hashes.size();
+            }
+      }
+      return 0;
+}
+
+bool skynet::Chain::IsAssumedValid(const BlockNode& node) {
+      if (assumeValid == Hash256{}) return false;
+
+      if (!assumeValidIndexed) {
+            if (const BlockNode *ancestor = index.Find(assumeValid)) {
+                  for (; ancestor != nullptr && !IsInMainChain(*ancestor); ancestor = ancestor->parent) {
+                        assumeValidAncestors.insert(ancestor->hash);
+                  }
+                  assumeValidIndexed = true;
+            }
+      }
+      return assumeValidAncestors.count(node.hash) > 0;
+}
+
+void skynet::Chain::SetPruneTarget(uint64_t target, uint32_t depth) {
+      SetPruneTargetBytes(target * 1024 * 1024, depth);
+}
+
+void skynet::Chain::SetPruneTargetBytes(uint64_t target, uint32_t depth) {
+      this->pruneTarget = target;
+      this->pruneDepth = depth;
+      PruneBlockFiles();
+}
+
+void skynet::Chain::SetValidationThreads(std::size_t threads) {
+      if (threads < 2) {
+            validationPool.reset();
             return;
       }
 
-      throw ChainException("Invalid block");
+      validationPool = std::make_unique<threading::ThreadPool>(threads);
+      validationPool->Init();
+}
+
+/**
+ * @brief Returns the undo data of a block, from memory or from the block store
+ *
+ * @param node
+ * @return std::shared_ptr<const skynet::BlockUndo> The undo data, or nullptr if it isn't available
+ */
+std::shared_ptr<const skynet::BlockUndo> skynet::Chain::GetUndo(const BlockNode& node) const {
+      if (node.undo) return node.undo;
+      if (!store) return nullptr;
+
+      const storage::BlockIndexEntry *entry = store->Lookup(node.hash);
+      if (entry == nullptr || !(entry->status & storage::BLOCK_HAVE_UNDO)) return nullptr;
+      return std::make_shared<const BlockUndo>(store->ReadUndo(*entry));
+}
+
+/**
+ * @brief Returns the block of a node, from memory or from the block store
+ *
+ * @param node
+ * @return std::shared_ptr<const skynet::Block> The block, or nullptr if it isn't available
+ */
+std::shared_ptr<const skynet::Block> skynet::Chain::GetBlock(const BlockNode& node) const {
+      if (node.block) return node.block;
+      if (!store) return nullptr;
+
+      const storage::BlockIndexEntry *entry = store->Lookup(node.hash);
+      if (entry == nullptr || !(entry->status & storage::BLOCK_HAVE_DATA)) return nullptr;
+      return std::make_shared<const Block>(store->ReadBlock(*entry));
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * @brief Checks if a Block has the expected height given the last block in the chain
+ * @brief Loads the blocks at the top of the main chain that aren't in memory and, once
+ *        the chain is backed by a block store, drops the ones below them
+ */
+void skynet::Chain::UpdateBlocksInMemory() {
+      const std::size_t first = mainChain.size() - std::min(mainChain.size(), BLOCKS_KEPT_IN_MEMORY);
+
+      for (std::size_t height = first; height < mainChain.size(); height++) {
+            if (!mainChain[height]->block) mainChain[height]->block = GetBlock(*mainChain[height]);
+      }
+
+      if (!store) return;
+      for (std::size_t height = first; height-- > 0 && mainChain[height]->block; ) {
+            mainChain[height]->block.reset();
+      }
+}
+
+/**
+ * @brief Opens the block store and loads the chain from it
  *
- * @param newBlock
- * @return
+ * @details Startup only reads the store index: every stored block is added to the block
+ *          tree from the header kept in its index record, the main chain is found by
+ *          walking back from the tip, and only the last BLOCKS_KEPT_IN_MEMORY blocks are read.
+ *
+ * @param directory The directory of the block store
+ * @throws ChainException If the chain is already backed by a store
  */
-inline bool skynet::Chain::BlockHasExpectedHeight(const skynet::Block &newBlock) const {
-      return newBlock.Height() == GetLastBlock().Height() + 1;
+void skynet::Chain::LoadChain(const std::string& directory) {
+      if (store) {
+            throw ChainException("The chain is already backed by a block store");
+      }
+
+      auto opened = std::make_unique<storage::BlockStore>(directory, blockFileSize);
+      opened->Open();
+
+      /** Parents come before their children when going by height */
+      std::vector<const storage::BlockIndexEntry*> entries;
+      entries.reserve(opened->Size());
+      for (const auto& [hash, entry] : opened->GetIndex()) {
+            entries.push_back(&entry);
+      }
+      std::sort(entries.begin(), entries.end(), [](const auto *a, const auto *b) { return a->height < b->height; });
+
+      index.Clear();
+      mainChain.clear();
+      for (const storage::BlockIndexEntry *entry : entries) {
+            BlockNode *node = index.Insert(entry->hash).first;
+            node->header = entry->header;
+            node->height = entry->height;
+            node->parent = entry->height > 0 ? index.Find(entry->header.prevHash) : nullptr;
+            node->chainWork = ChainWork::ForTarget(entry->header.difficultyTarget);
+            if (node->parent) node->chainWork += node->parent->chainWork;
+      }
+
+      const storage::BlockIndexEntry *tip = opened->GetTip();
+      if (tip != nullptr) {
+            mainChain.resize(tip->height + 1);
+            BlockNode *node = index.Find(tip->hash);
+            for (std::size_t height = mainChain.size(); height-- > 0; node = node->parent) {
+                  if (node == nullptr || node->height != height) {
+                        throw ChainException("The block store is missing blocks of the main chain");
+                  }
+                  mainChain[height] = node;
+            }
+      }
+
+      this->store = std::move(opened);
+      UpdateBlocksInMemory();
+      LoadCoins();
 }
 
 /**
- * @brief Checks if a Block extends the main chain by checking the previous hash
- *        of the new block and the hash of the last block in the chain
+ * @brief Stores the blocks that aren't in the block store yet and keeps the chain backed by it
  *
- * @param newBlock
- * @return
+ * @param directory The directory of the block store
  */
-inline bool skynet::Chain::BlockExtendsMainChain(const skynet::Block &newBlock) const {
-      return hashes_do_match(newBlock.GetHeader().prevHash, GetLastBlock().Hash());
+void skynet::Chain::SaveChain(const std::string& directory) {
+      if (!store) {
+            store = std::make_unique<storage::BlockStore>(directory, blockFileSize);
+            store->Open();
+            coinsDb = std::make_unique<storage::CoinsDatabase>((std::filesystem::path(directory) / "chainstate").string());
+            coinsDb->Open();
+            coins.SetBase(coinsDb.get());
+      } else if (store->GetDirectory() != directory) {
+            throw ChainException("The chain is backed by the block store in " + store->GetDirectory());
+      }
+
+      for (BlockNode *node : mainChain) {
+            if (store->Lookup(node->hash) == nullptr) {
+                  if (node->block) store->WriteBlock(*node->block, node->height);
+                  else store->WriteHeader(node->header, node->height);
+            }
+            if (node->undo) {
+                  if (!(store->Lookup(node->hash)->status & storage::BLOCK_HAVE_UNDO)) store->WriteUndo(node->hash, *node->undo);
+                  node->undo.reset();
+            }
+      }
+
+      UpdateBlocksInMemory();
+      FlushCoins(true);
+      PruneBlockFiles();
 }
 
 /**
- * @brief Checks if the incoming block creates a fork of the main chain
+ * @brief Writes the UTXO set as of a main chain block to a snapshot
  *
- * @details If both blocks have the same height, they are both trying to extend the main chain
- *          at the same index. We must check if the blocks are different, and if they are, we
- *          should handle the fork resolution.
+ * @details The cache is written back first, so the set is read from the coins database
+ *          (or the cache itself without one) through a view that only holds the changes
+ *          of the disconnected blocks. A cursor walks the database in outpoint order,
+ *          merged with those changes, and streams every coin straight to the writer, so
+ *          the export never holds more than a chunk of the set in memory.
  *
- * @param newBlock
- * @return
+ * @param path Where the snapshot goes
+ * @param height The height of the block
  */
-bool skynet::Chain::BlockIsFork(const Block& newBlock) const {
-      const Block& lastBlock = GetLastBlock();
+storage::UtxoSnapshotMetadata skynet::Chain::ExportSnapshot(const std::string& path, uint32_t height) {
+      if (height >= mainChain.size()) {
+            throw ChainException("The main chain has no block at height " + std::to_string(height));
+      }
 
-      if (lastBlock.Height() == newBlock.Height() && lastBlock != newBlock && newBlock.HasValidContent())
-            return true;
+      FlushCoins(true);
+      CoinsCache view(coinsDb ? static_cast<CoinsView*>(coinsDb.get()) : &coins);
+      for (std::size_t above = mainChain.size(); above-- > height + 1; ) {
+            const std::shared_ptr<const Block> block = GetBlock(*mainChain[above]);
+            const std::shared_ptr<const BlockUndo> undo = GetUndo(*mainChain[above]);
+            if (!block || !undo) {
+                  throw ChainException("Missing block data to disconnect a block");
+            }
+            disconnect_coins(*block, *undo, view);
+      }
 
-      return false;
+      storage::UtxoSnapshotWriter writer(path, mainChain[height]->hash, height);
+      Coin coin;
+      for (auto cursor = view.Cursor(); cursor->Valid(); cursor->Next()) {
+            cursor->GetValue(coin);
+            writer.Add(cursor->GetKey(), coin);
+      }
+      return writer.Finish();
+}
+
+/**
+ * @brief Loads the UTXO set and the header chain of a snapshot into an empty chain
+ *
+ * @param path The snapshot
+ * @param headers The header chain from the genesis block to the base block
+ * @param commitment The commitment the snapshot is trusted with
+ */
+void skynet::Chain::LoadSnapshot(const std::string& path, const std::vector<BlockHeader>& headers, const Hash256& commitment) {
+      if (index.Size() != 0) {
+            throw ChainException("Snapshots can only be loaded into an empty chain");
+      }
+
+      storage::UtxoSnapshotReader snapshot(path);
+      const storage::UtxoSnapshotMetadata& metadata = snapshot.GetMetadata();
+      if (metadata.commitment != commitment) {
+            throw ChainException("The snapshot doesn't match the expected commitment");
+      }
+
+      std::vector<Hash256> hashes;
+      hashes.reserve(headers.size());
+      for (const BlockHeader& header : headers) {
+            if (header.prevHash != (hashes.empty() ? Hash256{} : hashes.back())) {
+                  throw ChainException("The headers are not linked");
+            }
+            hashes.push_back(header.Hash());
+            if (!MeetsDifficultyTarget(hashes.back(), header.difficultyTarget)) {
+                  throw ChainException("A header doesn't meet its difficulty target");
+            }
+      }
+      if (hashes.size() != std::size_t(metadata.height) + 1 || hashes.back() != metadata.baseBlock) {
+            throw ChainException("The headers don't lead to the base block of the snapshot");
+      }
+
+      /** The coins go first, a corrupted snapshot leaves the chain empty */
+      if (coinsDb) {
+            coinsDb->Import(snapshot);
+      } else {
+            std::vector<std::pair<OutPoint, Coin>> chunk;
+            try {
+                  while (snapshot.ReadChunk(chunk)) {
+                        for (auto& [outpoint, coin] : chunk) coins.AddCoin(outpoint, std::move(coin), false);
+                  }
+            } catch (...) {
+                  coins.Clear();
+                  throw;
+            }
+            coins.SetBestBlock(metadata.baseBlock);
+      }
+
+      BlockNode *parent = nullptr;
+      for (std::size_t height = 0; height < headers.size(); height++) {
+            BlockNode *node = index.Insert(hashes[height]).first;
+            node->header = headers[height];
+            node->height = static_cast<uint32_t>(height);
+            node->parent = parent;
+            node->chainWork = ChainWork::ForTarget(headers[height].difficultyTarget);
+            if (parent) node->chainWork += parent->chainWork;
+
+            mainChain.push_back(node);
+            if (store) store->WriteHeader(headers[height], static_cast<uint32_t>(height));
+            parent = node;
+      }
+      if (store) store->Flush();
 }
 
 /**
- * @brief Handles the resolution of the blockchain fork
+ * @brief Opens the coins database and replays the blocks it is missing
  *
- * @details If the new block has a higher difficulty than the last block in the main chain,
- *          we should replace the main chain with the new block. If both blocks have the same
- *          difficulty, we should wait for the next block to be mined and adopt the longest
- *          chain as the main chain.
+ * @details The database is written back after the block store, so its best block is always
+ *          stored, but it can be behind the tip or even on a branch that was disconnected
+ *          since. The blocks in between are disconnected (with their stored undo data) and
+ *          connected again on the cache, the same way the chain got there.
  *
- *          The transactions present in the block(s) that got replaced must be sent back to the
- *          mempool to be added again to a block.
+ * @throws ChainException If the database doesn't match the block store
+ */
+void skynet::Chain::LoadCoins() {
+      coins.Clear();
+      coinsDb = std::make_unique<storage::CoinsDatabase>((std::filesystem::path(store->GetDirectory()) / "chainstate").string());
+      coinsDb->Open();
+      coins.SetBase(coinsDb.get());
+
+      const Hash256 best = coinsDb->GetBestBlock();
+      BlockNode *node = best == Hash256{} ? nullptr : index.Find(best);
+      if (best != Hash256{} && node == nullptr) {
+            throw ChainException("The coins database is ahead of the block store");
+      }
+
+      for (; node != nullptr && !IsInMainChain(*node); node = node->parent) {
+            const std::shared_ptr<const Block> block = GetBlock(*node);
+            const std::shared_ptr<const BlockUndo> undo = GetUndo(*node);
+            if (!block || !undo) {
+                  throw ChainException("Missing block data to disconnect a block");
+            }
+            disconnect_coins(*block, *undo, coins);
+            coins.SetBestBlock(node->parent ? node->parent->hash : Hash256{});
+      }
+
+      for (std::size_t height = node ? node->height + 1 : 0; height < mainChain.size(); height++) {
+            const std::shared_ptr<const Block> block = GetBlock(*mainChain[height]);
+            if (!block) {
+                  throw ChainException("Missing block data to connect a block");
+            }
+            const BlockUndo undo = connect_coins(*block, static_cast<uint32_t>(height), coins, nullptr);
+            if (!(store->Lookup(mainChain[height]->hash)->status & storage::BLOCK_HAVE_UNDO)) store->WriteUndo(mainChain[height]->hash, undo);
+            coins.SetBestBlock(mainChain[height]->hash);
+            FlushCoins();
+      }
+}
+
+/**
+ * @brief Writes the UTXO cache back to the coins database
  *
- * @param block
+ * @details The block store is flushed first, so the database never refers to blocks or
+ *          undo data that didn't make it to disk.
+ *
+ * @param force Whether to write the cache back whatever its size
  */
-void skynet::Chain::HandleForkResolution(const skynet::Block& block) {
-      const Block& blockToBeReplaced = GetLastBlock();
+void skynet::Chain::FlushCoins(bool force) {
+      if (!coinsDb) return;
+      if (!force && coins.DynamicMemoryUsage() <= coinsCacheSize) return;
+
+      store->Flush();
+      coins.Flush();
+}
 
-      if (block.GetDifficultyTarget() > blockToBeReplaced.GetDifficultyTarget()) {
-            /** Replace the main chain with the new block */
-            blocks.pop_back();
-            blocks.push_back(std::make_unique<Block>(block));
-            send_block_transactions_back_to_mempool(blockToBeReplaced, this->mempool);
-      } else if (block.GetDifficultyTarget() == blockToBeReplaced.GetDifficultyTarget()) {
-            /** Add the block to the orphan blocks */
-            this->orphans.push_back(std::make_unique<Block>(block));
+/**
+ * @brief Deletes the oldest block files while the block store is above the prune target
+ *
+ * @details A file is only pruned once every block in it is more than pruneDepth blocks
+ *          below the tip. The coins database is written back before anything is deleted,
+ *          so reloading the chain never has to replay a pruned block.
+ */
+void skynet::Chain::PruneBlockFiles() {
+      if (!store || pruneTarget == 0 || store->GetDiskUsage() <= pruneTarget) return;
+      if (mainChain.size() <= pruneDepth) return;
+
+      /** Blocks from this height up keep their data */
+      const uint32_t kept = static_cast<uint32_t>(mainChain.size() - 1 - pruneDepth);
+      const std::vector<storage::BlockFileInfo>& files = store->GetFileInfo();
+
+      std::vector<uint32_t> prunable;
+      uint64_t usage = store->GetDiskUsage();
+      for (uint32_t file = 0; file + 1 < files.size() && usage > pruneTarget; file++) {
+            if (files[file].blocks == 0 || files[file].maxHeight >= kept) continue;
+
+            prunable.push_back(file);
+            usage -= std::min(usage, files[file].size);
       }
+      if (prunable.empty()) return;
+
+      FlushCoins(true);
+      for (const uint32_t file : prunable) store->PruneFile(file);
 }
 
 // MIT License
@@ -21,12 +21,21 @@
 #include <vector>
 #include <memory>
 #include <stdexcept>
+#include <unordered_set>
+#include <utility>
 
 /** Skynet Includes */
 #include <types.hpp>
 #include <block.hpp>
+#include <block_index.hpp>
+#include <coins.hpp>
 #include <consensus.hpp>
 #include <mempool.hpp>
+#include <orphan_pool.hpp>
+#include <storage/block_store.hpp>
+#include <storage/coins_db.hpp>
+#include <storage/utxo_snapshot.hpp>
+#include <threading/threadpool.hpp>
 
 namespace skynet
 {
@@ -46,67 +55,288 @@ namespace skynet
             std::string message;
       };
 
+      /** Blocks of the main chain kept in memory once the chain is backed by a block store */
+      constexpr std::size_t BLOCKS_KEPT_IN_MEMORY = 16;
+      /** Blocks below the tip whose data pruning keeps by default, for reorganizations */
+      constexpr uint32_t DEFAULT_PRUNE_DEPTH = 288;
+
       class Chain
       {
       public:
-            Chain() = default;
+            /**
+             * @param mempool Where the transactions of blocks dropped by a reorganization go back to
+             */
+            explicit Chain(std::shared_ptr<MemPool> mempool = nullptr) : mempool(std::move(mempool)) {}
             ~Chain() = default;
 
             /* BLOCKCHAIN OPERATIONS */
-            /** Adds a block to the Blockchain */
-            void AddBlock(const Block& block);
+            /**
+             * @brief Adds a block to the block tree
+             * @details The block becomes the new tip if the chain ending in it has more work
+             *          than the main chain, reorganizing the main chain if it doesn't extend it.
+             *          Blocks on a branch with less work are kept in the tree in case it
+             *          overtakes the main chain later. A block whose parent is unknown waits
+             *          in the orphan pool, and is added (with its own waiting descendants)
+             *          as soon as the parent is. A block spending outputs that are missing,
+             *          already spent or not owned by the sender, or with an invalid
+             *          signature, is marked invalid when the chain tries to connect it,
+             *          leaving the main chain on the best valid branch.
+             *
+             * @param block
+             * @param contentChecked Whether the caller already checked the content of the block
+             *                       (HasValidContent), the sync does it on its download threads
+             * @throws ChainException If the block is invalid or already known
+             */
+            void AddBlock(const Block& block, bool contentChecked = false);
 
             /* BLOCKCHAIN VALIDATION */
             /** Validates the Blockchain */
             bool IsValid();
 
             /* BLOCKCHAIN GETTERS */
-            /** Returns the Blocks in the Blockchain */
-            std::vector<Block> GetBlocks();
             /** Returns the last block in the Blockchain */
-            [[nodiscard]] Block GetLastBlock() const { return *this->blocks.back(); }
+            [[nodiscard]] const Block& GetLastBlock() const { return *this->mainChain.back()->block; }
             /** Returns the size of the Blockchain */
-            [[nodiscard]] std::size_t Size() const { return this->blocks.size(); }
+            [[nodiscard]] std::size_t Size() const { return this->mainChain.size(); }
+            /** Returns the node of the last block in the Blockchain, or nullptr if it is empty */
+            [[nodiscard]] const BlockNode* GetTip() const { return this->mainChain.empty() ? nullptr : this->mainChain.back(); }
+
+            /** Returns the blocks waiting for their parent */
+            [[nodiscard]] const OrphanPool& GetOrphans() const { return this->orphans; }
+
+            /** Returns the node of a known block, in the main chain or not, or nullptr if the block is unknown */
+            [[nodiscard]] const BlockNode* LookupBlock(const Hash256& hash) const { return this->index.Find(hash); }
+            /** Returns the node of the main chain block at the given height, or nullptr if the chain is shorter */
+            [[nodiscard]] const BlockNode* GetBlockNode(std::size_t height) const;
+            /** Returns whether a block is part of the main chain */
+            [[nodiscard]] bool IsInMainChain(const BlockNode& node) const;
+            /**
+             * @brief Returns hashes of the main chain for a peer to find where its chain forks off
+             *
+             * @details The last ten blocks, then every other block, doubling the step each
+             *          time, and always the genesis block. Newest first.
+             */
+            [[nodiscard]] std::vector<Hash256> GetLocator() const;
+
+            /**
+             * @brief Looks an unspent output of the main chain up
+             *
+             * @param outpoint The output
+             * @param coin Set to the coin if it is found
+             * @return true If the output exists and is unspent
+             */
+            [[nodiscard]] bool GetCoin(const OutPoint& outpoint, Coin& coin) const { return this->coins.GetCoin(outpoint, coin); }
+
+            /** Sets the memory threshold past which the UTXO cache is written to the coins database */
+            void SetCoinsCacheSize(std::size_t size) { this->coinsCacheSize = size; }
+
+            /**
+             * @brief Sets the number of threads verifying signatures (and Merkle trees)
+             * @details With fewer than 2 threads, blocks are validated on the calling thread.
+             *
+             * @param threads The number of threads, usually MAX_THREAD_COUNT
+             */
+            void SetValidationThreads(std::size_t threads);
+
+            /**
+             * @brief Enables pruning of the block store
+             * @details Once the block and undo files take more than the target, the oldest
+             *          block files (with their undo files) are deleted, as long as every block
+             *          in them is more than depth blocks below the tip. The block index and the
+             *          UTXO set are kept whole, but reorganizations deeper than depth fail and
+             *          pruned blocks can't be served to peers anymore. The files being written
+             *          are never pruned, so the store can stay above a small target.
+             *
+             * @param target The disk usage target of the block and undo files in MB (the `prune`
+             *               config option), 0 to keep every block
+             * @param depth The number of blocks below the tip that keep their data
+             */
+            void SetPruneTarget(uint64_t target, uint32_t depth = DEFAULT_PRUNE_DEPTH);
+
+            /** Like SetPruneTarget(), with the target in bytes */
+            void SetPruneTargetBytes(uint64_t target, uint32_t depth = DEFAULT_PRUNE_DEPTH);
+
+            /** Sets the size at which block files are rotated, for the block store opened next */
+            void SetBlockFileSize(uint64_t size) { this->blockFileSize = size; }
+
+            /**
+             * @brief Sets the assume-valid block, whose ancestors are connected without
+             *        checking their signatures
+             * @details The coins they spend and their structure are still checked. Ancestors are
+             *          recognized once the assume-valid block is in the block tree, or through a
+             *          header chain given to AddAssumeValidHeaders before that.
+             *
+             * @param hash The hash of the block, all zeros (the default) to check every signature
+             */
+            void SetAssumeValid(const Hash256& hash);
+            /** Returns the assume-valid block hash, all zeros if every signature is checked */
+            [[nodiscard]] const Hash256& GetAssumeValid() const { return this->assumeValid; }
+
+            /**
+             * @brief Marks the blocks of a header chain that lead up to the assume-valid block
+             *        as its ancestors, ahead of downloading them
+             *
+             * @param headers A linked header chain, in order
+             * @return std::size_t The number of blocks marked, 0 if the chain doesn't contain the
+             *                     assume-valid block
+             * @throws ChainException If the headers are not linked
+             */
+            std::size_t AddAssumeValidHeaders(const std::vector<BlockHeader>& headers);
+
+            /** Returns the number of blocks connected without checking their signatures */
+            [[nodiscard]] std::size_t GetAssumedValidBlocks() const { return this->assumedValidBlocks; }
+
+            /**
+             * @brief Returns the block of a node
+             * @details Blocks still kept in memory are shared with the chain, older ones are
+             *          read from the block store.
+             *
+             * @param node The node of the block
+             * @return std::shared_ptr<const Block> The block, or nullptr if it is neither in memory nor stored
+             * @throws storage::StorageException If the stored block can't be read
+             */
+            [[nodiscard]] std::shared_ptr<const Block> GetBlock(const BlockNode& node) const;
+
+            /* BLOCKCHAIN FILES */
+            /**
+             * @brief Opens the block store in the given directory and loads the chain from it
+             * @details Only the block index and the last BLOCKS_KEPT_IN_MEMORY blocks are read,
+             *          new blocks are appended to the store as they are added. The UTXO set is
+             *          opened from the coins database (in the chainstate subdirectory) and
+             *          brought up to the tip if it was written back before the last blocks.
+             *
+             * @throws storage::StorageException If the store can't be opened
+             * @throws ChainException If the store is already open
+             */
+            void LoadChain(const std::string& directory);
+
+            /**
+             * @brief Writes the blocks that aren't stored yet to the block store in the given
+             *        directory (opening it if needed) and keeps storing new blocks there, then
+             *        writes the UTXO cache back to the coins database
+             *
+             * @throws storage::StorageException If the blocks can't be written
+             */
+            void SaveChain(const std::string& directory);
+
+            /* UTXO SNAPSHOTS */
+            /**
+             * @brief Writes the UTXO set as of a main chain block to a snapshot file
+             * @details The blocks above it are disconnected on a cache over the set, with their
+             *          undo data, the chain itself is left as it is.
+             *
+             * @param path Where the snapshot goes
+             * @param height The height of the block
+             * @return storage::UtxoSnapshotMetadata What was written, with the commitment the
+             *                                       nodes loading the snapshot should trust
+             * @throws ChainException If the main chain has no block at that height, or the data
+             *                        to disconnect a block above it is missing
+             * @throws storage::StorageException If the snapshot can't be written
+             */
+            storage::UtxoSnapshotMetadata ExportSnapshot(const std::string& path, uint32_t height);
+
+            /**
+             * @brief Bootstraps an empty chain from a UTXO snapshot
+             * @details The header chain up to the base block of the snapshot becomes the main
+             *          chain, without the blocks, and the coins of the snapshot become the UTXO
+             *          set (imported in outpoint order into the coins database if the chain is
+             *          backed by a store). Blocks are connected on top of the base block right
+             *          away. The history can be checked in the background by syncing another
+             *          chain from the genesis block and comparing its snapshot commitment at
+             *          the same height. The chain can't reorganize below the base block, and
+             *          GetLastBlock is only valid once a block is connected on top of it.
+             *
+             * @param path The snapshot
+             * @param headers The header chain from the genesis block to the base block
+             * @param commitment The commitment the snapshot is trusted with
+             * @throws ChainException If the chain isn't empty, the headers are invalid or don't
+             *                        end in the base block, or the commitment doesn't match
+             * @throws storage::StorageException If the snapshot is corrupted or can't be read
+             */
+            void LoadSnapshot(const std::string& path, const std::vector<BlockHeader>& headers, const Hash256& commitment);
 
       private:
             std::string name;
-            std::vector<std::unique_ptr<Block>> blocks;     /** Main chain */
-            std::vector<std::unique_ptr<Block>> orphans;    /** Orphan blocks */
+            BlockIndex index;                               /** Every known block (the block tree), by hash */
+            std::vector<BlockNode*> mainChain;              /** Main chain, by height */
+            std::unique_ptr<storage::BlockStore> store;     /** Block store backing the chain, if any */
+            std::unique_ptr<storage::CoinsDatabase> coinsDb;/** Coins database backing the UTXO set, opened with the store */
+            CoinsCache coins;                               /** UTXO set of the main chain (the whole set without a database) */
+            std::size_t coinsCacheSize = DEFAULT_COINS_CACHE_SIZE;
+            std::unique_ptr<threading::ThreadPool> validationPool;     /** Runs the signature checks, if any */
+            Hash256 assumeValid{};                          /** Signatures of its ancestors are not checked */
+            std::unordered_set<Hash256, Hash256Hasher> assumeValidAncestors;    /** Known ancestors not connected yet */
+            bool assumeValidIndexed = false;                /** Whether the ancestors in the block tree were added to the set */
+            std::size_t assumedValidBlocks = 0;             /** Blocks connected without checking their signatures */
+            uint64_t blockFileSize = storage::MAX_BLOCK_FILE_SIZE;   /** Block files are rotated at this size */
+            uint64_t pruneTarget = 0;                       /** Disk usage target of the block store, 0 not to prune */
+            uint32_t pruneDepth = DEFAULT_PRUNE_DEPTH;      /** Blocks below the tip that keep their data */
+            OrphanPool orphans;                             /** Blocks waiting for their parent */
             std::shared_ptr<MemPool> mempool;               /** Memory pool */
 
             /**
-            * @brief Checks if a block is valid given the last block in the chain
-            *
-            * @param lastBlock
-            * @param newBlock
-            * @return
-            */
-            bool BlockHasExpectedHeightAndExtendsMainChain(const Block& newBlock) const;
+             * @brief Validates a block and adds it to the block tree, kept in memory until it
+             *        is either connected or stored
+             *
+             * @param block
+             * @param parent The node of the previous block, nullptr for the genesis block
+             * @param contentChecked Whether HasValidContent already passed, skipping it
+             * @throws ChainException If the block is invalid
+             */
+            BlockNode* AcceptBlock(std::shared_ptr<const Block> block, BlockNode *parent, bool contentChecked);
 
-            bool BlockHasExpectedHeight(const Block& newBlock) const;
-            bool BlockExtendsMainChain(const Block& newBlock) const;
+            /**
+             * @brief Makes the given node the tip of the main chain
+             * @details Disconnects the main chain blocks above the fork point and connects
+             *          the branch ending in tip, each as a single batch. The transactions of
+             *          the disconnected blocks that can still be mined on the new branch (not
+             *          coinbases, nor ones whose input it spent or never had) go back to the
+             *          mempool together. The UTXO changes of the whole reorganization
+             *          are applied to a cache over the UTXO set first, so a block spending
+             *          missing outputs leaves the main chain as it was.
+             *
+             * @param tip A node with more work than the current tip
+             * @throws ChainException If a block of the new branch spends missing outputs, the
+             *                        block and its descendants on the branch are marked invalid
+             */
+            void ActivateBestChain(BlockNode *tip);
 
             /**
-            * @brief Checks if the given block creates a valid fork in the blockchain
-            *
-            * @param blockchain
-            * @param block
-            * @return
-            */
-            [[nodiscard]] bool BlockIsFork(const Block& block) const;
+             * @brief Returns whether a block is an ancestor of the assume-valid block
+             * @details The first call that finds the assume-valid block in the tree adds its
+             *          ancestors that aren't connected yet to the set, so every later call is a
+             *          lookup instead of a walk down the tree.
+             */
+            bool IsAssumedValid(const BlockNode& node);
 
             /**
-             * @brief Handles the fork resolution
-             *
-             * @param block
+             * @brief Deletes the oldest block files while the block store is above the prune target
              */
-            void HandleForkResolution(const Block& block);
+            void PruneBlockFiles();
 
-            /* BLOCKCHAIN FILES */
-            /** Load a Blockchain from a file */
-            void LoadChain(std::string file_path);
-            /** Saves the Blockchain to a file */
-            void SaveChain(std::string file_path);
+            /**
+             * @brief Returns the undo data of a connected block, from memory or from the block store
+             * @return std::shared_ptr<const BlockUndo> The undo data, or nullptr if it isn't available
+             */
+            std::shared_ptr<const BlockUndo> GetUndo(const BlockNode& node) const;
+
+            /**
+             * @brief Opens the coins database of the block store and brings it up to the tip
+             *        of the main chain
+             */
+            void LoadCoins();
+
+            /**
+             * @brief Writes the UTXO cache back to the coins database once it grows past
+             *        coinsCacheSize (or always, if forced)
+             */
+            void FlushCoins(bool force = false);
+
+            /**
+             * @brief Keeps the last BLOCKS_KEPT_IN_MEMORY blocks of the main chain in memory
+             *        and, if the chain is backed by a block store, drops the older ones
+             */
+            void UpdateBlocksInMemory();
       };
 
 } // namespace skynet
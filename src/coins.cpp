@@ -0,0 +1,242 @@
+//
+// Created by JoaoAJMatos on 19/11/2023.
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+/** Local Includes */
+#include "coins.hpp"
+
+
+bool skynet::CoinsView::HaveCoin(const OutPoint& outpoint) const {
+      Coin coin;
+      return GetCoin(outpoint, coin);
+}
+
+/**
+ * @brief Cursor of a CoinsCache: the cursor of the view below and the sorted cached
+ *        entries, walked side by side
+ *
+ * @details A cached entry hides the coin of the view below with the same outpoint, spent
+ *          entries are skipped.
+ */
+class CoinsCacheCursor : public skynet::CoinsCursor
+{
+public:
+      CoinsCacheCursor(std::unique_ptr<skynet::CoinsCursor> base, const skynet::CoinsMap& coins) : base(std::move(base)) {
+            entries.reserve(coins.size());
+            for (const auto& entry : coins) entries.push_back(&entry);
+            std::sort(entries.begin(), entries.end(), [](const auto *a, const auto *b) { return a->first < b->first; });
+            Settle();
+      }
+
+      bool Valid() const override { return valid; }
+      const skynet::OutPoint& GetKey() const override { return fromCache ? entries[next]->first : base->GetKey(); }
+
+      void GetValue(skynet::Coin& coin) const override {
+            if (fromCache) coin = entries[next]->second.coin;
+            else base->GetValue(coin);
+      }
+
+      void Next() override {
+            if (fromCache) next++;
+            else base->Next();
+            Settle();
+      }
+
+private:
+      std::unique_ptr<skynet::CoinsCursor> base;
+      std::vector<const skynet::CoinsMap::value_type*> entries;
+      std::size_t next = 0;               /** The first cached entry not walked yet */
+      bool fromCache = false;             /** Whether the cursor is on a cached entry */
+      bool valid = false;
+
+      /** Moves to the lowest unspent coin of the two, from the current position */
+      void Settle() {
+            for (;;) {
+                  const bool base_valid = base && base->Valid();
+                  if (next == entries.size() || (base_valid && base->GetKey() < entries[next]->first)) {
+                        fromCache = false;
+                        valid = base_valid;
+                        return;
+                  }
+
+                  if (base_valid && base->GetKey() == entries[next]->first) base->Next();
+                  if (!entries[next]->second.coin.spent) {
+                        fromCache = valid = true;
+                        return;
+                  }
+                  next++;
+            }
+      }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Returns the cached entry of an output, fetching it from the view below on a miss
+ *
+ * @param outpoint The output
+ * @return CoinsMap::iterator The entry, or cacheCoins.end() if the output is unknown
+ */
+skynet::CoinsMap::iterator skynet::CoinsCache::FetchCoin(const OutPoint& outpoint) const {
+      auto it = cacheCoins.find(outpoint);
+      if (it != cacheCoins.end() || base == nullptr) return it;
+
+      Coin coin;
+      if (!base->GetCoin(outpoint, coin)) return cacheCoins.end();
+
+      it = cacheCoins.emplace(outpoint, CoinsCacheEntry{ std::move(coin), 0 }).first;
+      return it;
+}
+
+bool skynet::CoinsCache::GetCoin(const OutPoint& outpoint, Coin& coin) const {
+      auto it = FetchCoin(outpoint);
+      if (it == cacheCoins.end() || it->second.coin.spent) return false;
+
+      coin = it->second.coin;
+      return true;
+}
+
+bool skynet::CoinsCache::HaveCoin(const OutPoint& outpoint) const {
+      auto it = FetchCoin(outpoint);
+      return it != cacheCoins.end() && !it->second.coin.spent;
+}
+
+Hash256 skynet::CoinsCache::GetBestBlock() const {
+      if (bestBlock == Hash256{} && base != nullptr) bestBlock = base->GetBestBlock();
+      return bestBlock;
+}
+
+std::unique_ptr<skynet::CoinsCursor> skynet::CoinsCache::Cursor() const {
+      return std::make_unique<CoinsCacheCursor>(base ? base->Cursor() : nullptr, cacheCoins);
+}
+
+/**
+ * @brief Adds a new coin to the cache
+ *
+ * @details A coin added over an entry that isn't dirty can't be in the view below (or it
+ *          would be unspent there), so it is FRESH unless it may overwrite an unspent coin.
+ *
+ * @param outpoint The output
+ * @param coin The coin
+ * @param possibleOverwrite Whether the output may already be unspent
+ * @throws std::logic_error If the output is unspent and possibleOverwrite is false
+ */
+void skynet::CoinsCache::AddCoin(const OutPoint& outpoint, Coin coin, bool possibleOverwrite) {
+      auto it = cacheCoins.try_emplace(outpoint).first;
+
+      bool fresh = false;
+      if (!possibleOverwrite) {
+            if (!it->second.coin.spent) {
+                  throw std::logic_error("Adding a coin over an unspent one");
+            }
+            fresh = !(it->second.flags & CoinsCacheEntry::DIRTY);
+      }
+
+      it->second.coin = std::move(coin);
+      it->second.coin.spent = false;
+      it->second.flags |= CoinsCacheEntry::DIRTY | (fresh ? CoinsCacheEntry::FRESH : 0);
+}
+
+/**
+ * @brief Spends a coin, forgetting it altogether if the view below never saw it
+ *
+ * @param outpoint The output
+ * @param spent Set to the coin before it was spent, if not nullptr
+ * @return true If the output was unspent
+ */
+bool skynet::CoinsCache::SpendCoin(const OutPoint& outpoint, Coin *spent) {
+      auto it = FetchCoin(outpoint);
+      if (it == cacheCoins.end() || it->second.coin.spent) return false;
+
+      if (spent != nullptr) *spent = it->second.coin;
+
+      /** Without a view below, the cache is the whole set */
+      if ((it->second.flags & CoinsCacheEntry::FRESH) || base == nullptr) {
+            cacheCoins.erase(it);
+      } else {
+            it->second.flags |= CoinsCacheEntry::DIRTY;
+            it->second.coin.spent = true;
+      }
+      return true;
+}
+
+/**
+ * @brief Applies the dirty entries of a cache stacked on this one
+ *
+ * @param coins The entries of the cache above
+ * @param bestBlock The block the entries bring this cache up to
+ * @throws std::logic_error If a FRESH coin from above is unspent here
+ */
+void skynet::CoinsCache::BatchWrite(CoinsMap& coins, const Hash256& bestBlock) {
+      for (auto& [outpoint, entry] : coins) {
+            if (!(entry.flags & CoinsCacheEntry::DIRTY)) continue;
+
+            auto it = cacheCoins.find(outpoint);
+            if (it == cacheCoins.end()) {
+                  /** Created and spent above, this view never has to know */
+                  if ((entry.flags & CoinsCacheEntry::FRESH) && entry.coin.spent) continue;
+
+                  CoinsCacheEntry& added = cacheCoins[outpoint];
+                  added.coin = std::move(entry.coin);
+                  added.flags = CoinsCacheEntry::DIRTY | (entry.flags & CoinsCacheEntry::FRESH);
+                  continue;
+            }
+
+            if ((entry.flags & CoinsCacheEntry::FRESH) && !it->second.coin.spent) {
+                  throw std::logic_error("A fresh coin is unspent in the view below");
+            }
+
+            if ((it->second.flags & CoinsCacheEntry::FRESH) && entry.coin.spent) {
+                  cacheCoins.erase(it);
+            } else {
+                  it->second.coin = std::move(entry.coin);
+                  it->second.flags |= CoinsCacheEntry::DIRTY;
+            }
+      }
+
+      this->bestBlock = bestBlock;
+}
+
+void skynet::CoinsCache::Flush() {
+      if (base == nullptr) return;
+
+      base->BatchWrite(cacheCoins, GetBestBlock());
+      cacheCoins.clear();
+}
+
+/**
+ * @brief Estimates the memory used by the cache: its nodes (entry plus the next pointer
+ *        and cached hash of the node) and its bucket array
+ */
+std::size_t skynet::CoinsCache::DynamicMemoryUsage() const {
+      return cacheCoins.size() * (sizeof(CoinsMap::value_type) + 2 * sizeof(void*)) +
+             cacheCoins.bucket_count() * sizeof(void*);
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,311 @@
+/**
+ * @file    coins.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   The UTXO set: every transaction output that hasn't been spent yet, keyed
+ *          by the output it is (TXID, output index).
+ *
+ *          Views of the set are stacked: the on disk database sits at the bottom and
+ *          a large write-back cache (CoinsCache) in front of it absorbs the lookups,
+ *          spends and new outputs of connected blocks. Every cached entry carries two
+ *          flags:
+ *
+ *            DIRTY  The entry differs from the view below and must be written back.
+ *            FRESH  The view below doesn't have the coin, so if it is spent before
+ *                   being written back, it can simply be forgotten.
+ *
+ *          Most outputs are spent soon after being created, FRESH lets those never
+ *          reach the disk. The cache is written back in a single batch, once it grows
+ *          past a memory threshold.
+ *
+ * @date    2023-11-19
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ */
+
+#ifndef SKYNET_COINS_HPP
+#define SKYNET_COINS_HPP
+
+/** C++ Includes */
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/** Skynet Includes */
+#include <types.hpp>
+#include <serialize.hpp>
+#include <transaction.hpp>
+
+namespace skynet
+{
+      /** Default memory threshold of the UTXO cache, in bytes */
+      constexpr std::size_t DEFAULT_COINS_CACHE_SIZE = 256 * 1024 * 1024;
+
+      /**
+       * @brief A reference to a transaction output
+       */
+      struct OutPoint {
+            TransactionHash txid{};             /** Hash of the transaction */
+            uint32_t index = 0;                 /** Index of the output in the transaction */
+
+            /** Size of a serialized outpoint */
+            static constexpr std::size_t SERIALIZED_SIZE = 36;
+
+            OutPoint() = default;
+            OutPoint(const TransactionHash& txid, uint32_t index) : txid(txid), index(index) {}
+
+            bool operator==(const OutPoint& outpoint) const { return txid == outpoint.txid && index == outpoint.index; }
+            bool operator!=(const OutPoint& outpoint) const { return !(*this == outpoint); }
+            bool operator<(const OutPoint& outpoint) const { return txid < outpoint.txid || (txid == outpoint.txid && index < outpoint.index); }
+      };
+
+      struct OutPointHasher {
+            std::size_t operator()(const OutPoint& outpoint) const noexcept {
+                  return Hash256Hasher{}(outpoint.txid) ^ (static_cast<std::size_t>(outpoint.index) * 0x9e3779b97f4a7c15ull);
+            }
+      };
+
+      /**
+       * @brief An unspent transaction output, with what validation needs to know about it
+       */
+      struct Coin {
+            TransactionOutput output;           /** The output */
+            uint32_t height = 0;                /** Height of the block that created it */
+            bool coinbase = false;              /** Whether it was created by a coinbase transaction */
+            bool spent = true;                  /** Set once the coin is spent (default constructed coins are) */
+
+            Coin() = default;
+            Coin(const TransactionOutput& output, uint32_t height, bool coinbase)
+                  : output(output), height(height), coinbase(coinbase), spent(false) {}
+      };
+
+      /**
+       * @brief A cached coin and its cache flags
+       */
+      struct CoinsCacheEntry {
+            enum Flags : uint8_t {
+                  DIRTY = 1 << 0,               /** Differs from the view below */
+                  FRESH = 1 << 1,               /** The view below doesn't have it */
+            };
+
+            Coin coin;
+            uint8_t flags = 0;
+      };
+
+      using CoinsMap = std::unordered_map<OutPoint, CoinsCacheEntry, OutPointHasher>;
+
+      /**
+       * @brief Walks the unspent coins of a view in outpoint order, one at a time
+       *
+       * @details The view must not change while the cursor is open.
+       */
+      class CoinsCursor
+      {
+      public:
+            virtual ~CoinsCursor() = default;
+
+            /** Returns whether the cursor is on a coin, false once it went past the last one */
+            virtual bool Valid() const = 0;
+
+            /** Returns the output the cursor is on */
+            virtual const OutPoint& GetKey() const = 0;
+
+            /** Reads the coin the cursor is on */
+            virtual void GetValue(Coin& coin) const = 0;
+
+            /** Moves to the next coin */
+            virtual void Next() = 0;
+      };
+
+      /**
+       * @brief A view of the UTXO set
+       */
+      class CoinsView
+      {
+      public:
+            virtual ~CoinsView() = default;
+
+            /**
+             * @brief Looks an unspent coin up
+             *
+             * @param outpoint The output
+             * @param coin Set to the coin if it is found
+             * @return true If the output exists and is unspent
+             */
+            virtual bool GetCoin(const OutPoint& outpoint, Coin& coin) const = 0;
+
+            /** Returns whether the output exists and is unspent */
+            virtual bool HaveCoin(const OutPoint& outpoint) const;
+
+            /** Returns the hash of the block the view is up to date with (all zero if none) */
+            virtual Hash256 GetBestBlock() const = 0;
+
+            /** Returns a cursor on the first unspent coin of the view */
+            virtual std::unique_ptr<CoinsCursor> Cursor() const = 0;
+
+            /**
+             * @brief Applies the dirty entries of a cache in front of this view
+             *
+             * @param coins The entries, left in an unspecified state
+             * @param bestBlock The block the entries bring the view up to
+             */
+            virtual void BatchWrite(CoinsMap& coins, const Hash256& bestBlock) = 0;
+      };
+
+      /**
+       * @brief Write-back cache over another view (or standalone, without one)
+       *
+       * @details Lookups are const but fill the cache. Not thread safe.
+       */
+      class CoinsCache : public CoinsView
+      {
+      public:
+            /**
+             * @param base The view below, nullptr for a cache that is the whole set
+             */
+            explicit CoinsCache(CoinsView *base = nullptr) : base(base) {}
+
+            CoinsCache(const CoinsCache&) = delete;
+            CoinsCache& operator=(const CoinsCache&) = delete;
+
+            bool GetCoin(const OutPoint& outpoint, Coin& coin) const override;
+            bool HaveCoin(const OutPoint& outpoint) const override;
+            Hash256 GetBestBlock() const override;
+            void BatchWrite(CoinsMap& coins, const Hash256& bestBlock) override;
+
+            /**
+             * @brief Returns a cursor merging the coins of the view below with the cached entries
+             * @details Only the cached entries are sorted up front, the view below is walked by
+             *          its own cursor. Lookups fill the cache, so none can be made while the
+             *          cursor is open.
+             */
+            std::unique_ptr<CoinsCursor> Cursor() const override;
+
+            /**
+             * @brief Adds a new coin
+             *
+             * @param outpoint The output
+             * @param coin The coin
+             * @param possibleOverwrite Whether the output may already be unspent (coinbase
+             *                          transactions can repeat a TXID)
+             * @throws std::logic_error If the output is unspent and possibleOverwrite is false
+             */
+            void AddCoin(const OutPoint& outpoint, Coin coin, bool possibleOverwrite);
+
+            /**
+             * @brief Spends a coin
+             *
+             * @param outpoint The output
+             * @param spent Set to the coin before it was spent, if not nullptr
+             * @return true If the output existed and was unspent
+             */
+            bool SpendCoin(const OutPoint& outpoint, Coin *spent = nullptr);
+
+            void SetBestBlock(const Hash256& hash) { bestBlock = hash; }
+
+            /** Changes the view below, the cache must have been flushed (or be about to be rebuilt) */
+            void SetBase(CoinsView *base) { this->base = base; }
+
+            /** Drops every cached entry without writing them back */
+            void Clear() { cacheCoins.clear(); bestBlock = Hash256{}; }
+
+            /**
+             * @brief Writes the dirty entries back to the view below in one batch and empties the cache
+             * @details Does nothing without a view below.
+             */
+            void Flush();
+
+            /** Returns an estimate of the memory used by the cache, in bytes */
+            std::size_t DynamicMemoryUsage() const;
+
+            /** Returns the number of cached entries */
+            std::size_t Size() const { return cacheCoins.size(); }
+
+      private:
+            CoinsView *base;
+            mutable CoinsMap cacheCoins;
+            mutable Hash256 bestBlock{};
+
+            /** Returns the cached entry of an output, fetching it from the view below if needed */
+            CoinsMap::iterator FetchCoin(const OutPoint& outpoint) const;
+      };
+
+      /**
+       * @brief What it takes to disconnect a block: the coins its transactions spent, in order
+       */
+      struct BlockUndo {
+            std::vector<Coin> spent;
+      };
+
+} // namespace skynet
+
+/**
+ * @brief Outpoint serialization: txid (32) | index (u32)
+ */
+template<>
+struct serialize::Serializer<skynet::OutPoint> {
+      template<typename Stream>
+      static void Write(Stream& stream, const skynet::OutPoint& outpoint) {
+            Serialize(stream, outpoint.txid);
+            Serialize(stream, outpoint.index);
+      }
+
+      static void Read(ReadBuffer& reader, skynet::OutPoint& outpoint) {
+            Unserialize(reader, outpoint.txid);
+            Unserialize(reader, outpoint.index);
+      }
+};
+
+/**
+ * @brief Compact coin serialization, unspent coins only:
+ *        CompactSize(height * 2 + coinbase) | value (int32) | recipient (33)
+ */
+template<>
+struct serialize::Serializer<skynet::Coin> {
+      template<typename Stream>
+      static void Write(Stream& stream, const skynet::Coin& coin) {
+            WriteCompactSize(stream, (static_cast<uint64_t>(coin.height) << 1) | (coin.coinbase ? 1 : 0));
+            Serialize(stream, coin.output);
+      }
+
+      static void Read(ReadBuffer& reader, skynet::Coin& coin) {
+            const uint64_t code = ReadCompactSize(reader, (uint64_t(UINT32_MAX) << 1) | 1);
+            coin.height = static_cast<uint32_t>(code >> 1);
+            coin.coinbase = code & 1;
+            coin.spent = false;
+            Unserialize(reader, coin.output);
+      }
+};
+
+template<>
+struct serialize::Serializer<skynet::BlockUndo> {
+      template<typename Stream>
+      static void Write(Stream& stream, const skynet::BlockUndo& undo) { Serialize(stream, undo.spent); }
+      static void Read(ReadBuffer& reader, skynet::BlockUndo& undo) { Unserialize(reader, undo.spent); }
+};
+
+#endif // SKYNET_COINS_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
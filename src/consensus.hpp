@@ -15,6 +15,7 @@
 #define SKYNET_CONSENSUS_HPP
 
 /** C++ Includes */
+#include <cstdint>
 #include <ctime>
 
 
@@ -22,6 +23,7 @@ namespace skynet::consensus
 {
       /** [ BLOCKCHAIN ] */
       constexpr float VERSION = 1.0;
+      constexpr uint32_t BLOCK_VERSION = 1;                /** The version of the block format */
       constexpr int MAINNET_ADDRESS_PREFIX = 0x00;         /** The prefix of the mainnet addresses */
       constexpr int TESTNET_ADDRESS_PREFIX = 0x6F;         /** The prefix of the testnet addresses */
 
@@ -47,7 +49,7 @@ namespace skynet::consensus
        * @param height The height of the block
        * @return int The difficulty of the block
        */
-      int GetBlockSubsidy(int height) {
+      inline int GetBlockSubsidy(int height) {
             return INITIAL_SUBSIDY >> (height / DIFFICULTY_ADJUSTMENT_INTERVAL);
       }
 
@@ -60,7 +62,7 @@ namespace skynet::consensus
        * @param lastTimestamp The timestamp of the last block
        * @param currentTimestamp The current timestamp
        */
-      int AdjustDifficulty(int lastDifficulty, std::time_t lastTimestamp, std::time_t currentTimestamp) {
+      inline int AdjustDifficulty(int lastDifficulty, std::time_t lastTimestamp, std::time_t currentTimestamp) {
             int timeExpected = MINING_RATE * DIFFICULTY_ADJUSTMENT_INTERVAL;
             int timeTaken = currentTimestamp - lastTimestamp;
             
@@ -26,10 +26,9 @@ static constexpr char BASE58_ALPHABET[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcd
  * @param data The data to be hashed
  * @return std::vector<byte> The double SHA256 hash
  */
-static std::vector<byte> double_sha256(std::vector<byte> data) {
-      std::vector<byte> hash;
-      crypto::hashing::SHA256(data.data(), data.size(), hash.data());
-      crypto::hashing::SHA256(hash.data(), hash.size(), hash.data());
+static std::vector<byte> double_sha256(const std::vector<byte>& data) {
+      std::vector<byte> hash(crypto::hashing::SHA256_HASH_SIZE);
+      crypto::hashing::DoubleSHA256(data.data(), data.size(), hash.data());
       return hash;
 }
 
@@ -52,8 +52,8 @@ static bool validate_entropy(std::vector<byte> entropy) {
  * @return byte The checksum calculated.
  */
 static byte calculate_checksum(std::vector<byte> entropy) {
-      std::vector<byte> hash;
-      crypto::hashing::SHA256(entropy.data(), entropy.size(), hash.data());
+      byte hash[crypto::hashing::SHA256_HASH_SIZE];
+      crypto::hashing::SHA256(entropy.data(), entropy.size(), hash);
       return hash[0] >> (8 - entropy.size() / 4);
 }
 
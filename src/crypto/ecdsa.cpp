@@ -116,6 +116,48 @@ void crypto::ecdsa::generate_key_pair(Context context, KeyPair* key_pair) {
       }
 }
 
+/**
+ * @brief Signs a 32 byte message (a hash) with the private key of a key pair
+ * 
+ * @param[i] context The ECDSA context (created for signing)
+ * @param[i] key_pair The signer's key pair
+ * @param[i] message The 32 byte message
+ * @param[o] signature The compact (64 byte) signature
+ * @throws crypto::ecdsa::Exception
+ */
+void crypto::ecdsa::sign(Context context, KeyPair* key_pair, byte* message, Signature signature) {
+      secp256k1_ecdsa_signature parsed;
+
+      if (!secp256k1_ecdsa_sign(context, &parsed, message, key_pair->private_key, nullptr, nullptr)) {
+            throw crypto::ecdsa::Exception("Error signing the message");
+      }
+
+      secp256k1_ecdsa_signature_serialize_compact(context, signature, &parsed);
+}
+
+/**
+ * @brief Verifies the compact signature of a 32 byte message (a hash)
+ * 
+ * @details Verification doesn't need a context of its own, the static one is used when
+ *          context is nullptr. Safe to call from several threads at once.
+ * 
+ * @param[i] context The ECDSA context, or nullptr
+ * @param[i] message The 32 byte message
+ * @param[i] signature The compact (64 byte) signature
+ * @param[i] public_key The compressed public key of the signer
+ * @return true If the signature is valid (malleated high S signatures are rejected)
+ */
+bool crypto::ecdsa::verify(Context context, const byte* message, const Signature signature, const PublicKey public_key) {
+      const secp256k1_context *verifier = context != nullptr ? context : secp256k1_context_static;
+      secp256k1_pubkey key;
+      secp256k1_ecdsa_signature parsed;
+
+      if (!secp256k1_ec_pubkey_parse(verifier, &key, public_key, COMPRESSED_PUBLIC_KEY_SIZE)) return false;
+      if (!secp256k1_ecdsa_signature_parse_compact(verifier, &parsed, signature)) return false;
+
+      return secp256k1_ecdsa_verify(verifier, &parsed, message, &key) == 1;
+}
+
 // MIT License
 // 
 // Copyright (c) 2023 João Matos
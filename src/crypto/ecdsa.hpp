@@ -124,6 +124,7 @@ namespace crypto::ecdsa
 
       /**
        * @brief Verifies a signature using the given public key
+       * @details Thread safe, context may be nullptr.
        * 
        * @param context 
        * @param message 
@@ -132,7 +133,7 @@ namespace crypto::ecdsa
        * @return true 
        * @return false 
        */
-      bool verify(Context context, byte* message, Signature signature, PublicKey public_key);
+      bool verify(Context context, const byte* message, const Signature signature, const PublicKey public_key);
 
 } // namespace crypto::ecdsa
 
@@ -59,6 +59,7 @@
 #include <stddef.h>
 #include <limits.h>
 #include <stdio.h>
+#include <time.h>
 
 namespace crypto::random
 {
@@ -91,7 +92,7 @@ namespace crypto::random
        * @param size The size of the buffer.
        * @return int 1 if the operation was successful, 0 otherwise.
        */
-      int fill_random(byte* data, size_t size) {
+      inline int fill_random(byte* data, size_t size) {
 #if defined(_WIN32)
             if (BCryptGenRandom(NULL, data, size, BCRYPT_USE_SYSTEM_PREFERRED_RNG) != STATUS_SUCCESS) {
                   return 0;
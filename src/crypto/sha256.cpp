@@ -4,9 +4,34 @@
 
 /* C++ includes */
 #include <fstream>
+#include <algorithm>
+#include <future>
+#include <memory>
+
+#ifdef __has_include
+#if __has_include(<cpuid.h>)
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SKYNET_SHA256_POSIX_IO 1
+#endif
 
 /* Skynet includes */
+#include <macros.hpp>
+#include <threading/threadpool.hpp>
 #include "sha256.hpp"
+#include "sha256_kernels.hpp"
+
+/* File hashing buffer sizes */
+constexpr size_t FILE_READ_BUFFER_SIZE = 1 << 20;       /* 1 MiB per read */
+constexpr uint64_t FILE_MMAP_WINDOW_SIZE = 1 << 26;     /* 64 MiB mapped at a time */
 
 /* Rotates a word to the left/right by n bits */
 #define ROTATE_LEFT(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
@@ -20,17 +45,11 @@
 #define SIGMA_0(x) (ROTATE_RIGHT(x, 7) ^ ROTATE_RIGHT(x, 18) ^ ((x) >> 3))
 #define SIGMA_1(x) (ROTATE_RIGHT(x, 17) ^ ROTATE_RIGHT(x, 19) ^ ((x) >> 10))
 
-/* Constants */
-/* The first 32 bits of the fractional parts of the cube roots of the first 64 primes 2..311 */
-constexpr std::array<word, 64> K = {
-    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+using crypto::hashing::kernels::K;
+
+/* The first 32 bits of the fractional parts of the square roots of the first 8 primes 2..19 */
+constexpr word SHA256_INITIAL_STATE[crypto::hashing::SHA256_STATE_SIZE] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
 };
 
 static void sha256_transform(word *state, const byte *data) {
@@ -71,9 +90,147 @@ static void sha256_transform(word *state, const byte *data) {
       state[7] += h;
 }
 
+/**
+ * @brief Portable kernel, compresses the given blocks one at a time.
+ */
+void crypto::hashing::kernels::transform_generic(word *state, const byte *data, size_t blocks) {
+      for (; blocks > 0; --blocks, data += crypto::hashing::SHA256_BLOCK_SIZE) {
+            sha256_transform(state, data);
+      }
+}
+
+#ifdef SKYNET_SHA256_X86
+/**
+ * @brief Reads the x86 CPUID feature flags we care about.
+ */
+struct CpuFeatures {
+      bool ssse3 = false;
+      bool sse41 = false;
+      bool avx2 = false;
+      bool sha = false;
+};
+
+static CpuFeatures read_cpu_features() {
+      CpuFeatures features;
+      unsigned int eax, ebx, ecx, edx;
+
+      if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return features;
+      features.ssse3 = (ecx >> 9) & 1;
+      features.sse41 = (ecx >> 19) & 1;
+
+      /* AVX registers are only usable if the OS saves them on context switches */
+      bool os_saves_ymm = false;
+      if (((ecx >> 27) & 1) && ((ecx >> 28) & 1)) {
+            unsigned int xcr0_lo, xcr0_hi;
+            __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+            os_saves_ymm = (xcr0_lo & 0x6) == 0x6;
+      }
+
+      if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return features;
+      features.avx2 = os_saves_ymm && ((ebx >> 5) & 1);
+      features.sha = (ebx >> 29) & 1;
+      return features;
+}
+#endif // SKYNET_SHA256_X86
+
+/**
+ * @brief Checks if the CPU (and OS) support the instructions used by the given backend.
+ */
+static bool cpu_supports(crypto::hashing::Backend backend) {
+#ifdef SKYNET_SHA256_X86
+      static const CpuFeatures features = read_cpu_features();
+#endif
+
+      switch (backend) {
+            case crypto::hashing::Backend::GENERIC: return true;
+#ifdef SKYNET_SHA256_X86
+            case crypto::hashing::Backend::SHA_NI: return features.sha && features.ssse3 && features.sse41;
+            case crypto::hashing::Backend::SSE4: return features.sse41;
+            case crypto::hashing::Backend::AVX2: return features.avx2;
+#else
+            case crypto::hashing::Backend::SHA_NI:
+            case crypto::hashing::Backend::SSE4:
+            case crypto::hashing::Backend::AVX2: return false;
+#endif
+      } // no default case to force compiler warning
+
+      return false;
+}
+
+/**
+ * @brief Returns the single buffer kernel that implements the given backend.
+ *        Multi buffer backends fall back to the generic kernel for single messages.
+ */
+static crypto::hashing::kernels::TransformFunction kernel_for(crypto::hashing::Backend backend) {
+#ifdef SKYNET_SHA256_X86
+      if (backend == crypto::hashing::Backend::SHA_NI) return crypto::hashing::kernels::transform_shani;
+#endif
+      return crypto::hashing::kernels::transform_generic;
+}
+
+/**
+ * @brief Picks the fastest backend supported by the running CPU.
+ *
+ * @details SHA-NI keeps up with the 8 lane kernel on batches and is much faster
+ *          on single messages, so it is preferred whenever it is available.
+ */
+static crypto::hashing::Backend detect_backend() {
+      if (cpu_supports(crypto::hashing::Backend::SHA_NI)) return crypto::hashing::Backend::SHA_NI;
+      if (cpu_supports(crypto::hashing::Backend::AVX2)) return crypto::hashing::Backend::AVX2;
+      if (cpu_supports(crypto::hashing::Backend::SSE4)) return crypto::hashing::Backend::SSE4;
+      return crypto::hashing::Backend::GENERIC;
+}
+
+/**
+ * @brief Currently selected backend. Detected once on first use.
+ */
+static crypto::hashing::Backend& active_backend() {
+      static crypto::hashing::Backend backend = detect_backend();
+      return backend;
+}
+
+/**
+ * @brief Kernel for the currently selected backend.
+ */
+static crypto::hashing::kernels::TransformFunction& active_transform() {
+      static crypto::hashing::kernels::TransformFunction transform = kernel_for(active_backend());
+      return transform;
+}
+
+crypto::hashing::Backend crypto::hashing::GetBackend() {
+      return active_backend();
+}
+
+bool crypto::hashing::BackendSupported(Backend backend) {
+      return cpu_supports(backend);
+}
+
+bool crypto::hashing::SetBackend(Backend backend) {
+      if (!cpu_supports(backend)) return false;
+      active_backend() = backend;
+      active_transform() = kernel_for(backend);
+      return true;
+}
+
+std::string crypto::hashing::BackendToString(Backend backend) {
+      switch (backend) {
+            case crypto::hashing::Backend::GENERIC: return "generic";
+            case crypto::hashing::Backend::SHA_NI: return "sha-ni";
+            case crypto::hashing::Backend::SSE4: return "sse4";
+            case crypto::hashing::Backend::AVX2: return "avx2";
+      } // no default case to force compiler warning
+
+      return "unknown";
+}
+
+crypto::hashing::SHA256::SHA256() {
+      Init();
+}
+
 crypto::hashing::SHA256::SHA256(const byte* data, size_t len, byte* out) {
       Init();
-      Hash(data, len, out);
+      Update(data, len);
+      Final(out);
 }
 
 crypto::hashing::SHA256::SHA256(const std::string& filename, byte* out) {
@@ -91,15 +248,50 @@ crypto::hashing::SHA256::~SHA256() {
 void crypto::hashing::SHA256::Init() {
       this->data_size = 0;
       this->bit_len = 0;
-      this->state[0] = 0x6a09e667;
-      this->state[1] = 0xbb67ae85;
-      this->state[2] = 0x3c6ef372;
-      this->state[3] = 0xa54ff53a;
-      this->state[4] = 0x510e527f;
-      this->state[5] = 0x9b05688c;
-      this->state[6] = 0x1f83d9ab;
-      this->state[7] = 0x5be0cd19;
+      memcpy(this->state, SHA256_INITIAL_STATE, sizeof(this->state));
+}
+/**
+ * @brief Feeds data into the hash.
+ *
+ * @details Whole blocks are compressed straight from the input buffer, only
+ *          the leftovers are copied into the context.
+ */
+crypto::hashing::SHA256& crypto::hashing::SHA256::Update(const byte *input, size_t len) {
+      const auto transform = active_transform();
+
+      /* Top up a partially filled block first */
+      if (this->data_size > 0) {
+            size_t fill = std::min(static_cast<size_t>(crypto::hashing::SHA256_BLOCK_SIZE - this->data_size), len);
+            memcpy(this->data + this->data_size, input, fill);
+            this->data_size += fill;
+            input += fill;
+            len -= fill;
+
+            if (this->data_size < crypto::hashing::SHA256_BLOCK_SIZE) return *this;
+
+            transform(this->state, this->data, 1);
+            this->bit_len += 512;
+            this->data_size = 0;
+      }
+
+      /* Compress all the remaining whole blocks in a single kernel call */
+      size_t blocks = len / crypto::hashing::SHA256_BLOCK_SIZE;
+      if (blocks > 0) {
+            transform(this->state, input, blocks);
+            this->bit_len += blocks * 512;
+            input += blocks * crypto::hashing::SHA256_BLOCK_SIZE;
+            len -= blocks * crypto::hashing::SHA256_BLOCK_SIZE;
+      }
+
+      /* Keep the leftovers for the next call */
+      if (len > 0) {
+            memcpy(this->data, input, len);
+            this->data_size = len;
+      }
+
+      return *this;
 }
+
 /**
  * @brief Finalizes the hash and sets the digest.
  */
@@ -116,7 +308,7 @@ void crypto::hashing::SHA256::Final(byte *hash) {
             while (i < 64) {
                   this->data[i++] = 0x00;
             }
-            sha256_transform(this->state, this->data);
+            active_transform()(this->state, this->data, 1);
             memset(this->data, 0, 56);
       }
 
@@ -129,7 +321,7 @@ void crypto::hashing::SHA256::Final(byte *hash) {
       this->data[58] = this->bit_len >> 40;
       this->data[57] = this->bit_len >> 48;
       this->data[56] = this->bit_len >> 56;
-      sha256_transform(this->state, this->data);
+      active_transform()(this->state, this->data, 1);
 
       // Reverse the byte order since we are using little endian (SHA256 uses big endian).
       for (i = 0; i < 4; ++i) {
@@ -157,30 +349,339 @@ void crypto::hashing::SHA256::Hash(const byte *input_data, size_t len, byte *has
       memset(&sha256, 0, sizeof(crypto::hashing::SHA256));
 }
 
+/**
+ * @brief Hashes groups of LANES equal length messages with a multi buffer kernel.
+ *
+ * @details Every lane walks through the whole blocks of its own message, then
+ *          through a padded copy of its tail. Since all messages have the same
+ *          length, the padding layout is the same for every lane.
+ */
+template <size_t LANES>
+static void hash_lanes(crypto::hashing::kernels::MultiTransformFunction kernel, const byte *data, size_t len, size_t groups, byte *out) {
+      const size_t full_blocks = len / crypto::hashing::SHA256_BLOCK_SIZE;
+      const size_t tail_size = len % crypto::hashing::SHA256_BLOCK_SIZE;
+      const size_t tail_blocks = tail_size < 56 ? 1 : 2;
+      const unsigned long long bit_len = static_cast<unsigned long long>(len) * 8;
+
+      byte tails[LANES][2 * crypto::hashing::SHA256_BLOCK_SIZE];
+      word state[crypto::hashing::SHA256_STATE_SIZE * LANES];
+      const byte *blocks[LANES];
+
+      for (size_t group = 0; group < groups; ++group, data += LANES * len, out += LANES * crypto::hashing::SHA256_HASH_SIZE) {
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                  for (int i = 0; i < crypto::hashing::SHA256_STATE_SIZE; ++i) {
+                        state[i * LANES + lane] = SHA256_INITIAL_STATE[i];
+                  }
+            }
+
+            for (size_t block = 0; block < full_blocks; ++block) {
+                  for (size_t lane = 0; lane < LANES; ++lane) {
+                        blocks[lane] = data + lane * len + block * crypto::hashing::SHA256_BLOCK_SIZE;
+                  }
+                  kernel(state, blocks);
+            }
+
+            /* Padding: 0x80, zeros and the big endian bit length at the end of the last block */
+            const size_t tail_end = tail_blocks * crypto::hashing::SHA256_BLOCK_SIZE;
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                  memcpy(tails[lane], data + lane * len + full_blocks * crypto::hashing::SHA256_BLOCK_SIZE, tail_size);
+                  tails[lane][tail_size] = 0x80;
+                  memset(tails[lane] + tail_size + 1, 0, tail_end - tail_size - 1);
+                  for (int i = 0; i < 8; ++i) {
+                        tails[lane][tail_end - 1 - i] = static_cast<byte>(bit_len >> (i * 8));
+                  }
+            }
+
+            for (size_t block = 0; block < tail_blocks; ++block) {
+                  for (size_t lane = 0; lane < LANES; ++lane) {
+                        blocks[lane] = tails[lane] + block * crypto::hashing::SHA256_BLOCK_SIZE;
+                  }
+                  kernel(state, blocks);
+            }
+
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                  byte *digest = out + lane * crypto::hashing::SHA256_HASH_SIZE;
+                  for (int i = 0; i < crypto::hashing::SHA256_STATE_SIZE; ++i) {
+                        word value = state[i * LANES + lane];
+                        digest[i * 4] = value >> 24;
+                        digest[i * 4 + 1] = value >> 16;
+                        digest[i * 4 + 2] = value >> 8;
+                        digest[i * 4 + 3] = value;
+                  }
+            }
+      }
+}
+
+/**
+ * @brief Hashes a batch of equal length messages.
+ *
+ * @param data The messages, stored back to back
+ * @param len The length of each message
+ * @param count The number of messages
+ * @param out The digests, stored back to back
+ */
+void crypto::hashing::SHA256::HashMany(const byte *data, size_t len, size_t count, byte *out) {
+      size_t done = 0;
+
+#ifdef SKYNET_SHA256_X86
+      const Backend backend = active_backend();
+
+      if (backend == Backend::AVX2 && count - done >= 8) {
+            size_t groups = (count - done) / 8;
+            hash_lanes<8>(crypto::hashing::kernels::transform_8way_avx2, data, len, groups, out);
+            done += groups * 8;
+      }
+
+      /* SSE4.1 is a subset of AVX2, so it also takes care of the AVX2 leftovers */
+      if ((backend == Backend::AVX2 || backend == Backend::SSE4) && count - done >= 4) {
+            size_t groups = (count - done) / 4;
+            hash_lanes<4>(crypto::hashing::kernels::transform_4way_sse41, data + done * len, len, groups, out + done * SHA256_HASH_SIZE);
+            done += groups * 4;
+      }
+#endif // SKYNET_SHA256_X86
+
+      for (; done < count; ++done) {
+            Hash(data + done * len, len, out + done * SHA256_HASH_SIZE);
+      }
+}
+
+#ifdef SKYNET_SHA256_POSIX_IO
+/**
+ * @brief Feeds a file into the hash through a sliding memory mapped window.
+ *
+ * @details The window is unmapped as soon as it has been hashed, so hashing a
+ *          multi-GB file doesn't pin the whole file in our address space.
+ *
+ * @return False if the file could not be mapped (the caller falls back to pread).
+ */
+static bool hash_file_mmap(int fd, uint64_t size, crypto::hashing::SHA256& sha256) {
+      for (uint64_t offset = 0; offset < size; offset += FILE_MMAP_WINDOW_SIZE) {
+            const size_t length = static_cast<size_t>(std::min<uint64_t>(FILE_MMAP_WINDOW_SIZE, size - offset));
+            void *window = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+
+            if (window == MAP_FAILED) {
+                  /* Can only fall back if nothing was hashed yet */
+                  if (offset == 0) return false;
+                  throw std::runtime_error("Could not map file.");
+            }
+
+            madvise(window, length, MADV_SEQUENTIAL);
+            sha256.Update(static_cast<const byte *>(window), length);
+            munmap(window, length);
+      }
+
+      return true;
+}
+
+/**
+ * @brief Feeds a file into the hash with large positional reads.
+ */
+static void hash_file_pread(int fd, crypto::hashing::SHA256& sha256) {
+      auto buffer = std::make_unique<byte[]>(FILE_READ_BUFFER_SIZE);
+      uint64_t offset = 0;
+
+      loop() {
+            ssize_t bytes = pread(fd, buffer.get(), FILE_READ_BUFFER_SIZE, static_cast<off_t>(offset));
+            if (bytes < 0 && errno == EINTR) continue;
+            if (bytes < 0) throw std::runtime_error("Could not read file.");
+            if (bytes == 0) return;
+
+            sha256.Update(buffer.get(), static_cast<size_t>(bytes));
+            offset += static_cast<uint64_t>(bytes);
+      }
+}
+#endif // SKYNET_SHA256_POSIX_IO
+
 /**
  * @brief Calculates the hash of a file with a given name.
+ *
+ * @details On POSIX systems regular files are memory mapped (with a sequential
+ *          access hint) and anything that can't be mapped is streamed with 1 MiB
+ *          preads. Sizes are 64 bit all the way through.
+ *
  * @param filename
  * @param hash
+ * @throws std::runtime_error If the file can't be opened or read
  */
 void crypto::hashing::SHA256::HashFile(const std::string &filename, byte *hash) {
       crypto::hashing::SHA256 sha256;
-      byte buffer[1024];
+
+#ifdef SKYNET_SHA256_POSIX_IO
+      int fd = open(filename.c_str(), O_RDONLY);
+      if (fd < 0) {
+            throw std::runtime_error("Could not open file.");
+      }
+
+      try {
+            struct stat info;
+            bool mapped = false;
+
+            if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+                  mapped = hash_file_mmap(fd, static_cast<uint64_t>(info.st_size), sha256);
+            }
+            if (!mapped) {
+                  hash_file_pread(fd, sha256);
+            }
+      } catch (...) {
+            close(fd);
+            throw;
+      }
+
+      close(fd);
+#else
+      auto buffer = std::make_unique<byte[]>(FILE_READ_BUFFER_SIZE);
       std::ifstream file(filename, std::ios::binary);
 
       if (!file.is_open()) {
             throw std::runtime_error("Could not open file.");
       }
 
-      while (!file.eof()) {
-            file.read((char *)buffer, 1024);
-            sha256.Update(buffer, file.gcount());
+      while (file) {
+            file.read(reinterpret_cast<char *>(buffer.get()), FILE_READ_BUFFER_SIZE);
+            sha256.Update(buffer.get(), static_cast<size_t>(file.gcount()));
       }
 
-      sha256.Final(hash);
       file.close();
+#endif // SKYNET_SHA256_POSIX_IO
+
+      sha256.Final(hash);
       memset(&sha256, 0, sizeof(crypto::hashing::SHA256));
 }
 
+/**
+ * @brief Hashes several files concurrently on the given thread pool.
+ *
+ * @param filenames The files to hash
+ * @param pool The (initialized) thread pool to run on
+ * @param hashes The digests, stored back to back in the same order as filenames
+ * @throws std::runtime_error If any of the files can't be opened or read
+ */
+void crypto::hashing::SHA256::HashFiles(const std::vector<std::string> &filenames, threading::ThreadPool &pool, byte *hashes) {
+      std::vector<std::future<void>> results;
+      results.reserve(filenames.size());
+
+      for (size_t i = 0; i < filenames.size(); ++i) {
+            byte *out = hashes + i * SHA256_HASH_SIZE;
+            const std::string *filename = &filenames[i];
+            results.push_back(pool.Enqueue([filename, out]() { HashFile(*filename, out); }));
+      }
+
+      /* Wait for every file before rethrowing, the tasks reference our arguments */
+      std::exception_ptr error;
+      for (auto &result : results) {
+            try {
+                  result.get();
+            } catch (...) {
+                  if (!error) error = std::current_exception();
+            }
+      }
+
+      if (error) std::rethrow_exception(error);
+}
+
+/**
+ * @brief Writes the state as a big endian digest.
+ */
+static void store_digest(const word *state, byte *out) {
+      for (int i = 0; i < crypto::hashing::SHA256_STATE_SIZE; ++i) {
+            out[i * 4] = state[i] >> 24;
+            out[i * 4 + 1] = state[i] >> 16;
+            out[i * 4 + 2] = state[i] >> 8;
+            out[i * 4 + 3] = state[i];
+      }
+}
+
+/**
+ * @brief Hashes a 32 byte digest using a pre-padded block.
+ *
+ * @details A 32 byte message always fits in a single block whose padding
+ *          (0x80, zeros and the 256 bit length) never changes.
+ */
+static void hash_digest(const byte *digest, byte *out) {
+      byte block[crypto::hashing::SHA256_BLOCK_SIZE] = {0};
+      memcpy(block, digest, crypto::hashing::SHA256_HASH_SIZE);
+      block[crypto::hashing::SHA256_HASH_SIZE] = 0x80;
+      block[62] = 0x01; /* 256 bits, big endian */
+
+      word state[crypto::hashing::SHA256_STATE_SIZE];
+      memcpy(state, SHA256_INITIAL_STATE, sizeof(state));
+      active_transform()(state, block, 1);
+      store_digest(state, out);
+}
+
+/**
+ * @brief Double SHA-256 of the given data.
+ *
+ * @param data The data to hash
+ * @param len The length of the data
+ * @param out The digest
+ */
+void crypto::hashing::DoubleSHA256(const byte *data, size_t len, byte *out) {
+      byte first[SHA256_HASH_SIZE];
+      SHA256(data, len, first);
+      hash_digest(first, out);
+}
+
+/**
+ * @brief Compresses the constant blocks of the message and pre-pads the final ones.
+ *
+ * @param message The message template
+ * @param len The length of the message
+ * @param variable_len How many trailing bytes change between hashes
+ * @throws std::invalid_argument If the variable tail does not fit in the last two blocks
+ */
+crypto::hashing::SHA256Midstate::SHA256Midstate(const byte *message, size_t len, size_t variable_len) {
+      if (variable_len > len) {
+            throw std::invalid_argument("Midstate variable tail is longer than the message");
+      }
+
+      const size_t constant_blocks = (len - variable_len) / SHA256_BLOCK_SIZE;
+      const size_t remaining = len - constant_blocks * SHA256_BLOCK_SIZE;
+
+      /* Remaining bytes + 0x80 + 64 bit length must fit in two blocks */
+      if (remaining + 9 > sizeof(this->blocks)) {
+            throw std::invalid_argument("Midstate variable tail does not fit in the final blocks");
+      }
+
+      memcpy(this->state, SHA256_INITIAL_STATE, sizeof(this->state));
+      if (constant_blocks > 0) {
+            active_transform()(this->state, message, constant_blocks);
+      }
+
+      this->final_blocks = remaining + 9 > SHA256_BLOCK_SIZE ? 2 : 1;
+      this->tail_offset = remaining - variable_len;
+      this->tail_len = variable_len;
+
+      const size_t end = this->final_blocks * SHA256_BLOCK_SIZE;
+      const unsigned long long bit_len = static_cast<unsigned long long>(len) * 8;
+      memset(this->blocks, 0, sizeof(this->blocks));
+      memcpy(this->blocks, message + constant_blocks * SHA256_BLOCK_SIZE, remaining);
+      this->blocks[remaining] = 0x80;
+      for (int i = 0; i < 8; ++i) {
+            this->blocks[end - 1 - i] = static_cast<byte>(bit_len >> (i * 8));
+      }
+}
+
+/**
+ * @brief Hashes the message with the given variable tail.
+ */
+void crypto::hashing::SHA256Midstate::Hash(const byte *tail, byte *out) {
+      word state[SHA256_STATE_SIZE];
+      memcpy(state, this->state, sizeof(state));
+      memcpy(this->blocks + this->tail_offset, tail, this->tail_len);
+      active_transform()(state, this->blocks, this->final_blocks);
+      store_digest(state, out);
+}
+
+/**
+ * @brief Double hashes the message with the given variable tail.
+ */
+void crypto::hashing::SHA256Midstate::DoubleHash(const byte *tail, byte *out) {
+      byte first[SHA256_HASH_SIZE];
+      Hash(tail, first);
+      hash_digest(first, out);
+}
+
 /**
  * @brief Compares two hashes.
  * @param hash1
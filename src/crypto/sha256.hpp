@@ -21,6 +21,10 @@
  *     
  *      crypto::hashing::SHA256(data, sizeof(data), hash);
  *
+ *      // Or incrementally, without concatenating the inputs
+ *      crypto::hashing::SHA256 context;
+ *      context.Update(data, 6).Update(data + 6, sizeof(data) - 6).Final(hash);
+ *
  *      return 0;
  * }
  */
@@ -30,17 +34,42 @@
 
 /* C++ includes */
 #include <string>
+#include <vector>
 #include <array>
 #include <cstring>
+#include <cstdint>
+#include <stdexcept>
 
 /* Skynet includes */
 #include <types.hpp>
 
+namespace threading { class ThreadPool; }
+
 namespace crypto::hashing 
 {
       constexpr int SHA256_HASH_SIZE  = 32;
       constexpr int SHA256_BLOCK_SIZE = 64;
       constexpr int SHA256_STATE_SIZE = 8;
+
+      /**
+       * @brief Compression backends. The fastest backend supported by the CPU is picked
+       *        the first time something is hashed; every backend produces identical digests.
+       */
+      enum class Backend : uint8_t {
+            GENERIC = 0,      /** Portable C++ implementation */
+            SHA_NI = 1,       /** Intel SHA extensions (x86 only) */
+            SSE4 = 2,         /** 4 messages at a time with SSE4.1 (batches only, x86 only) */
+            AVX2 = 3,         /** 8 messages at a time with AVX2 (batches only, x86 only) */
+      };
+
+      /** Returns the backend currently in use */
+      Backend GetBackend();
+      /** Returns true if the running CPU supports the given backend */
+      bool BackendSupported(Backend backend);
+      /** Forces the given backend, returns false (and keeps the current one) if it is not supported */
+      bool SetBackend(Backend backend);
+      /** Returns the name of the given backend */
+      std::string BackendToString(Backend backend);
       
       class SHA256 
       {
@@ -50,22 +79,53 @@ namespace crypto::hashing
             SHA256(const std::string& filename, byte* out);
             ~SHA256();
 
+            /**
+             * @brief Hashes `count` messages of `len` bytes each, stored back to back in `data`,
+             *        writing the digests back to back in `out` (count * SHA256_HASH_SIZE bytes).
+             *
+             * @details Independent messages are interleaved across SIMD lanes when the
+             *          backend supports it, which is much faster than hashing them one by one.
+             *          Meant for Merkle levels and other batches of small, equal sized inputs.
+             *
+             *          Every message is read before its digest is written, so when len >= SHA256_HASH_SIZE
+             *          `out` may point to `data`, and the digests overwrite the front of the input.
+             */
+            static void HashMany(const byte *data, size_t len, size_t count, byte *out);
+
+            /**
+             * @brief Hashes each of the given files on the thread pool, writing the digests back
+             *        to back in `out` (filenames.size() * SHA256_HASH_SIZE bytes), in order.
+             *
+             * @throws std::runtime_error If any of the files can't be opened or read
+             */
+            static void HashFiles(const std::vector<std::string> &filenames, threading::ThreadPool &pool, byte *out);
+
             /** Compares two hashes, true if equal, false if not */
             static bool CompareHash(const byte *hash1, const byte *hash2);
             /** Prints a hash to the stdout */
             static void PrintHash(byte *hash);
 
-      private:
-            /* Private Functions */
-            void Update(const byte *data, size_t len);
-            void Final(byte *hash);
-
-            /** Initializes the SHA256 context */
+            /* STREAMING INTERFACE */
+            /**
+             * @brief (Re)initializes the context. A default constructed context is
+             *        already initialized, call this to reuse a context after Final().
+             */
             void Init();
+            /**
+             * @brief Feeds more data into the hash. Can be called any number of times,
+             *        hashing scattered inputs without concatenating them first.
+             */
+            SHA256& Update(const byte *data, size_t len);
+            /**
+             * @brief Writes the digest of everything fed so far to hash (SHA256_HASH_SIZE bytes).
+             *        The context must be re-initialized with Init() before being reused.
+             */
+            void Final(byte *hash);
 
+      private:
             /** Hashes the given data and outputs the digest to byte *hash */
             static void Hash(const byte *data, size_t len, byte *hash);
-            /** Hashes the given file and outputs the digest to byte *hash */
+            /** Hashes the given file (memory mapped when possible) and outputs the digest to byte *hash */
             static void HashFile(const std::string &filename, byte *hash);
 
             /* Member Variables */
@@ -74,6 +134,51 @@ namespace crypto::hashing
             unsigned long long bit_len;
             word state[SHA256_STATE_SIZE];
       };
+
+      /**
+       * @brief Double SHA-256 (the SHA-256 of the SHA-256 digest) of the given data.
+       *        The second pass hashes a fixed length, pre-padded block.
+       */
+      void DoubleSHA256(const byte *data, size_t len, byte *out);
+
+      /**
+       * @brief Caches the compression state over the constant prefix of a message whose
+       *        trailing bytes change between hashes, like a block header during the nonce search.
+       *
+       * @details Every whole block before the variable tail is compressed once, in the
+       *          constructor. The final block(s) are padded once as well, so each Hash()
+       *          only copies the new tail in and compresses the last one or two blocks.
+       *
+       * @example
+       * crypto::hashing::SHA256Midstate midstate(header, HEADER_SIZE, sizeof(nonce));
+       * for (uint32_t nonce = 0; ; ++nonce) {
+       *      midstate.DoubleHash(reinterpret_cast<const byte*>(&nonce), hash);
+       *      ...
+       * }
+       */
+      class SHA256Midstate
+      {
+      public:
+            /**
+             * @param message The message template
+             * @param len The length of the message
+             * @param variable_len How many trailing bytes change between hashes
+             * @throws std::invalid_argument If the variable tail does not fit in the last two blocks
+             */
+            SHA256Midstate(const byte *message, size_t len, size_t variable_len);
+
+            /** Replaces the variable tail (variable_len bytes) and writes SHA-256(message) to out */
+            void Hash(const byte *tail, byte *out);
+            /** Replaces the variable tail (variable_len bytes) and writes SHA-256(SHA-256(message)) to out */
+            void DoubleHash(const byte *tail, byte *out);
+
+      private:
+            word state[SHA256_STATE_SIZE];            /** State after the constant blocks */
+            byte blocks[2 * SHA256_BLOCK_SIZE];       /** Pre-padded final block(s) */
+            size_t final_blocks;                      /** How many final blocks there are (1 or 2) */
+            size_t tail_offset;                       /** Where the variable tail starts in blocks */
+            size_t tail_len;                          /** Length of the variable tail */
+      };
 }
 
 #endif //SKYNET_SHA256_HPP
@@ -0,0 +1,97 @@
+/**
+ * @file   sha256_kernels.hpp
+ * @author JoaoAJMatos
+ *
+ * @brief Internal header shared by the SHA-256 compression kernels.
+ *        Each kernel lives in its own translation unit so it can be compiled
+ *        for the instruction set it needs, while sha256.cpp picks the fastest
+ *        one the CPU supports at runtime.
+ *
+ *        This header is not part of the public hashing interface, include
+ *        <crypto/sha256.hpp> instead.
+ *
+ * @version 0.1
+ * @date 2023-11-02
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+#ifndef SKYNET_SHA256_KERNELS_HPP
+#define SKYNET_SHA256_KERNELS_HPP
+
+/* C++ includes */
+#include <array>
+#include <cstddef>
+
+/* Skynet includes */
+#include <types.hpp>
+
+/** x86 kernels are only built with compilers that support per-function target attributes */
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SKYNET_SHA256_X86 1
+#endif
+
+namespace crypto::hashing::kernels
+{
+      /* The first 32 bits of the fractional parts of the cube roots of the first 64 primes 2..311 */
+      alignas(64) inline constexpr std::array<word, 64> K = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+      };
+
+      /**
+       * @brief Signature shared by all single buffer kernels.
+       *        Compresses `blocks` consecutive 64 byte blocks into `state`.
+       */
+      using TransformFunction = void (*)(word *state, const byte *data, size_t blocks);
+
+      /**
+       * @brief Signature shared by all multi buffer kernels.
+       *        Compresses one 64 byte block per lane. The state is interleaved,
+       *        word w of lane l lives at state[w * LANES + l].
+       */
+      using MultiTransformFunction = void (*)(word *state, const byte *const *blocks);
+
+      /** Portable C++ kernel, always available */
+      void transform_generic(word *state, const byte *data, size_t blocks);
+
+#ifdef SKYNET_SHA256_X86
+      /** Intel SHA extensions kernel (requires SHA, SSSE3 and SSE4.1) */
+      void transform_shani(word *state, const byte *data, size_t blocks);
+      /** 4 lane SSE4.1 kernel */
+      void transform_4way_sse41(word *state, const byte *const *blocks);
+      /** 8 lane AVX2 kernel */
+      void transform_8way_avx2(word *state, const byte *const *blocks);
+#endif // SKYNET_SHA256_X86
+
+} // namespace crypto::hashing::kernels
+
+#endif // SKYNET_SHA256_KERNELS_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
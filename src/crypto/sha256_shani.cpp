@@ -0,0 +1,111 @@
+//
+// Created by João Matos on 02/11/2023.
+//
+// SHA-256 compression using the Intel SHA extensions (SHA-NI).
+// Based on the public domain reference code by Jeffrey Walton / Sean Gulley:
+// https://github.com/noloader/SHA-Intrinsics/blob/master/sha256-x86.c
+//
+
+/* Skynet includes */
+#include "sha256_kernels.hpp"
+
+#ifdef SKYNET_SHA256_X86
+
+/* C++ includes */
+#include <immintrin.h>
+
+#define SHANI_TARGET __attribute__((target("sha,ssse3,sse4.1")))
+
+/**
+ * @brief Compresses the given 64 byte blocks into state using the SHA-NI instructions.
+ *
+ * @details The SHA-NI round instruction expects the state split in the ABEF and CDGH
+ *          halves, so the state is shuffled in and out of that layout once per call
+ *          instead of once per block.
+ *
+ *          Message schedule vectors are kept in a 4 entry ring: w[i % 4] holds the
+ *          words for rounds 4i..4i+3.
+ *
+ * @param state The 8 word hash state
+ * @param data The blocks to compress
+ * @param blocks The number of blocks
+ */
+SHANI_TARGET void crypto::hashing::kernels::transform_shani(word *state, const byte *data, size_t blocks) {
+      const __m128i BYTE_SWAP_MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+      /* Load the state and shuffle it into the ABEF/CDGH layout */
+      __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[0]));
+      __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[4]));
+
+      tmp = _mm_shuffle_epi32(tmp, 0xB1);                   /* CDAB */
+      state1 = _mm_shuffle_epi32(state1, 0x1B);             /* EFGH */
+      __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);     /* ABEF */
+      state1 = _mm_blend_epi16(state1, tmp, 0xF0);          /* CDGH */
+
+      for (; blocks > 0; --blocks, data += 64) {
+            const __m128i abef_save = state0;
+            const __m128i cdgh_save = state1;
+            __m128i w[4];
+
+            for (int i = 0; i < 4; ++i) {
+                  w[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16));
+                  w[i] = _mm_shuffle_epi8(w[i], BYTE_SWAP_MASK);
+            }
+
+            for (int i = 0; i < 16; ++i) {
+                  __m128i msg = _mm_add_epi32(w[i & 3], _mm_load_si128(reinterpret_cast<const __m128i *>(&K[i * 4])));
+                  state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+
+                  /* Finish the schedule for rounds 4(i+1)..4(i+1)+3 */
+                  if (i >= 3 && i < 15) {
+                        tmp = _mm_alignr_epi8(w[i & 3], w[(i - 1) & 3], 4);
+                        w[(i + 1) & 3] = _mm_add_epi32(w[(i + 1) & 3], tmp);
+                        w[(i + 1) & 3] = _mm_sha256msg2_epu32(w[(i + 1) & 3], w[i & 3]);
+                  }
+
+                  msg = _mm_shuffle_epi32(msg, 0x0E);
+                  state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+                  /* Start the schedule for rounds 4(i+3)..4(i+3)+3 */
+                  if (i >= 1 && i < 13) {
+                        w[(i + 3) & 3] = _mm_sha256msg1_epu32(w[(i - 1) & 3], w[i & 3]);
+                  }
+            }
+
+            state0 = _mm_add_epi32(state0, abef_save);
+            state1 = _mm_add_epi32(state1, cdgh_save);
+      }
+
+      /* Shuffle the state back into the ABCDEFGH layout */
+      tmp = _mm_shuffle_epi32(state0, 0x1B);                /* FEBA */
+      state1 = _mm_shuffle_epi32(state1, 0xB1);             /* DCHG */
+      state0 = _mm_blend_epi16(tmp, state1, 0xF0);          /* DCBA */
+      state1 = _mm_alignr_epi8(state1, tmp, 8);             /* ABEF */
+
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[0]), state0);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[4]), state1);
+}
+
+#endif // SKYNET_SHA256_X86
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,125 @@
+//
+// Created by João Matos on 03/11/2023.
+//
+// 4-way multi-buffer SHA-256 compression using SSE4.1.
+// Each 32 bit lane of a 128 bit register belongs to a different message,
+// so four independent blocks are compressed with a single instruction stream.
+//
+
+/* Skynet includes */
+#include "sha256_kernels.hpp"
+
+#ifdef SKYNET_SHA256_X86
+
+/* C++ includes */
+#include <cstring>
+#include <immintrin.h>
+
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+
+/* Lane-wise SHA-256 primitives */
+#define ADD(x, y) _mm_add_epi32(x, y)
+#define XOR(x, y) _mm_xor_si128(x, y)
+#define AND(x, y) _mm_and_si128(x, y)
+#define OR(x, y) _mm_or_si128(x, y)
+#define SHIFT_RIGHT(x, n) _mm_srli_epi32(x, n)
+#define ROTATE_RIGHT(x, n) OR(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - (n)))
+
+#define CHOOSE(x, y, z) XOR(z, AND(x, XOR(y, z)))
+#define MAJORITY(x, y, z) OR(AND(x, y), AND(z, OR(x, y)))
+#define EPSILON_0(x) XOR(XOR(ROTATE_RIGHT(x, 2), ROTATE_RIGHT(x, 13)), ROTATE_RIGHT(x, 22))
+#define EPSILON_1(x) XOR(XOR(ROTATE_RIGHT(x, 6), ROTATE_RIGHT(x, 11)), ROTATE_RIGHT(x, 25))
+#define SIGMA_0(x) XOR(XOR(ROTATE_RIGHT(x, 7), ROTATE_RIGHT(x, 18)), SHIFT_RIGHT(x, 3))
+#define SIGMA_1(x) XOR(XOR(ROTATE_RIGHT(x, 17), ROTATE_RIGHT(x, 19)), SHIFT_RIGHT(x, 10))
+
+/**
+ * @brief Reads a big endian word from an unaligned pointer.
+ */
+static inline word read_be32(const byte *ptr) {
+      word value;
+      memcpy(&value, ptr, sizeof(value));
+      return __builtin_bswap32(value);
+}
+
+/**
+ * @brief Gathers word i of the current block of every lane into a single vector.
+ */
+SSE41_TARGET static inline __m128i load_word(const byte *const *blocks, int i) {
+      return _mm_set_epi32(
+            read_be32(blocks[3] + i * 4), read_be32(blocks[2] + i * 4),
+            read_be32(blocks[1] + i * 4), read_be32(blocks[0] + i * 4)
+      );
+}
+
+/**
+ * @brief Compresses one 64 byte block for each of the 4 lanes.
+ *
+ * @param state The interleaved state, word w of lane l is state[w * 4 + l]
+ * @param blocks Pointers to the block of each lane
+ */
+SSE41_TARGET void crypto::hashing::kernels::transform_4way_sse41(word *state, const byte *const *blocks) {
+      __m128i s[8];
+      for (int i = 0; i < 8; ++i) {
+            s[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state + i * 4));
+      }
+
+      __m128i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+      __m128i w[16];
+
+      for (int i = 0; i < 64; ++i) {
+            /* The message schedule only needs the last 16 words, keep them in a ring */
+            if (i < 16) {
+                  w[i] = load_word(blocks, i);
+            } else {
+                  w[i & 15] = ADD(ADD(SIGMA_1(w[(i - 2) & 15]), w[(i - 7) & 15]), ADD(SIGMA_0(w[(i - 15) & 15]), w[i & 15]));
+            }
+
+            __m128i t1 = ADD(ADD(h, EPSILON_1(e)), ADD(CHOOSE(e, f, g), ADD(_mm_set1_epi32(K[i]), w[i & 15])));
+            __m128i t2 = ADD(EPSILON_0(a), MAJORITY(a, b, c));
+            h = g;
+            g = f;
+            f = e;
+            e = ADD(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = ADD(t1, t2);
+      }
+
+      s[0] = ADD(s[0], a);
+      s[1] = ADD(s[1], b);
+      s[2] = ADD(s[2], c);
+      s[3] = ADD(s[3], d);
+      s[4] = ADD(s[4], e);
+      s[5] = ADD(s[5], f);
+      s[6] = ADD(s[6], g);
+      s[7] = ADD(s[7], h);
+
+      for (int i = 0; i < 8; ++i) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(state + i * 4), s[i]);
+      }
+}
+
+#endif // SKYNET_SHA256_X86
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -18,21 +18,31 @@ void skynet::MemPool::AddTransaction(Transaction transaction) {
       transactions.push_back(transaction);
 }
 
+/** 
+* @brief Adds a batch of transactions to the mempool
+*
+* @param transactions The transactions to be added 
+*/
+void skynet::MemPool::AddTransactions(std::vector<Transaction> transactions) {
+      this->transactions.insert(this->transactions.end(),
+                                std::make_move_iterator(transactions.begin()),
+                                std::make_move_iterator(transactions.end()));
+}
+
 /** 
 * @brief Removes a transaction from the mempool
 * 
 * @param transaction_id The ID of the transaction to be removed
 * @throws std::runtime_error If the transaction is not found
 */
-void skynet::MemPool::RemoveTransaction(TransactionHash transaction_hash) {
-      TransactionHash hash;
+void skynet::MemPool::RemoveTransaction(const TransactionHash& transaction_hash) {
+      auto it = std::find_if(transactions.begin(), transactions.end(), [&transaction_hash](const Transaction& transaction) {
+            return transaction.Hash() == transaction_hash;
+      });
 
-      for (auto& transaction : transactions) {
-            auto hash = transaction.Hash();
-            if (crypto::hashing::SHA256::CompareHash(hash.get(), transaction_hash)) {
-                  transactions.erase(std::remove(transactions.begin(), transactions.end(), transaction), transactions.end());
-                  return;
-            }
+      if (it != transactions.end()) {
+            transactions.erase(it);
+            return;
       }
 
       throw std::runtime_error("Transaction not found");
@@ -44,12 +54,9 @@ void skynet::MemPool::RemoveTransaction(TransactionHash transaction_hash) {
 * @param transaction_id The ID of the transaction to be returned
 * @return Transaction The transaction with the given ID
 */
-skynet::Transaction skynet::MemPool::GetTransaction(TransactionHash transaction_hash) {
-      TransactionHash hash;
-
-      for (auto& transaction : transactions) {
-            auto hash = transaction.Hash();
-            if (crypto::hashing::SHA256::CompareHash(hash.get(), transaction_hash)) {
+skynet::Transaction skynet::MemPool::GetTransaction(const TransactionHash& transaction_hash) {
+      for (const auto& transaction : transactions) {
+            if (transaction.Hash() == transaction_hash) {
                   return transaction;
             }
       }
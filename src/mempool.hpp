@@ -12,6 +12,9 @@
  * @copyright Copyright (c) 2023
  */
 
+#ifndef SKYNET_MEMPOOL_HPP
+#define SKYNET_MEMPOOL_HPP
+
 /* C++ Includes */
 #include <stdexcept>
 #include <vector>
@@ -38,6 +41,13 @@ namespace skynet
              * @param transaction The transaction to be added 
              */
             void AddTransaction(Transaction transaction);
+
+            /** 
+             * @brief Adds a batch of transactions to the mempool, growing it once
+             *
+             * @param transactions The transactions to be added 
+             */
+            void AddTransactions(std::vector<Transaction> transactions);
             
             /** 
              * @brief Removes a transaction from the mempool
@@ -45,7 +55,7 @@ namespace skynet
              * @param transaction_has The hash of the transaction to be removed
              * @throws std::runtime_error If the transaction is not found
              */
-            void RemoveTransaction(TransactionHash transaction_hash);
+            void RemoveTransaction(const TransactionHash& transaction_hash);
 
             /** 
              * @brief Returns a transaction with a given ID 
@@ -53,7 +63,7 @@ namespace skynet
              * @param transaction_hash The hash of the transaction to be returned
              * @return Transaction The transaction with the given ID
              */
-            Transaction GetTransaction(TransactionHash transaction_hash);
+            Transaction GetTransaction(const TransactionHash& transaction_hash);
 
             /** 
              * @brief Get the vector of transactions
@@ -77,6 +87,8 @@ namespace skynet
       };
 } // namespace skynet
 
+#endif // SKYNET_MEMPOOL_HPP
+
 // MIT License
 // 
 // Copyright (c) 2023 João Matos
@@ -3,81 +3,572 @@
 //
 
 /** C++ Includes */
-#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <new>
+#include <stdexcept>
+#include <vector>
 
 /** Skynet Includes */
 #include <crypto/sha256.hpp>
+#include <threading/threadpool.hpp>
 
 /** Local Includes */
 #include "merkle_tree.hpp"
 
 /**
- * @brief Adds a leaf to the Merkle Tree
+ * @brief Hashes the `count` nodes of a level into their count / 2 (rounded up) parents.
+ * @details Pairs are adjacent in memory, so each one is a 64 byte message and the whole
+ *          level goes through the batch hasher. `parents` may point to `level`, parent i
+ *          only overwrites nodes 2i and 2i + 1 after they have been read.
+ */
+static void hash_level(const byte *level, std::size_t count, byte *parents) {
+      const std::size_t pairs = count / 2;
+      crypto::hashing::SHA256::HashMany(level, 2 * skynet::MERKLE_NODE_SIZE, pairs, parents);
+
+      /** If the number of nodes is odd, the last node is hashed with itself */
+      if (count % 2 != 0) {
+            byte pair[2 * skynet::MERKLE_NODE_SIZE];
+            const byte *last = level + (count - 1) * skynet::MERKLE_NODE_SIZE;
+            memcpy(pair, last, skynet::MERKLE_NODE_SIZE);
+            memcpy(pair + skynet::MERKLE_NODE_SIZE, last, skynet::MERKLE_NODE_SIZE);
+            crypto::hashing::SHA256(pair, sizeof(pair), parents + pairs * skynet::MERKLE_NODE_SIZE);
+      }
+}
+
+/**
+ * @brief Replaces the front of a level with its parents.
+ */
+static void reduce_level(byte *level, std::size_t count) {
+      hash_level(level, count, level);
+}
+
+/**
+ * @brief Reduces `count` contiguous nodes until the root is left in the first node.
+ */
+static void reduce_tree(byte *nodes, std::size_t count) {
+      while (count > 1) {
+            reduce_level(nodes, count);
+            count = (count + 1) / 2;
+      }
+}
+
+/**
+ * @brief Reduces the nodes of a subtree `height` levels up, leaving its root in the first node.
+ * @details A partial subtree runs out of pairs before reaching `height`, its root is then
+ *          hashed with itself on each level left, just like the odd node out of the whole tree.
+ */
+static void reduce_subtree(byte *nodes, std::size_t count, std::size_t height) {
+      for (std::size_t level = 0; level < height; ++level) {
+            reduce_level(nodes, count);
+            count = (count + 1) / 2;
+      }
+}
+
+/**
+ * @brief Picks the number of leaves of each subtree for a parallel build.
+ * @details Subtrees are a power of two wide so each one maps to a single node a few levels
+ *          up, and there are a few of them per thread so one slow worker doesn't hold up the rest.
+ */
+static std::size_t subtree_size(std::size_t count, std::size_t threads) {
+      const std::size_t target = count / (threads * 4);
+      std::size_t size = skynet::MERKLE_MIN_SUBTREE_SIZE;
+      while (size < target) size *= 2;
+      return size;
+}
+
+/**
+ * @brief Creates a tree for `count` leaves
+ * 
+ * @param count The number of leaves
+ */
+skynet::MerkleTree::MerkleTree(std::size_t count) : count(count) {
+      const std::size_t size = (count > 0 ? count : 1) * MERKLE_NODE_SIZE;
+      nodes.reset(new (std::align_val_t(MERKLE_NODE_ALIGNMENT)) byte[size]);
+      memset(root, 0, MERKLE_NODE_SIZE);
+}
+
+/**
+ * @brief Reduces the leaves into the root
+ */
+void skynet::MerkleTree::Build() {
+      ComputeRoot(nodes.get(), count, root);
+}
+
+/**
+ * @brief Reduces the leaves into the root on a thread pool
+ * 
+ * @param pool The thread pool to run on
+ */
+void skynet::MerkleTree::Build(const threading::ThreadPool &pool) {
+      ComputeRoot(nodes.get(), count, root, pool);
+}
+
+/**
+ * @brief Computes the Merkle root of `count` contiguous nodes in place
+ * 
+ * @param nodes The leaves, clobbered by the inner levels
+ * @param count The number of leaves
+ * @param root The root of the tree
+ */
+void skynet::MerkleTree::ComputeRoot(byte *nodes, std::size_t count, byte *root) {
+      if (count == 0) {
+            memset(root, 0, MERKLE_NODE_SIZE);
+            return;
+      }
+
+      reduce_tree(nodes, count);
+      memcpy(root, nodes, MERKLE_NODE_SIZE);
+}
+
+/**
+ * @brief Computes the Merkle root of `count` contiguous nodes in place on a thread pool
+ * 
+ * @details A subtree of 2^k leaves starting at a multiple of 2^k reduces to exactly the
+ *          node the whole tree has at that position k levels up. The last (partial)
+ *          subtree duplicates its odd nodes at the same levels the whole tree would,
+ *          since every full subtree before it has an even number of nodes on each level,
+ *          as long as it is also reduced all the way up k levels.
+ *          So each subtree is reduced on its own, then the subtree roots are packed to
+ *          the front of the buffer and reduced into the root.
+ * 
+ * @param nodes The leaves, clobbered by the inner levels
+ * @param count The number of leaves
+ * @param root The root of the tree
+ * @param pool The thread pool to run on
+ */
+void skynet::MerkleTree::ComputeRoot(byte *nodes, std::size_t count, byte *root, const threading::ThreadPool &pool) {
+      const std::size_t threads = pool.GetThreadCount();
+      if (count < MERKLE_PARALLEL_THRESHOLD || threads < 2) {
+            ComputeRoot(nodes, count, root);
+            return;
+      }
+
+      const std::size_t size = subtree_size(count, threads);
+      const std::size_t subtrees = (count + size - 1) / size;
+      if (subtrees < 2) {
+            ComputeRoot(nodes, count, root);
+            return;
+      }
+
+      std::size_t height = 0;
+      while ((std::size_t(1) << height) < size) ++height;
+
+      std::vector<std::future<void>> results;
+      results.reserve(subtrees);
+      for (std::size_t i = 0; i < subtrees; ++i) {
+            byte *subtree = nodes + i * size * MERKLE_NODE_SIZE;
+            const std::size_t leaves = std::min(size, count - i * size);
+            results.push_back(pool.Enqueue([subtree, leaves, height]() { reduce_subtree(subtree, leaves, height); }));
+      }
+
+      /* Wait for every subtree before rethrowing, the tasks write into our buffer */
+      std::exception_ptr error;
+      for (auto &result : results) {
+            try {
+                  result.get();
+            } catch (...) {
+                  if (!error) error = std::current_exception();
+            }
+      }
+
+      if (error) std::rethrow_exception(error);
+
+      /** Pack the subtree roots to the front, root i moves from node i * size down to node i */
+      for (std::size_t i = 1; i < subtrees; ++i) {
+            memcpy(nodes + i * MERKLE_NODE_SIZE, nodes + i * size * MERKLE_NODE_SIZE, MERKLE_NODE_SIZE);
+      }
+
+      reduce_tree(nodes, subtrees);
+      memcpy(root, nodes, MERKLE_NODE_SIZE);
+}
+
+static_assert(sizeof(Hash256) == skynet::MERKLE_NODE_SIZE, "Hash256 must hold exactly one node");
+
+/**
+ * @brief Every level of a tree, kept around to extract proofs from.
+ */
+struct tree_levels {
+      std::vector<Hash256> nodes;               /** All the levels back to back, leaves first */
+      std::vector<std::size_t> offsets;         /** Index of the first node of each level */
+      std::vector<std::size_t> widths;          /** Number of nodes on each level */
+
+      std::size_t height() const { return widths.size() - 1; }
+      const Hash256 &node(std::size_t level, std::size_t pos) const { return nodes[offsets[level] + pos]; }
+};
+
+/**
+ * @brief Hashes every level of the tree, without touching the leaves.
+ */
+static tree_levels build_levels(const byte *leaves, std::size_t count) {
+      tree_levels levels;
+      std::size_t total = 0;
+      for (std::size_t width = count; ; width = (width + 1) / 2) {
+            levels.offsets.push_back(total);
+            levels.widths.push_back(width);
+            total += width;
+            if (width <= 1) break;
+      }
+
+      levels.nodes.resize(total);
+      memcpy(levels.nodes.data(), leaves, count * skynet::MERKLE_NODE_SIZE);
+      for (std::size_t level = 0; level < levels.height(); ++level) {
+            hash_level(levels.nodes[levels.offsets[level]].data(), levels.widths[level], levels.nodes[levels.offsets[level + 1]].data());
+      }
+
+      return levels;
+}
+
+/**
+ * @brief Hashes two nodes into their parent.
+ */
+static Hash256 hash_pair(const Hash256 &left, const Hash256 &right) {
+      byte pair[2 * skynet::MERKLE_NODE_SIZE];
+      memcpy(pair, left.data(), skynet::MERKLE_NODE_SIZE);
+      memcpy(pair + skynet::MERKLE_NODE_SIZE, right.data(), skynet::MERKLE_NODE_SIZE);
+
+      Hash256 parent;
+      crypto::hashing::SHA256(pair, sizeof(pair), parent.data());
+      return parent;
+}
+
+/**
+ * @brief Number of levels above the leaves of a tree with `count` leaves.
+ */
+static std::size_t tree_height(std::size_t count) {
+      std::size_t height = 0;
+      for (; count > 1; count = (count + 1) / 2) ++height;
+      return height;
+}
+
+/**
+ * @brief Number of nodes `height` levels above the leaves.
+ */
+static std::size_t level_width(std::size_t count, std::size_t height) {
+      return (count + (std::size_t(1) << height) - 1) >> height;
+}
+
+/**
+ * @brief Extracts the audit path of a leaf
+ * 
+ * @param leaves The leaves of the tree
+ * @param count The number of leaves
+ * @param index The leaf to prove
+ * @return MerkleBranch The branch of the leaf
+ * @throws std::out_of_range If index is not a leaf of the tree
+ */
+skynet::MerkleBranch skynet::MerkleTree::GetBranch(const byte *leaves, std::size_t count, std::size_t index) {
+      if (index >= count) {
+            throw std::out_of_range("Leaf index out of range");
+      }
+
+      const tree_levels levels = build_levels(leaves, count);
+      MerkleBranch branch{ static_cast<uint32_t>(index), static_cast<uint32_t>(count), {} };
+      branch.hashes.reserve(levels.height());
+
+      for (std::size_t level = 0; level < levels.height(); ++level, index /= 2) {
+            /** The odd node out is its own sibling */
+            std::size_t sibling = index ^ 1;
+            if (sibling >= levels.widths[level]) sibling = index;
+            branch.hashes.push_back(levels.node(level, sibling));
+      }
+
+      return branch;
+}
+
+/**
+ * @brief Checks that a leaf is in the tree with the given root
  * 
- * @param leaf The leaf to be added
+ * @param leaf The leaf
+ * @param branch The branch of the leaf
+ * @param root The expected root
+ * @return true If the branch proves the leaf
+ */
+bool skynet::MerkleTree::VerifyBranch(const byte *leaf, const MerkleBranch &branch, const byte *root) {
+      if (branch.index >= branch.leafCount || branch.hashes.size() != tree_height(branch.leafCount)) {
+            return false;
+      }
+
+      Hash256 node;
+      memcpy(node.data(), leaf, MERKLE_NODE_SIZE);
+
+      std::size_t index = branch.index;
+      for (std::size_t level = 0; level < branch.hashes.size(); ++level, index /= 2) {
+            const Hash256 &sibling = branch.hashes[level];
+
+            /** Only the odd node out may be paired with itself */
+            const bool odd_node_out = (index ^ 1) >= level_width(branch.leafCount, level);
+            if (odd_node_out != (sibling == node)) return false;
+
+            node = (index & 1) ? hash_pair(sibling, node) : hash_pair(node, sibling);
+      }
+
+      return memcmp(node.data(), root, MERKLE_NODE_SIZE) == 0;
+}
+
+/**
+ * @brief State of a depth first walk building a multi proof.
+ */
+struct proof_builder {
+      const tree_levels &levels;                /** The whole tree */
+      const std::vector<bool> &matched;         /** The leaves to prove */
+      skynet::MerkleMultiProof &proof;
+      std::size_t bits;                         /** Flag bits written so far */
+
+      void push_bit(bool bit) {
+            if (bits % 8 == 0) proof.flags.push_back(0);
+            if (bit) proof.flags.back() |= static_cast<byte>(1u << (bits % 8));
+            ++bits;
+      }
+};
+
+/**
+ * @brief State of a depth first walk verifying a multi proof.
+ */
+struct proof_reader {
+      const skynet::MerkleMultiProof &proof;
+      std::vector<skynet::MerkleLeaf> &leaves;  /** The proven leaves found so far */
+      std::size_t bits;                         /** Flag bits read so far */
+      std::size_t hashes;                       /** Hashes read so far */
+      bool failed;
+
+      bool next_bit() {
+            const bool bit = (proof.flags[bits / 8] >> (bits % 8)) & 1;
+            ++bits;
+            return bit;
+      }
+};
+
+/**
+ * @brief Adds the node at `pos`, `height` levels above the leaves, to the proof.
  */
-void skynet::MerkleTree::AddLeaf(std::unique_ptr<byte[]> leaf) {
-      leaves.push_back(std::move(leaf));
-      BuildNodes();
-      BuildRoot();
+static void build_proof(proof_builder &builder, std::size_t height, std::size_t pos) {
+      const std::size_t count = builder.levels.widths[0];
+      const std::size_t first = pos << height;
+      const std::size_t last = std::min(count, (pos + 1) << height);
+
+      bool parent_of_match = false;
+      for (std::size_t i = first; i < last && !parent_of_match; ++i) {
+            parent_of_match = builder.matched[i];
+      }
+      builder.push_bit(parent_of_match);
+
+      if (height == 0 || !parent_of_match) {
+            builder.proof.hashes.push_back(builder.levels.node(height, pos));
+            return;
+      }
+
+      build_proof(builder, height - 1, pos * 2);
+      if (pos * 2 + 1 < builder.levels.widths[height - 1]) {
+            build_proof(builder, height - 1, pos * 2 + 1);
+      }
 }
 
 /**
- * @brief Returns the root of the Merkle Tree
+ * @brief Recomputes the node at `pos`, `height` levels above the leaves, from the proof.
+ */
+static Hash256 read_proof(proof_reader &reader, std::size_t height, std::size_t pos) {
+      if (reader.bits >= reader.proof.flags.size() * 8) {
+            reader.failed = true;
+            return Hash256{};
+      }
+
+      const bool parent_of_match = reader.next_bit();
+      if (height == 0 || !parent_of_match) {
+            if (reader.hashes >= reader.proof.hashes.size()) {
+                  reader.failed = true;
+                  return Hash256{};
+            }
+
+            const Hash256 &hash = reader.proof.hashes[reader.hashes++];
+            if (height == 0 && parent_of_match) {
+                  reader.leaves.push_back({ static_cast<uint32_t>(pos), hash });
+            }
+            return hash;
+      }
+
+      const Hash256 left = read_proof(reader, height - 1, pos * 2);
+      if (pos * 2 + 1 >= level_width(reader.proof.leafCount, height - 1)) {
+            return hash_pair(left, left);
+      }
+
+      /** Two identical children would let a different tree have the same root */
+      const Hash256 right = read_proof(reader, height - 1, pos * 2 + 1);
+      if (left == right) reader.failed = true;
+
+      return hash_pair(left, right);
+}
+
+/**
+ * @brief Builds a compact proof for several leaves
  * 
- * @return std::unique_ptr<byte[]> The root of the Merkle Tree
+ * @param leaves The leaves of the tree
+ * @param count The number of leaves
+ * @param indexes The leaves to prove
+ * @return MerkleMultiProof The proof
+ * @throws std::out_of_range If any of the indexes is not a leaf of the tree
  */
-std::unique_ptr<byte[]> skynet::MerkleTree::Root() const {
-      return std::unique_ptr<byte[]>(root.get());
+skynet::MerkleMultiProof skynet::MerkleTree::GetMultiProof(const byte *leaves, std::size_t count, const std::vector<uint32_t> &indexes) {
+      if (indexes.empty()) {
+            throw std::invalid_argument("No leaves to prove");
+      }
+
+      std::vector<bool> matched(count, false);
+      for (uint32_t index : indexes) {
+            if (index >= count) {
+                  throw std::out_of_range("Leaf index out of range");
+            }
+            matched[index] = true;
+      }
+
+      const tree_levels levels = build_levels(leaves, count);
+      MerkleMultiProof proof{ static_cast<uint32_t>(count), {}, {} };
+
+      proof_builder builder{ levels, matched, proof, 0 };
+      build_proof(builder, levels.height(), 0);
+
+      return proof;
 }
 
 /**
- * @brief Builds the nodes of the Merkle Tree
+ * @brief Checks a multi proof against a root and recovers the proven leaves
+ * 
+ * @param proof The proof
+ * @param root The expected root
+ * @param leaves The proven leaves
+ * @return true If the proof is well formed and hashes up to the root
  */
-void skynet::MerkleTree::BuildNodes() {
-      /** If the number of leaves is odd, duplicate the last leaf */
-      if (leaves.size() % 2 != 0) {
-            leaves.push_back(std::unique_ptr<byte[]>(leaves.back().get()));
+bool skynet::MerkleTree::VerifyMultiProof(const MerkleMultiProof &proof, const byte *root, std::vector<MerkleLeaf> &leaves) {
+      leaves.clear();
+
+      /** Every hash needs at least one flag bit, and there can't be more hashes than leaves */
+      if (proof.leafCount == 0 || proof.hashes.empty() || proof.hashes.size() > proof.leafCount ||
+          proof.hashes.size() > proof.flags.size() * 8) {
+            return false;
+      }
+
+      proof_reader reader{ proof, leaves, 0, 0, false };
+      const Hash256 computed = read_proof(reader, tree_height(proof.leafCount), 0);
+
+      /** Everything in the proof must have been used */
+      if (reader.failed || reader.hashes != proof.hashes.size() || (reader.bits + 7) / 8 != proof.flags.size()) {
+            leaves.clear();
+            return false;
       }
 
-      /** Build the nodes */
-      for (int i = 0; i < leaves.size(); i += 2) {
-            std::unique_ptr<byte[]> node = std::make_unique<byte[]>(crypto::hashing::SHA256_HASH_SIZE);
-            crypto::hashing::SHA256(leaves[i].get(), crypto::hashing::SHA256_HASH_SIZE, node.get());
-            crypto::hashing::SHA256(leaves[i + 1].get(), crypto::hashing::SHA256_HASH_SIZE, node.get());
-            nodes.push_back(std::move(node));
+      if (memcmp(computed.data(), root, MERKLE_NODE_SIZE) != 0) {
+            leaves.clear();
+            return false;
       }
+
+      return true;
 }
 
 /**
- * @brief Builds the root of the Merkle Tree
+ * @brief Appends a leaf
+ * 
+ * @param leaf The leaf
+ * @throws std::length_error If the tree is full
  */
-void skynet::MerkleTree::BuildRoot() {
-      /** If the number of nodes is odd, duplicate the last node */
-      if (nodes.size() % 2 != 0) {
-            nodes.push_back(std::unique_ptr<byte[]>(nodes.back().get()));
+void skynet::MerkleAccumulator::Append(const byte *leaf) {
+      if (count == UINT32_MAX) {
+            throw std::length_error("Merkle accumulator is full");
       }
 
-      /** Build the root */
-      for (int i = 0; i < nodes.size(); i += 2) {
-            std::unique_ptr<byte[]> node = std::make_unique<byte[]>(crypto::hashing::SHA256_HASH_SIZE);
-            crypto::hashing::SHA256(nodes[i].get(), crypto::hashing::SHA256_HASH_SIZE, node.get());
-            crypto::hashing::SHA256(nodes[i + 1].get(), crypto::hashing::SHA256_HASH_SIZE, node.get());
-            root = std::move(node);
+      Hash256 node;
+      memcpy(node.data(), leaf, MERKLE_NODE_SIZE);
+      ++count;
+
+      /** Every trailing zero of the new count merges two subtrees of that height */
+      std::size_t height = 0;
+      for (; !(count & (uint32_t(1) << height)); ++height) {
+            node = hash_pair(frontier[height], node);
       }
+      frontier[height] = node;
 }
 
 /**
- * @brief Prints the nodes of the Merkle Tree
+ * @brief Computes the root of the leaves appended so far
+ * 
+ * @param root The root
  */
-void skynet::MerkleTree::PrintNodes() {
-      for (int i = 0; i < nodes.size(); i++) {
-            std::cout << "Node " << i << ": ";
-            for (int j = 0; j < crypto::hashing::SHA256_HASH_SIZE; j++) {
-                  std::cout << std::hex << (int)nodes[i][j];
+void skynet::MerkleAccumulator::Root(byte *root) const {
+      if (count == 0) {
+            memset(root, 0, MERKLE_NODE_SIZE);
+            return;
+      }
+
+      /** Start from the smallest subtree, the rightmost one */
+      std::size_t height = 0;
+      while (!(count & (uint32_t(1) << height))) ++height;
+      Hash256 node = frontier[height];
+
+      /** Pad the count as the odd node duplication would, folding in the subtrees to the left */
+      uint64_t padded = count;
+      while (padded != (uint64_t(1) << height)) {
+            node = hash_pair(node, node);
+            padded += uint64_t(1) << height;
+            ++height;
+
+            for (; !(padded & (uint64_t(1) << height)); ++height) {
+                  node = hash_pair(frontier[height], node);
             }
-            std::cout << std::endl;
       }
+
+      memcpy(root, node.data(), MERKLE_NODE_SIZE);
+}
+
+/**
+ * @brief Appends a leaf, the first one is the coinbase
+ * 
+ * @param leaf The leaf
+ * @throws std::length_error If the tree is full
+ */
+void skynet::CoinbaseMerkleAccumulator::Append(const byte *leaf) {
+      /** Reaching 2^(h + 1) leaves completes the subtree covering [2^h, 2^(h + 1)) */
+      const uint64_t next = uint64_t(count) + 1;
+      if (next > 1 && (next & (next - 1)) == 0) {
+            std::size_t height = 0;
+            while ((uint64_t(2) << height) != next) ++height;
+
+            Hash256 node;
+            memcpy(node.data(), leaf, MERKLE_NODE_SIZE);
+            for (std::size_t level = 0; level < height; ++level) {
+                  node = hash_pair(frontier[level], node);
+            }
+            siblings[height] = node;
+      }
+
+      MerkleAccumulator::Append(leaf);
+}
+
+/**
+ * @brief Replaces the coinbase
+ * 
+ * @param leaf The new coinbase leaf
+ * @throws std::logic_error If no coinbase was appended yet
+ */
+void skynet::CoinbaseMerkleAccumulator::ReplaceCoinbase(const byte *leaf) {
+      if (count == 0) {
+            throw std::logic_error("No coinbase to replace");
+      }
+
+      /** The coinbase lives in the largest subtree of the frontier */
+      std::size_t top = 31;
+      while (!(count & (uint32_t(1) << top))) --top;
+
+      Hash256 node;
+      memcpy(node.data(), leaf, MERKLE_NODE_SIZE);
+      for (std::size_t height = 0; height < top; ++height) {
+            node = hash_pair(node, siblings[height]);
+      }
+      frontier[top] = node;
+}
+
+void skynet::MerkleTree::AlignedDeleter::operator()(byte *ptr) const {
+      ::operator delete[](ptr, std::align_val_t(MERKLE_NODE_ALIGNMENT));
 }
 
 // MIT License
@@ -100,4 +591,4 @@ void skynet::MerkleTree::PrintNodes() {
 // AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
 // LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
-// SOFTWARE.
\ No newline at end of file
+// SOFTWARE.
@@ -7,6 +7,23 @@
  * @details A Merkle Tree is a data structure that is used to verify the integrity of data.
  *          In skynet, Merkle Trees are used to verify the integrity of the transactions in a block.
  *
+ *          The tree is built level by level over a single contiguous, 32 byte aligned node
+ *          buffer: every pair of nodes is hashed into its parent, which is written back over
+ *          the front of the same buffer, until a single node (the root) is left. When a level
+ *          has an odd number of nodes, the last one is paired with itself (as in Bitcoin).
+ *
+ *          Large trees can be built on a thread pool: the lower levels are split into
+ *          power of two sized subtrees that are reduced concurrently, and only the few
+ *          subtree roots left are reduced by the calling thread.
+ *
+ *          Inclusion proofs let light nodes check a transaction is in a block from the
+ *          block header and O(log n) hashes: a MerkleBranch proves a single leaf, and a
+ *          MerkleMultiProof proves several leaves at once, sharing the common hashes.
+ *
+ *          Block templates grow one transaction at a time, so MerkleAccumulator keeps only the
+ *          roots of the perfect subtrees seen so far (one per set bit of the leaf count), which
+ *          is enough to append a leaf or get the root in O(log n) hashes.
+ *
  * @version 0.1
  * @date 2023-10-29
  * @license MIT
@@ -17,47 +34,263 @@
 #define SKYNET_MERKLE_TREE_HPP
 
 /** C++ Includes */
-#include <vector>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 /** Skynet Includes */
 #include <types.hpp>
+#include <crypto/sha256.hpp>
+
+namespace threading { class ThreadPool; }
 
 namespace skynet
 {
+      /** Size of a node (leaf or inner hash) in the Merkle Tree */
+      constexpr std::size_t MERKLE_NODE_SIZE = crypto::hashing::SHA256_HASH_SIZE;
+      /** Alignment of the node buffers, so SIMD kernels can load whole nodes */
+      constexpr std::size_t MERKLE_NODE_ALIGNMENT = 32;
+      /** Trees with fewer leaves than this are always built by the calling thread */
+      constexpr std::size_t MERKLE_PARALLEL_THRESHOLD = 4096;
+      /** Smallest subtree handed to a worker, smaller ones cost more to schedule than to hash */
+      constexpr std::size_t MERKLE_MIN_SUBTREE_SIZE = 1024;
+
+      /**
+       * @brief Audit path of a single leaf: the sibling of every node on the way
+       *        from the leaf up to the root.
+       */
+      struct MerkleBranch {
+            uint32_t index;                           /** Position of the leaf in the tree */
+            uint32_t leafCount;                       /** Number of leaves in the tree */
+            std::vector<Hash256> hashes;              /** Siblings, from the leaf level up */
+      };
+
+      /**
+       * @brief Compact proof for several leaves of the same tree.
+       *
+       * @details The tree is walked depth first from the root. Each visited node adds one flag
+       *          bit, set when the node is an ancestor of (or is) a proven leaf. Nodes with the
+       *          bit unset, and the proven leaves themselves, add their hash and are not
+       *          descended into, so hashes shared by several leaves are only sent once.
+       */
+      struct MerkleMultiProof {
+            uint32_t leafCount;                       /** Number of leaves in the tree */
+            std::vector<Hash256> hashes;              /** Hashes in depth first order */
+            std::vector<byte> flags;                  /** Flag bits in depth first order, packed LSB first */
+      };
+
+      /** A leaf recovered from a multi proof */
+      struct MerkleLeaf {
+            uint32_t index;                           /** Position of the leaf in the tree */
+            Hash256 hash;                             /** The leaf hash */
+      };
+
       class MerkleTree
       {
       public:
-            MerkleTree() = default;
+            /**
+             * @brief Creates a tree for `count` leaves.
+             * @details The node buffer is allocated once, here. Fill the leaves
+             *          through Leaf() and call Build() to compute the root.
+             *
+             * @param count The number of leaves
+             */
+            explicit MerkleTree(std::size_t count);
             ~MerkleTree() = default;
 
+            MerkleTree(const MerkleTree &) = delete;
+            MerkleTree &operator=(const MerkleTree &) = delete;
+
             /**
-             * @brief Adds a leaf to the Merkle Tree
-             * 
-             * @param leaf The leaf to be added
+             * @brief Returns a pointer to the `index`-th leaf, MERKLE_NODE_SIZE bytes long
              */
-            void AddLeaf(std::unique_ptr<byte[]> leaf);
+            byte *Leaf(std::size_t index) { return nodes.get() + index * MERKLE_NODE_SIZE; }
 
             /**
-             * @brief Returns the root of the Merkle Tree
+             * @brief Reduces the leaves into the root.
+             * @details The leaves are overwritten by the inner levels, so Leaf() no longer
+             *          returns the original leaves after this call.
+             */
+            void Build();
+
+            /**
+             * @brief Reduces the leaves into the root, hashing subtrees on `pool`.
+             * @details Falls back to Build() below MERKLE_PARALLEL_THRESHOLD leaves.
+             *
+             * @param pool The (initialized) thread pool to run on
+             */
+            void Build(const threading::ThreadPool &pool);
+
+            /**
+             * @brief Returns the root of the Merkle Tree (all zeros for an empty tree)
              * 
-             * @return std::unique_ptr<byte[]> The root of the Merkle Tree
+             * @return const byte* The MERKLE_NODE_SIZE byte root, owned by the tree
+             */
+            const byte *Root() const { return root; }
+
+            /** Getters */
+            std::size_t LeafCount() const { return count; }
+
+            /**
+             * @brief Computes the Merkle root of `count` contiguous nodes in place.
+             * @details Takes O(n) hashes and no allocations, the nodes are used as
+             *          scratch space for the inner levels and are clobbered.
+             *
+             * @param nodes The leaves, count * MERKLE_NODE_SIZE bytes
+             * @param count The number of leaves
+             * @param root Where to write the MERKLE_NODE_SIZE byte root (all zeros if count is 0)
+             */
+            static void ComputeRoot(byte *nodes, std::size_t count, byte *root);
+
+            /**
+             * @brief Computes the Merkle root of `count` contiguous nodes in place,
+             *        reducing independent subtrees concurrently on `pool`.
+             * @details Produces the same root as the single threaded version, which
+             *          is used below MERKLE_PARALLEL_THRESHOLD leaves.
+             *
+             * @param nodes The leaves, count * MERKLE_NODE_SIZE bytes
+             * @param count The number of leaves
+             * @param root Where to write the MERKLE_NODE_SIZE byte root (all zeros if count is 0)
+             * @param pool The (initialized) thread pool to run on
+             */
+            static void ComputeRoot(byte *nodes, std::size_t count, byte *root, const threading::ThreadPool &pool);
+
+            /**
+             * @brief Extracts the audit path of a leaf.
+             *
+             * @param leaves The leaves, count * MERKLE_NODE_SIZE bytes (left untouched)
+             * @param count The number of leaves
+             * @param index The leaf to prove
+             * @return MerkleBranch The branch of the leaf
+             * @throws std::out_of_range If index is not a leaf of the tree
+             */
+            static MerkleBranch GetBranch(const byte *leaves, std::size_t count, std::size_t index);
+
+            /**
+             * @brief Builds a compact proof for several leaves.
+             *
+             * @param leaves The leaves, count * MERKLE_NODE_SIZE bytes (left untouched)
+             * @param count The number of leaves
+             * @param indexes The leaves to prove, in any order
+             * @return MerkleMultiProof The proof
+             * @throws std::invalid_argument If indexes is empty
+             * @throws std::out_of_range If any of the indexes is not a leaf of the tree (so always
+             *                           for an empty tree)
              */
-            std::unique_ptr<byte[]> Root() const;
+            static MerkleMultiProof GetMultiProof(const byte *leaves, std::size_t count, const std::vector<uint32_t> &indexes);
+
+            /**
+             * @brief Checks that `leaf` is in the tree with the given root.
+             * @details Also rejects branches of the wrong length for the tree size, and
+             *          duplicated siblings anywhere but on the odd node out of a level.
+             *
+             * @param leaf The MERKLE_NODE_SIZE byte leaf
+             * @param branch The branch of the leaf
+             * @param root The expected root
+             * @return true If the branch proves the leaf
+             */
+            static bool VerifyBranch(const byte *leaf, const MerkleBranch &branch, const byte *root);
+
+            /**
+             * @brief Checks a multi proof against a root and recovers the proven leaves.
+             * @details Rejects proofs with unused hashes or flags, and proofs that pair
+             *          two identical subtrees (only the odd node out may be duplicated).
+             *
+             * @param proof The proof
+             * @param root The expected root
+             * @param leaves Filled with the proven leaves, ordered by index
+             * @return true If the proof is well formed and hashes up to `root`
+             */
+            static bool VerifyMultiProof(const MerkleMultiProof &proof, const byte *root, std::vector<MerkleLeaf> &leaves);
 
       private:
+            /** Releases the aligned node buffer */
+            struct AlignedDeleter {
+                  void operator()(byte *ptr) const;
+            };
+
             /** Member variables */
-            std::vector<std::unique_ptr<byte[]>> leaves;
-            std::vector<std::unique_ptr<byte[]>> nodes;
-            std::unique_ptr<byte[]> root;
-
-            /** Member functions */
-            void BuildNodes();
-            void BuildRoot();
-            void PrintNodes();
+            std::unique_ptr<byte[], AlignedDeleter> nodes;
+            std::size_t count;
+            byte root[MERKLE_NODE_SIZE];
       };
-} // namespace skynet
+      /**
+       * @brief Append only Merkle tree that only keeps its frontier.
+       *
+       * @details frontier[l] holds the root of a perfect subtree of 2^l leaves whenever bit l of
+       *          the leaf count is set. Appending a leaf carries it up like a binary increment, and
+       *          the root is the frontier folded right to left, pairing the odd node out of a level
+       *          with itself. Gives the same root as MerkleTree for the same leaves.
+       */
+      class MerkleAccumulator
+      {
+      public:
+            MerkleAccumulator() = default;
+            ~MerkleAccumulator() = default;
+
+            /**
+             * @brief Appends a leaf, in O(log n) hashes.
+             * 
+             * @param leaf The MERKLE_NODE_SIZE byte leaf
+             * @throws std::length_error If the tree is full (2^32 - 1 leaves)
+             */
+            void Append(const byte *leaf);
+
+            /**
+             * @brief Computes the root of the leaves appended so far, in O(log n) hashes.
+             * 
+             * @param root Where to write the MERKLE_NODE_SIZE byte root (all zeros if there are no leaves)
+             */
+            void Root(byte *root) const;
 
+            /** Getters */
+            uint32_t Size() const { return count; }
+
+      protected:
+            std::array<Hash256, 32> frontier;         /** Perfect subtree roots, by height */
+            uint32_t count = 0;                       /** Number of leaves */
+      };
+
+      /**
+       * @brief Accumulator whose first leaf (the coinbase) can be replaced in O(log n) hashes.
+       *
+       * @details Rolling the extra nonce changes the coinbase, and with it the root, many times
+       *          per template. The siblings on the coinbase's path never depend on the coinbase:
+       *          below the top of the frontier they are the perfect subtrees covering leaves
+       *          [2^l, 2^(l + 1)), which are cached as they are completed. Replacing the coinbase
+       *          only rehashes that path, the rest of the frontier is left untouched.
+       */
+      class CoinbaseMerkleAccumulator : private MerkleAccumulator
+      {
+      public:
+            CoinbaseMerkleAccumulator() = default;
+            ~CoinbaseMerkleAccumulator() = default;
+
+            /**
+             * @brief Appends a leaf, the first one is the coinbase.
+             * 
+             * @param leaf The MERKLE_NODE_SIZE byte leaf
+             * @throws std::length_error If the tree is full (2^32 - 1 leaves)
+             */
+            void Append(const byte *leaf);
+
+            /**
+             * @brief Replaces the coinbase (the first leaf), in O(log n) hashes.
+             * 
+             * @param leaf The new MERKLE_NODE_SIZE byte coinbase leaf
+             * @throws std::logic_error If no coinbase was appended yet
+             */
+            void ReplaceCoinbase(const byte *leaf);
+
+            using MerkleAccumulator::Root;
+            using MerkleAccumulator::Size;
+
+      private:
+            std::array<Hash256, 32> siblings;         /** Sibling of the coinbase's ancestor at each height */
+      };
+} // namespace skynet
 
 #endif // SKYNET_MERKLE_TREE_HPP
 
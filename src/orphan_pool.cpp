@@ -0,0 +1,117 @@
+//
+// Created by JoaoAJMatos on 18/11/2023.
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <utility>
+
+/** Local Includes */
+#include "orphan_pool.hpp"
+
+
+skynet::OrphanPool::OrphanPool(std::size_t maxBlocks, std::time_t expiry)
+      : maxBlocks(maxBlocks), expiry(expiry) {}
+
+/**
+ * @brief Adds a block waiting for its parent, making room for it if needed
+ *
+ * @param block The block
+ * @param now The current time
+ * @return true If the block was added
+ */
+bool skynet::OrphanPool::Add(std::shared_ptr<const Block> block, std::time_t now) {
+      const Hash256& hash = block->Hash();
+      if (Contains(hash)) return false;
+
+      Expire(now);
+      while (!orphans.empty() && orphans.size() >= maxBlocks) {
+            Remove(orphans.find(byAge.front()));
+      }
+      if (maxBlocks == 0) return false;
+
+      byParent[block->GetHeader().prevHash].push_back(hash);
+      byAge.push_back(hash);
+      orphans.emplace(hash, Orphan{ std::move(block), now, std::prev(byAge.end()) });
+      return true;
+}
+
+/**
+ * @brief Removes and returns the blocks waiting for the given parent
+ *
+ * @param parent The hash of the parent
+ * @return std::vector<std::shared_ptr<const Block>> The children
+ */
+std::vector<std::shared_ptr<const skynet::Block>> skynet::OrphanPool::TakeChildren(const Hash256& parent) {
+      std::vector<std::shared_ptr<const Block>> children;
+
+      auto waiting = byParent.find(parent);
+      if (waiting == byParent.end()) return children;
+
+      /** Removing the children edits the list being walked, take it first */
+      const std::vector<Hash256> hashes = std::move(waiting->second);
+      byParent.erase(waiting);
+
+      children.reserve(hashes.size());
+      for (const Hash256& hash : hashes) {
+            auto it = orphans.find(hash);
+            children.push_back(it->second.block);
+            byAge.erase(it->second.age);
+            orphans.erase(it);
+      }
+      return children;
+}
+
+/**
+ * @brief Drops the orphans received more than expiry seconds before now
+ *
+ * @param now The current time
+ */
+void skynet::OrphanPool::Expire(std::time_t now) {
+      while (!byAge.empty()) {
+            auto it = orphans.find(byAge.front());
+            if (it->second.received + expiry > now) break;
+            Remove(it);
+      }
+}
+
+void skynet::OrphanPool::Clear() {
+      orphans.clear();
+      byParent.clear();
+      byAge.clear();
+}
+
+/**
+ * @brief Removes an orphan from every index
+ */
+void skynet::OrphanPool::Remove(OrphanMap::iterator it) {
+      auto waiting = byParent.find(it->second.block->GetHeader().prevHash);
+      std::vector<Hash256>& siblings = waiting->second;
+      siblings.erase(std::find(siblings.begin(), siblings.end(), it->first));
+      if (siblings.empty()) byParent.erase(waiting);
+
+      byAge.erase(it->second.age);
+      orphans.erase(it);
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
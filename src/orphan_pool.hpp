@@ -0,0 +1,125 @@
+/**
+ * @file    orphan_pool.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   Blocks waiting for their parent.
+ *
+ *          Blocks whose parent is unknown (they arrived out of order, which is the
+ *          norm when syncing from several peers) are held here, indexed by the hash
+ *          of the parent they are missing. Once that parent is connected, its waiting
+ *          children are taken out with a single lookup, and theirs after them, without
+ *          scanning the pool. The pool is bounded in size and age, the oldest blocks
+ *          are evicted first.
+ *
+ * @date    2023-11-18
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ */
+
+#ifndef SKYNET_ORPHAN_POOL_HPP
+#define SKYNET_ORPHAN_POOL_HPP
+
+/** C++ Includes */
+#include <ctime>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/** Skynet Includes */
+#include <types.hpp>
+#include <block.hpp>
+
+namespace skynet
+{
+      /** Maximum number of orphan blocks held at once */
+      constexpr std::size_t MAX_ORPHAN_BLOCKS = 750;
+      /** Orphan blocks are dropped after this many seconds */
+      constexpr std::time_t ORPHAN_BLOCK_EXPIRY = 20 * 60;
+
+      class OrphanPool
+      {
+      public:
+            /**
+             * @param maxBlocks The maximum number of orphans, the oldest is evicted past it
+             * @param expiry The number of seconds after which an orphan is dropped
+             */
+            explicit OrphanPool(std::size_t maxBlocks = MAX_ORPHAN_BLOCKS, std::time_t expiry = ORPHAN_BLOCK_EXPIRY);
+
+            /**
+             * @brief Adds a block waiting for its parent
+             * @details Expired orphans are dropped first, then the oldest ones if the pool is full.
+             *
+             * @param block The block
+             * @param now The current time
+             * @return true If the block was added, false if it was already in the pool
+             */
+            bool Add(std::shared_ptr<const Block> block, std::time_t now);
+
+            /**
+             * @brief Removes and returns the blocks waiting for the given parent
+             *
+             * @param parent The hash of the parent
+             * @return std::vector<std::shared_ptr<const Block>> The children, oldest first
+             */
+            std::vector<std::shared_ptr<const Block>> TakeChildren(const Hash256& parent);
+
+            /** Drops the orphans received more than expiry seconds before now */
+            void Expire(std::time_t now);
+
+            /** Returns whether the block with the given hash is in the pool */
+            bool Contains(const Hash256& hash) const { return orphans.count(hash) > 0; }
+
+            /** Returns the number of orphans */
+            std::size_t Size() const { return orphans.size(); }
+
+            /** Drops every orphan */
+            void Clear();
+
+      private:
+            using AgeList = std::list<Hash256>;
+
+            struct Orphan {
+                  std::shared_ptr<const Block> block;
+                  std::time_t received;
+                  AgeList::iterator age;              /** Position in byAge */
+            };
+
+            using OrphanMap = std::unordered_map<Hash256, Orphan, Hash256Hasher>;
+
+            std::size_t maxBlocks;
+            std::time_t expiry;
+
+            OrphanMap orphans;                                                            /** By block hash */
+            std::unordered_map<Hash256, std::vector<Hash256>, Hash256Hasher> byParent;    /** By missing parent hash */
+            AgeList byAge;                                                                /** Oldest first */
+
+            void Remove(OrphanMap::iterator it);
+      };
+
+} // namespace skynet
+
+#endif // SKYNET_ORPHAN_POOL_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,265 @@
+//
+// Created by JoaoAJMatos on 08/11/2023.
+//
+
+/* C++ includes */
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/* Skynet includes */
+#include <crypto/sha256.hpp>
+
+/* Local includes */
+#include "methods.hpp"
+
+
+/**
+ * @brief Value of a hex digit, or -1 if the character is not one.
+ */
+static int hex_value(char c) {
+      if (c >= '0' && c <= '9') return c - '0';
+      if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+      if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+      return -1;
+}
+
+std::string rpc::ToHex(const byte *data, std::size_t len) {
+      static const char *digits = "0123456789abcdef";
+      std::string hex(len * 2, '0');
+      for (std::size_t i = 0; i < len; i++) {
+            hex[i * 2] = digits[data[i] >> 4];
+            hex[i * 2 + 1] = digits[data[i] & 0x0f];
+      }
+      return hex;
+}
+
+void rpc::FromHex(const std::string &hex, byte *out, std::size_t len) {
+      if (hex.size() != len * 2) {
+            throw JsonRpcException(error_type::INVALID_PARAMS, "invalid parameter: expected " + std::to_string(len * 2) + " hex digits");
+      }
+
+      for (std::size_t i = 0; i < len; i++) {
+            const int high = hex_value(hex[i * 2]);
+            const int low = hex_value(hex[i * 2 + 1]);
+            if (high < 0 || low < 0) {
+                  throw JsonRpcException(error_type::INVALID_PARAMS, "invalid parameter: not a hex string");
+            }
+            out[i] = static_cast<byte>((high << 4) | low);
+      }
+}
+
+rpc::json rpc::MerkleProofToJson(const skynet::MerkleMultiProof &proof) {
+      json hashes = json::array();
+      for (const auto &hash : proof.hashes) {
+            hashes.push_back(ToHex(hash.data(), hash.size()));
+      }
+
+      return json{
+            {"leaf_count", proof.leafCount},
+            {"hashes", hashes},
+            {"flags", ToHex(proof.flags.data(), proof.flags.size())}
+      };
+}
+
+rpc::json rpc::BlockToJson(const skynet::Block &block, std::size_t height) {
+      const skynet::BlockHeader &header = block.GetHeader();
+
+      json transactions = json::array();
+      for (const auto &transaction : block.GetTransactions()) {
+            const Hash256 &txid = transaction.Hash();
+            transactions.push_back(ToHex(txid.data(), txid.size()));
+      }
+
+      return json{
+            {"hash", ToHex(block.Hash().data(), block.Hash().size())},
+            {"height", height},
+            {"version", header.version},
+            {"prev_hash", ToHex(header.prevHash.data(), header.prevHash.size())},
+            {"merkle_root", ToHex(header.merkleRoot.data(), header.merkleRoot.size())},
+            {"timestamp", header.timestamp},
+            {"difficulty_target", header.difficultyTarget},
+            {"nonce", header.nonce},
+            {"transactions", transactions}
+      };
+}
+
+skynet::MerkleMultiProof rpc::MerkleProofFromJson(const json &value) {
+      if (!has_key_type(value, "leaf_count", json::value_t::number_unsigned) ||
+          !has_key_type(value, "hashes", json::value_t::array) ||
+          !has_key_type(value, "flags", json::value_t::string)) {
+            throw JsonRpcException(error_type::INVALID_PARAMS, "invalid parameter: malformed merkle proof");
+      }
+
+      skynet::MerkleMultiProof proof;
+      proof.leafCount = value["leaf_count"].get<uint32_t>();
+
+      for (const auto &hash : value["hashes"]) {
+            if (!hash.is_string()) {
+                  throw JsonRpcException(error_type::INVALID_PARAMS, "invalid parameter: malformed merkle proof");
+            }
+            proof.hashes.emplace_back();
+            FromHex(hash.get<std::string>(), proof.hashes.back().data(), skynet::MERKLE_NODE_SIZE);
+      }
+
+      const std::string flags = value["flags"].get<std::string>();
+      proof.flags.resize(flags.size() / 2);
+      FromHex(flags, proof.flags.data(), proof.flags.size());
+
+      return proof;
+}
+
+/**
+ * @brief Returns a block of the main chain as JSON
+ *
+ * @param chain The chain the block belongs to
+ * @param node The node of the block, nullptr if it wasn't found
+ * @param what How the block was asked for, for the error message
+ * @throws JsonRpcException If the block is not in the main chain
+ */
+static rpc::json main_chain_block_to_json(const skynet::Chain &chain, const skynet::BlockNode *node, const std::string &what) {
+      if (node == nullptr || !chain.IsInMainChain(*node)) {
+            throw rpc::JsonRpcException(rpc::error_type::INVALID_PARAMS, "block not found: " + what);
+      }
+
+      const std::shared_ptr<const skynet::Block> block = chain.GetBlock(*node);
+      if (!block) {
+            throw rpc::JsonRpcException(rpc::error_type::INTERNAL_ERROR, "block not available: " + what);
+      }
+      return rpc::BlockToJson(*block, node->height);
+}
+
+/**
+ * @brief Fetches a block of the main chain by hash
+ *
+ * @param chain The chain to look the block up in
+ * @param block_hash The hex hash of the block
+ * @throws JsonRpcException If the block can't be found
+ */
+static rpc::json get_block(const skynet::Chain &chain, const std::string &block_hash) {
+      Hash256 hash;
+      rpc::FromHex(block_hash, hash.data(), hash.size());
+
+      return main_chain_block_to_json(chain, chain.LookupBlock(hash), block_hash);
+}
+
+/**
+ * @brief Fetches a block of the main chain by height
+ *
+ * @param chain The chain to look the block up in
+ * @param height The height of the block
+ * @throws JsonRpcException If the chain is shorter
+ */
+static rpc::json get_block_by_height(const skynet::Chain &chain, uint64_t height) {
+      return main_chain_block_to_json(chain, chain.GetBlockNode(height), "height " + std::to_string(height));
+}
+
+/**
+ * @brief Builds a multi proof for some of the transactions of a block.
+ *
+ * @param chain The chain to look the block up in
+ * @param block_hash The hex hash of the block
+ * @param txids The hex hashes of the transactions to prove
+ * @return json The block's merkle root and the proof
+ * @throws JsonRpcException If the block or any of the transactions can't be found
+ */
+static rpc::json get_merkle_proof(const skynet::Chain &chain, const std::string &block_hash, const std::vector<std::string> &txids) {
+      using rpc::JsonRpcException;
+      using rpc::error_type;
+
+      Hash256 hash;
+      rpc::FromHex(block_hash, hash.data(), hash.size());
+
+      const skynet::BlockNode *node = chain.LookupBlock(hash);
+      const std::shared_ptr<const skynet::Block> block = node && chain.IsInMainChain(*node) ? chain.GetBlock(*node) : nullptr;
+      if (!block) {
+            throw JsonRpcException(error_type::INVALID_PARAMS, "block not found: " + block_hash);
+      }
+
+      /** The leaves are the transaction hashes, in block order */
+      const std::vector<skynet::Transaction> &transactions = block->GetTransactions();
+      std::vector<Hash256> leaves;
+      leaves.reserve(transactions.size());
+      for (const auto &transaction : transactions) {
+            leaves.push_back(transaction.Hash());
+      }
+
+      std::vector<uint32_t> indexes;
+      for (const auto &txid : txids) {
+            Hash256 leaf;
+            rpc::FromHex(txid, leaf.data(), leaf.size());
+
+            std::size_t index = 0;
+            while (index < leaves.size() && leaves[index] != leaf) index++;
+            if (index == leaves.size()) {
+                  throw JsonRpcException(error_type::INVALID_PARAMS, "transaction not in block: " + txid);
+            }
+            indexes.push_back(static_cast<uint32_t>(index));
+      }
+
+      if (indexes.empty()) {
+            throw JsonRpcException(error_type::INVALID_PARAMS, "invalid parameter: no transactions to prove");
+      }
+
+      const skynet::MerkleMultiProof proof = skynet::MerkleTree::GetMultiProof(leaves[0].data(), leaves.size(), indexes);
+
+      rpc::json result = rpc::MerkleProofToJson(proof);
+      result["block"] = block_hash;
+      result["merkle_root"] = rpc::ToHex(block->GetHeader().merkleRoot.data(), crypto::hashing::SHA256_HASH_SIZE);
+      return result;
+}
+
+void rpc::RegisterBlockMethods(JsonRpcServer &server, std::shared_ptr<skynet::Chain> chain) {
+      server.Add("get_block",
+                 GetHandle(std::function<json(const std::string &)>(
+                       [chain](const std::string &block_hash) {
+                             return get_block(*chain, block_hash);
+                       })),
+                 { "hash" });
+      server.Add("get_block_by_height",
+                 GetHandle(std::function<json(uint64_t)>(
+                       [chain](uint64_t height) {
+                             return get_block_by_height(*chain, height);
+                       })),
+                 { "height" });
+}
+
+void rpc::RegisterLightNodeMethods(JsonRpcServer &server, std::shared_ptr<skynet::Chain> chain) {
+      server.Add("get_merkle_proof",
+                 GetHandle(std::function<json(const std::string &, const std::vector<std::string> &)>(
+                       [chain](const std::string &block_hash, const std::vector<std::string> &txids) {
+                             return get_merkle_proof(*chain, block_hash, txids);
+                       })),
+                 { "block", "transactions" });
+}
+
+void rpc::RegisterNodeMethods(JsonRpcServer &server, std::shared_ptr<skynet::Chain> chain, const std::string &nodeType) {
+      if (nodeType == "full") {
+            RegisterBlockMethods(server, chain);
+            RegisterLightNodeMethods(server, chain);
+      } else if (nodeType != "light" && nodeType != "miner") {
+            throw std::invalid_argument("Unknown node type: " + nodeType);
+      }
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,109 @@
+/**
+ * @file   methods.hpp
+ * @author JoaoAJMatos
+ *
+ * @brief Skynet's JSON-RPC methods.
+ *
+ *        Each group of methods is registered on a server by its own function,
+ *        so every node type only exposes what it serves. The methods are
+ *        documented in src/rpc/README.md.
+ *
+ * @version 0.1
+ * @date 2023-11-08
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+#ifndef SKYNET_RPC_METHODS_HPP
+#define SKYNET_RPC_METHODS_HPP
+
+/* C++ includes */
+#include <memory>
+#include <string>
+
+/* Skynet includes */
+#include <types.hpp>
+#include <blockchain.hpp>
+#include <merkle_tree.hpp>
+#include <rpc/json_rpc.hpp>
+
+namespace rpc
+{
+      /**
+       * @brief Registers the methods light nodes use to check that transactions are
+       *        in a block without downloading it (`get_merkle_proof`).
+       *
+       * @param server The server to register the methods on
+       * @param chain The chain the proofs are built from
+       */
+      void RegisterLightNodeMethods(JsonRpcServer &server, std::shared_ptr<skynet::Chain> chain);
+
+      /**
+       * @brief Registers the methods that fetch blocks of the main chain (`get_block`
+       *        and `get_block_by_height`).
+       *
+       * @param server The server to register the methods on
+       * @param chain The chain the blocks are read from
+       */
+      void RegisterBlockMethods(JsonRpcServer &server, std::shared_ptr<skynet::Chain> chain);
+
+      /**
+       * @brief Registers every method a node of the given type serves, the single place
+       *        the method groups above are put together.
+       * @details Full nodes hold the whole chain, so they serve its blocks and the proofs
+       *          light nodes ask for. Light and miner nodes don't keep the block history and
+       *          serve neither.
+       *
+       * @param server The server to register the methods on
+       * @param chain The chain of the node
+       * @param nodeType The `type` of the node config: `full`, `light` or `miner`
+       * @throws std::invalid_argument If the node type is unknown
+       */
+      void RegisterNodeMethods(JsonRpcServer &server, std::shared_ptr<skynet::Chain> chain, const std::string &nodeType);
+
+      /** Converts a block to its JSON representation (as returned by `get_block`) */
+      json BlockToJson(const skynet::Block &block, std::size_t height);
+
+      /** Converts a multi proof to its JSON representation (as returned by `get_merkle_proof`) */
+      json MerkleProofToJson(const skynet::MerkleMultiProof &proof);
+
+      /**
+       * @brief Parses the JSON representation of a multi proof.
+       * @throws JsonRpcException If the proof is malformed
+       */
+      skynet::MerkleMultiProof MerkleProofFromJson(const json &value);
+
+      /** Hex encoding of a byte string */
+      std::string ToHex(const byte *data, std::size_t len);
+
+      /**
+       * @brief Decodes a hex string of exactly `len` bytes into `out`.
+       * @throws JsonRpcException If the string is not valid hex of the expected length
+       */
+      void FromHex(const std::string &hex, byte *out, std::size_t len);
+
+} // namespace rpc
+
+#endif // SKYNET_RPC_METHODS_HPP
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
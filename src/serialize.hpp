@@ -0,0 +1,421 @@
+/**
+ * @file    serialize.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   Compact binary serialization, shared by the disk storage, P2P relay
+ *          and binary RPC responses.
+ *
+ *          Types are (de)serialized through the Serializer<T> trait, specialized
+ *          next to the type it handles. Integers are written fixed width and little
+ *          endian, byte arrays are written raw and containers are prefixed with
+ *          their length as a CompactSize:
+ *
+ *            value < 0xfd          1 byte
+ *            value <= 0xffff       0xfd followed by 2 bytes
+ *            value <= 0xffffffff   0xfe followed by 4 bytes
+ *            otherwise             0xff followed by 8 bytes
+ *
+ *          Writing goes through any stream with a Write(const byte*, size_t) member
+ *          (a reusable WriteBuffer, a HashWriter, a SizeComputer). Reading parses
+ *          straight from a ReadBuffer, a bounds checked view over const bytes, so
+ *          nothing is copied before it lands in the destination object.
+ *
+ * @date    2023-11-12
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ *
+ * @example
+ * serialize::WriteBuffer buffer;
+ * serialize::Serialize(buffer, block);
+ *
+ * serialize::ReadBuffer reader(buffer.Data(), buffer.Size());
+ * skynet::Block copy;
+ * serialize::Unserialize(reader, copy);
+ */
+
+#ifndef SKYNET_SERIALIZE_HPP
+#define SKYNET_SERIALIZE_HPP
+
+/** C++ Includes */
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/** Skynet Includes */
+#include <types.hpp>
+#include <crypto/sha256.hpp>
+
+namespace serialize
+{
+      /** Largest CompactSize accepted when reading a container length */
+      constexpr uint64_t MAX_SIZE = 0x02000000;
+
+      /**
+       * @brief Thrown when the data being read is truncated or malformed
+       */
+      class SerializationError : public std::runtime_error
+      {
+      public:
+            explicit SerializationError(const std::string& message) : std::runtime_error(message) {}
+      };
+
+      /** Little endian helpers for fixed layouts */
+      inline void WriteLE16(byte *out, uint16_t value) {
+            out[0] = static_cast<byte>(value);
+            out[1] = static_cast<byte>(value >> 8);
+      }
+
+      inline void WriteLE32(byte *out, uint32_t value) {
+            out[0] = static_cast<byte>(value);
+            out[1] = static_cast<byte>(value >> 8);
+            out[2] = static_cast<byte>(value >> 16);
+            out[3] = static_cast<byte>(value >> 24);
+      }
+
+      inline void WriteLE64(byte *out, uint64_t value) {
+            WriteLE32(out, static_cast<uint32_t>(value));
+            WriteLE32(out + 4, static_cast<uint32_t>(value >> 32));
+      }
+
+      inline uint16_t ReadLE16(const byte *in) {
+            return static_cast<uint16_t>(in[0] | (in[1] << 8));
+      }
+
+      inline uint32_t ReadLE32(const byte *in) {
+            return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+      }
+
+      inline uint64_t ReadLE64(const byte *in) {
+            return uint64_t(ReadLE32(in)) | (uint64_t(ReadLE32(in + 4)) << 32);
+      }
+
+      /**
+       * @brief Growable output buffer. Clear() keeps the allocation, so a buffer
+       *        can be reused to serialize many objects.
+       */
+      class WriteBuffer
+      {
+      public:
+            WriteBuffer() = default;
+            explicit WriteBuffer(std::size_t capacity) { buffer.reserve(capacity); }
+
+            void Write(const byte *data, std::size_t size) { buffer.insert(buffer.end(), data, data + size); }
+            void Clear() { buffer.clear(); }
+
+            [[nodiscard]] const byte* Data() const { return buffer.data(); }
+            [[nodiscard]] std::size_t Size() const { return buffer.size(); }
+            [[nodiscard]] const std::vector<byte>& Bytes() const { return buffer; }
+
+      private:
+            std::vector<byte> buffer;
+      };
+
+      /**
+       * @brief Bounds checked reader over bytes owned by someone else
+       */
+      class ReadBuffer
+      {
+      public:
+            ReadBuffer(const byte *data, std::size_t size) : data(data), size(size) {}
+            explicit ReadBuffer(const std::vector<byte>& bytes) : data(bytes.data()), size(bytes.size()) {}
+
+            /**
+             * @brief Consumes size bytes without copying them
+             *
+             * @return const byte* The consumed bytes, valid as long as the underlying data
+             * @throws SerializationError If fewer than size bytes are left
+             */
+            const byte* View(std::size_t size) {
+                  if (size > Remaining()) throw SerializationError("Unexpected end of data");
+                  const byte *view = this->data + this->position;
+                  this->position += size;
+                  return view;
+            }
+
+            /** Copies the next size bytes into out */
+            void Read(byte *out, std::size_t size) { memcpy(out, View(size), size); }
+
+            [[nodiscard]] std::size_t Remaining() const { return this->size - this->position; }
+            [[nodiscard]] std::size_t Position() const { return this->position; }
+            [[nodiscard]] bool Empty() const { return Remaining() == 0; }
+
+      private:
+            const byte *data;
+            std::size_t size;
+            std::size_t position = 0;
+      };
+
+      /**
+       * @brief Stream that hashes what is written to it instead of storing it
+       */
+      class HashWriter
+      {
+      public:
+            void Write(const byte *data, std::size_t size) { context.Update(data, size); }
+            void Final(byte *hash) { context.Final(hash); }
+
+      private:
+            crypto::hashing::SHA256 context;
+      };
+
+      /**
+       * @brief Stream that only counts the bytes written to it
+       */
+      class SizeComputer
+      {
+      public:
+            void Write(const byte *, std::size_t size) { this->size += size; }
+            [[nodiscard]] std::size_t Size() const { return size; }
+
+      private:
+            std::size_t size = 0;
+      };
+
+      /** Raw bytes written (or read) as is, without a length prefix */
+      struct ByteSpan {
+            byte *data;
+            std::size_t size;
+      };
+
+      struct ConstByteSpan {
+            const byte *data;
+            std::size_t size;
+      };
+
+      /**
+       * @brief Serialization trait. Specializations provide
+       *
+       *        template<typename Stream> static void Write(Stream& stream, const T& value);
+       *        static void Read(ReadBuffer& reader, T& value);
+       *
+       *        Types without a specialization can't be serialized.
+       */
+      template<typename T, typename Enable = void>
+      struct Serializer;
+
+      template<typename Stream, typename T>
+      void Serialize(Stream& stream, const T& value) {
+            Serializer<T>::Write(stream, value);
+      }
+
+      template<typename T>
+      void Unserialize(ReadBuffer& reader, T& value) {
+            Serializer<T>::Read(reader, value);
+      }
+
+      /** Returns the size of the serialization of value */
+      template<typename T>
+      std::size_t GetSerializedSize(const T& value) {
+            SizeComputer computer;
+            Serialize(computer, value);
+            return computer.Size();
+      }
+
+      /**
+       * @brief Writes a CompactSize
+       */
+      template<typename Stream>
+      void WriteCompactSize(Stream& stream, uint64_t value) {
+            byte buffer[9];
+            std::size_t size;
+
+            if (value < 0xfd) {
+                  buffer[0] = static_cast<byte>(value);
+                  size = 1;
+            } else if (value <= 0xffff) {
+                  buffer[0] = 0xfd;
+                  WriteLE16(buffer + 1, static_cast<uint16_t>(value));
+                  size = 3;
+            } else if (value <= 0xffffffff) {
+                  buffer[0] = 0xfe;
+                  WriteLE32(buffer + 1, static_cast<uint32_t>(value));
+                  size = 5;
+            } else {
+                  buffer[0] = 0xff;
+                  WriteLE64(buffer + 1, value);
+                  size = 9;
+            }
+
+            stream.Write(buffer, size);
+      }
+
+      /**
+       * @brief Reads a CompactSize
+       *
+       * @param reader The reader
+       * @param max The largest value accepted
+       * @throws SerializationError If the value is not minimally encoded or is above max
+       */
+      inline uint64_t ReadCompactSize(ReadBuffer& reader, uint64_t max = MAX_SIZE) {
+            const byte prefix = *reader.View(1);
+            uint64_t value;
+
+            if (prefix < 0xfd) {
+                  value = prefix;
+            } else if (prefix == 0xfd) {
+                  value = ReadLE16(reader.View(2));
+                  if (value < 0xfd) throw SerializationError("Non canonical CompactSize");
+            } else if (prefix == 0xfe) {
+                  value = ReadLE32(reader.View(4));
+                  if (value <= 0xffff) throw SerializationError("Non canonical CompactSize");
+            } else {
+                  value = ReadLE64(reader.View(8));
+                  if (value <= 0xffffffff) throw SerializationError("Non canonical CompactSize");
+            }
+
+            if (value > max) throw SerializationError("CompactSize exceeds the maximum size");
+            return value;
+      }
+
+      /** Integers, fixed width and little endian */
+      template<typename T>
+      struct Serializer<T, std::enable_if_t<std::is_integral<T>::value>> {
+            using Unsigned = std::make_unsigned_t<T>;
+
+            template<typename Stream>
+            static void Write(Stream& stream, const T& value) {
+                  byte buffer[sizeof(T)];
+                  const auto bits = static_cast<Unsigned>(value);
+                  for (std::size_t i = 0; i < sizeof(T); i++) {
+                        buffer[i] = static_cast<byte>(static_cast<uint64_t>(bits) >> (8 * i));
+                  }
+                  stream.Write(buffer, sizeof(T));
+            }
+
+            static void Read(ReadBuffer& reader, T& value) {
+                  const byte *in = reader.View(sizeof(T));
+                  uint64_t bits = 0;
+                  for (std::size_t i = 0; i < sizeof(T); i++) {
+                        bits |= static_cast<uint64_t>(in[i]) << (8 * i);
+                  }
+                  value = static_cast<T>(static_cast<Unsigned>(bits));
+            }
+      };
+
+      /** Floats, through their IEEE 754 bit pattern */
+      template<>
+      struct Serializer<float> {
+            static_assert(sizeof(float) == sizeof(uint32_t), "float must be 32 bits wide");
+
+            template<typename Stream>
+            static void Write(Stream& stream, const float& value) {
+                  uint32_t bits;
+                  memcpy(&bits, &value, sizeof(bits));
+                  Serializer<uint32_t>::Write(stream, bits);
+            }
+
+            static void Read(ReadBuffer& reader, float& value) {
+                  uint32_t bits;
+                  Serializer<uint32_t>::Read(reader, bits);
+                  memcpy(&value, &bits, sizeof(value));
+            }
+      };
+
+      /** Fixed size byte arrays (keys, signatures), written raw */
+      template<std::size_t N>
+      struct Serializer<byte[N]> {
+            template<typename Stream>
+            static void Write(Stream& stream, const byte (&value)[N]) { stream.Write(value, N); }
+            static void Read(ReadBuffer& reader, byte (&value)[N]) { reader.Read(value, N); }
+      };
+
+      /** Fixed size hashes, written raw */
+      template<std::size_t N>
+      struct Serializer<std::array<byte, N>> {
+            template<typename Stream>
+            static void Write(Stream& stream, const std::array<byte, N>& value) { stream.Write(value.data(), N); }
+            static void Read(ReadBuffer& reader, std::array<byte, N>& value) { reader.Read(value.data(), N); }
+      };
+
+      template<>
+      struct Serializer<ConstByteSpan> {
+            template<typename Stream>
+            static void Write(Stream& stream, const ConstByteSpan& span) { stream.Write(span.data, span.size); }
+      };
+
+      template<>
+      struct Serializer<ByteSpan> {
+            template<typename Stream>
+            static void Write(Stream& stream, const ByteSpan& span) { stream.Write(span.data, span.size); }
+            static void Read(ReadBuffer& reader, ByteSpan& span) { reader.Read(span.data, span.size); }
+      };
+
+      /** Strings, CompactSize length followed by the characters */
+      template<>
+      struct Serializer<std::string> {
+            template<typename Stream>
+            static void Write(Stream& stream, const std::string& value) {
+                  WriteCompactSize(stream, value.size());
+                  stream.Write(reinterpret_cast<const byte*>(value.data()), value.size());
+            }
+
+            static void Read(ReadBuffer& reader, std::string& value) {
+                  const auto size = static_cast<std::size_t>(ReadCompactSize(reader));
+                  const byte *data = reader.View(size);
+                  value.assign(reinterpret_cast<const char*>(data), size);
+            }
+      };
+
+      /** Vectors, CompactSize length followed by the elements */
+      template<typename T>
+      struct Serializer<std::vector<T>> {
+            template<typename Stream>
+            static void Write(Stream& stream, const std::vector<T>& values) {
+                  WriteCompactSize(stream, values.size());
+                  if constexpr (std::is_same<T, byte>::value) {
+                        stream.Write(values.data(), values.size());
+                  } else {
+                        for (const auto& value : values) Serializer<T>::Write(stream, value);
+                  }
+            }
+
+            static void Read(ReadBuffer& reader, std::vector<T>& values) {
+                  const auto count = static_cast<std::size_t>(ReadCompactSize(reader));
+                  values.clear();
+
+                  if constexpr (std::is_same<T, byte>::value) {
+                        const byte *data = reader.View(count);
+                        values.assign(data, data + count);
+                  } else {
+                        /** Every element takes at least a byte, don't let a bogus length allocate more than that */
+                        values.reserve(std::min(count, reader.Remaining()));
+                        for (std::size_t i = 0; i < count; i++) {
+                              values.emplace_back();
+                              Serializer<T>::Read(reader, values.back());
+                        }
+                  }
+            }
+      };
+
+} // namespace serialize
+
+#endif // SKYNET_SERIALIZE_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
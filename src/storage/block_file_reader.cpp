@@ -0,0 +1,181 @@
+//
+// Created by JoaoAJMatos on 15/11/2023.
+//
+
+/** C++ Includes */
+#include <cerrno>
+#include <cstring>
+
+/** System Includes */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Skynet Includes */
+#include <serialize.hpp>
+#include <storage/block_store.hpp>
+
+/** Local Includes */
+#include "block_file_reader.hpp"
+
+
+/**
+ * @brief Maps a whole file read only
+ *
+ * @param path The file to map
+ * @throws StorageException If the file can't be opened or mapped
+ */
+storage::MappedFile::MappedFile(const std::string& path) {
+      const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+            throw StorageException("Could not open block file " + path + ": " + strerror(errno));
+      }
+
+      struct stat info {};
+      if (fstat(fd, &info) != 0) {
+            const int error = errno;
+            close(fd);
+            throw StorageException("Could not stat block file " + path + ": " + strerror(error));
+      }
+
+      this->size = static_cast<uint64_t>(info.st_size);
+      if (this->size > 0) {
+            void *mapping = mmap(nullptr, this->size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping == MAP_FAILED) {
+                  const int error = errno;
+                  close(fd);
+                  throw StorageException("Could not map block file " + path + ": " + strerror(error));
+            }
+            this->data = static_cast<const byte*>(mapping);
+      }
+
+      /** The mapping keeps the file referenced */
+      close(fd);
+}
+
+storage::MappedFile::~MappedFile() {
+      if (data != nullptr) {
+            munmap(const_cast<byte*>(data), size);
+      }
+}
+
+/**
+ * @brief Hints the kernel about how a range of the file is going to be read
+ *
+ * @details Sequential readers get aggressive read ahead and have the range prefetched,
+ *          random readers get read ahead disabled so a single block read doesn't pull
+ *          in the pages around it.
+ *
+ * @param offset The start of the range
+ * @param size The size of the range
+ * @param pattern How the range is going to be read
+ */
+void storage::MappedFile::Advise(uint64_t offset, uint64_t size, AccessPattern pattern) const {
+      if (data == nullptr || size == 0) return;
+
+      /** madvise wants a page aligned start */
+      static const uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+      const uint64_t start = offset - offset % page_size;
+      byte *address = const_cast<byte*>(data) + start;
+      const std::size_t length = static_cast<std::size_t>(offset + size - start);
+
+      if (pattern == AccessPattern::SEQUENTIAL) {
+            madvise(address, length, MADV_SEQUENTIAL);
+            madvise(address, length, MADV_WILLNEED);
+      } else {
+            madvise(address, length, MADV_RANDOM);
+      }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+storage::BlockFileReader::BlockFileReader(std::function<std::string(uint32_t)> path, std::size_t maxOpenFiles)
+      : path(std::move(path)), maxOpenFiles(maxOpenFiles == 0 ? 1 : maxOpenFiles) {}
+
+/**
+ * @brief Returns the mapping of a block file that covers at least end bytes
+ *
+ * @param file The number of the file
+ * @param end The number of bytes the mapping must cover
+ * @return std::shared_ptr<const MappedFile> The mapping
+ */
+std::shared_ptr<const storage::MappedFile> storage::BlockFileReader::Map(uint32_t file, uint64_t end) {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      auto it = files.find(file);
+      if (it != files.end()) {
+            lru.splice(lru.begin(), lru, it->second.second);
+            if (it->second.first->Size() >= end) {
+                  return it->second.first;
+            }
+
+            /** The file grew since it was mapped */
+            it->second.first = std::make_shared<const MappedFile>(path(file));
+            return it->second.first;
+      }
+
+      auto mapping = std::make_shared<const MappedFile>(path(file));
+      lru.push_front(file);
+      files.emplace(file, std::make_pair(mapping, lru.begin()));
+
+      if (files.size() > maxOpenFiles) {
+            files.erase(lru.back());
+            lru.pop_back();
+      }
+
+      return mapping;
+}
+
+/**
+ * @brief Returns a view over a stored block
+ *
+ * @param location Where the block is stored
+ * @param pattern How the caller is reading the blocks
+ * @return MappedBlock The view, with the mapping it points into
+ */
+storage::MappedBlock storage::BlockFileReader::Read(const BlockFileLocation& location, AccessPattern pattern) {
+      const uint64_t end = location.offset + location.size;
+      std::shared_ptr<const MappedFile> mapping = Map(location.file, end);
+
+      if (location.offset < BLOCK_RECORD_HEADER_SIZE || mapping->Size() < end) {
+            throw StorageException("Block record out of the bounds of " + path(location.file));
+      }
+
+      const byte *prefix = mapping->Data() + location.offset - BLOCK_RECORD_HEADER_SIZE;
+      if (serialize::ReadLE32(prefix) != BLOCK_FILE_MAGIC || serialize::ReadLE32(prefix + 4) != location.size) {
+            throw StorageException("Corrupted block record in " + path(location.file));
+      }
+
+      mapping->Advise(location.offset, location.size, pattern);
+      skynet::BlockView view(mapping->Data() + location.offset, location.size);
+      return MappedBlock{ std::move(mapping), view };
+}
+
+void storage::BlockFileReader::Clear() {
+      std::lock_guard<std::mutex> lock(mutex);
+      files.clear();
+      lru.clear();
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
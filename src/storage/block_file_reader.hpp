@@ -0,0 +1,154 @@
+/**
+ * @file    block_file_reader.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   Memory mapped access to the block files.
+ *
+ *          Blocks are read straight out of read only mappings of their file instead
+ *          of being copied into a buffer, so serving a block costs no more than the
+ *          page faults it triggers (usually none, the page cache is shared with the
+ *          writer). The mappings of the most recently used files are kept open and
+ *          reused across requests. Offsets and sizes are 64 bit, files larger than
+ *          4 GB are fine.
+ *
+ *          Only available on POSIX systems.
+ *
+ * @date    2023-11-15
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ */
+
+#ifndef SKYNET_BLOCK_FILE_READER_HPP
+#define SKYNET_BLOCK_FILE_READER_HPP
+
+/** C++ Includes */
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/** Skynet Includes */
+#include <types.hpp>
+#include <block_view.hpp>
+
+namespace storage
+{
+      struct BlockFileLocation;
+
+      /** Number of block file mappings kept open by default */
+      constexpr std::size_t MAX_MAPPED_BLOCK_FILES = 8;
+
+      /**
+       * @brief How a read is going to walk the file, passed on to the kernel (madvise)
+       */
+      enum class AccessPattern : uint8_t {
+            SEQUENTIAL = 0,         /** Blocks are read in file order (syncing peers, reindexing) */
+            RANDOM = 1,             /** Scattered single block reads (RPC) */
+      };
+
+      /**
+       * @brief Read only mapping of a whole file
+       */
+      class MappedFile
+      {
+      public:
+            /**
+             * @param path The file to map
+             * @throws StorageException If the file can't be opened or mapped
+             */
+            explicit MappedFile(const std::string& path);
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            /** Hints the kernel about how a range of the file is going to be read */
+            void Advise(uint64_t offset, uint64_t size, AccessPattern pattern) const;
+
+            const byte* Data() const { return data; }
+            uint64_t Size() const { return size; }
+
+      private:
+            const byte *data = nullptr;
+            uint64_t size = 0;
+      };
+
+      /**
+       * @brief A block read in place, it keeps its mapping alive as long as it is around
+       */
+      struct MappedBlock {
+            std::shared_ptr<const MappedFile> file;
+            skynet::BlockView view;
+      };
+
+      /**
+       * @brief Maps block files on demand, keeping the most recently used ones mapped
+       *
+       * @details Thread safe. A file that grew past its mapping (the one being appended
+       *          to) is mapped again when a block beyond the old end is requested.
+       */
+      class BlockFileReader
+      {
+      public:
+            /**
+             * @param path Returns the path of a block file given its number
+             * @param maxOpenFiles The number of mappings to keep open
+             */
+            explicit BlockFileReader(std::function<std::string(uint32_t)> path, std::size_t maxOpenFiles = MAX_MAPPED_BLOCK_FILES);
+
+            /**
+             * @brief Returns a view over a stored block
+             *
+             * @param location Where the block is stored
+             * @param pattern How the caller is reading the blocks
+             * @throws StorageException If the file can't be mapped or the record is corrupted
+             * @throws serialize::SerializationError If the block is malformed
+             */
+            MappedBlock Read(const BlockFileLocation& location, AccessPattern pattern);
+
+            /** Drops every mapping (the views handed out stay valid) */
+            void Clear();
+
+      private:
+            using LruList = std::list<uint32_t>;
+
+            std::function<std::string(uint32_t)> path;
+            std::size_t maxOpenFiles;
+
+            std::mutex mutex;
+            LruList lru;                              /** File numbers, most recently used first */
+            std::unordered_map<uint32_t, std::pair<std::shared_ptr<const MappedFile>, LruList::iterator>> files;
+
+            std::shared_ptr<const MappedFile> Map(uint32_t file, uint64_t end);
+      };
+
+} // namespace storage
+
+#endif // SKYNET_BLOCK_FILE_READER_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,529 @@
+//
+// Created by JoaoAJMatos on 14/11/2023.
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <utility>
+
+/** Local Includes */
+#include "block_store.hpp"
+
+
+/** Name of the index log inside the store directory */
+static const char *INDEX_FILE_NAME = "index.dat";
+
+/**
+ * @brief Returns the size of a file, 0 if it doesn't exist
+ */
+static uint64_t file_size_or_zero(const std::filesystem::path& path) {
+      std::error_code error;
+      const auto size = std::filesystem::file_size(path, error);
+      return error ? 0 : static_cast<uint64_t>(size);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+storage::BlockStore::BlockStore(std::string directory, uint64_t maxFileSize)
+      : directory(std::move(directory)), maxFileSize(maxFileSize),
+        reader([this](uint32_t file) { return BlockFilePath(file); }) {}
+
+storage::BlockStore::~BlockStore() {
+      if (blockFile.is_open()) blockFile.flush();
+      if (undoFile.is_open()) undoFile.flush();
+      if (indexFile.is_open()) indexFile.flush();
+}
+
+/**
+ * @brief Returns the path of a block file
+ *
+ * @param file The number of the file
+ * @return std::string <directory>/blkNNNNN.dat
+ */
+std::string storage::BlockStore::BlockFilePath(uint32_t file) const {
+      char name[32];
+      snprintf(name, sizeof(name), "blk%05u.dat", file);
+      return (std::filesystem::path(directory) / name).string();
+}
+
+/**
+ * @brief Returns the path of an undo file
+ *
+ * @param file The number of the file, the same as the block file of its blocks
+ * @return std::string <directory>/revNNNNN.dat
+ */
+std::string storage::BlockStore::UndoFilePath(uint32_t file) const {
+      char name[32];
+      snprintf(name, sizeof(name), "rev%05u.dat", file);
+      return (std::filesystem::path(directory) / name).string();
+}
+
+/**
+ * @brief Creates the store directory if needed and loads the index log
+ *
+ * @throws StorageException If the directory or the files can't be opened
+ */
+void storage::BlockStore::Open() {
+      std::error_code error;
+      std::filesystem::create_directories(directory, error);
+      if (error) {
+            throw StorageException("Could not create the block store directory " + directory + ": " + error.message());
+      }
+
+      const auto index_path = std::filesystem::path(directory) / INDEX_FILE_NAME;
+      const uint64_t index_size = file_size_or_zero(index_path);
+
+      /** Load the index, later records of a block override earlier ones */
+      std::vector<byte> records(index_size);
+      if (index_size > 0) {
+            std::ifstream in(index_path, std::ios::binary);
+            if (!in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(index_size))) {
+                  throw StorageException("Could not read the block index " + index_path.string());
+            }
+      }
+
+      serialize::ReadBuffer reader(records);
+      indexRecords = 0;
+      while (reader.Remaining() >= BlockIndexEntry::SERIALIZED_SIZE) {
+            BlockIndexEntry entry;
+            serialize::Unserialize(reader, entry);
+            index[entry.hash] = entry;
+            currentFile = std::max(currentFile, entry.location.file);
+            indexRecords++;
+      }
+
+      /** Drop a record that was only partially written */
+      if (!reader.Empty()) {
+            std::filesystem::resize_file(index_path, reader.Position(), error);
+            if (error) {
+                  throw StorageException("Could not repair the block index " + index_path.string() + ": " + error.message());
+            }
+      }
+
+      tip = nullptr;
+      files.assign(currentFile + 1, BlockFileInfo{});
+      for (const auto& [hash, entry] : index) {
+            UpdateTip(entry);
+            if (entry.status & BLOCK_HAVE_DATA) {
+                  BlockFileInfo& info = files[entry.location.file];
+                  info.blocks++;
+                  info.maxHeight = std::max(info.maxHeight, entry.height);
+            }
+      }
+
+      diskUsage = 0;
+      for (uint32_t file = 0; file <= currentFile; file++) {
+            files[file].size = file_size_or_zero(BlockFilePath(file)) + file_size_or_zero(UndoFilePath(file));
+            diskUsage += files[file].size;
+      }
+
+      if (indexRecords > index.size()) {
+            CompactIndex();
+      } else {
+            indexFile.open(index_path, std::ios::binary | std::ios::app);
+            if (!indexFile) {
+                  throw StorageException("Could not open the block index " + index_path.string());
+            }
+      }
+
+      OpenBlockFile(currentFile);
+}
+
+/**
+ * @brief Opens a block file for appending
+ *
+ * @param file The number of the file
+ */
+void storage::BlockStore::OpenBlockFile(uint32_t file) {
+      if (blockFile.is_open()) blockFile.close();
+
+      const std::string path = BlockFilePath(file);
+      blockFile.open(path, std::ios::binary | std::ios::app);
+      if (!blockFile) {
+            throw StorageException("Could not open block file " + path);
+      }
+
+      currentFile = file;
+      currentFileSize = file_size_or_zero(path);
+      if (files.size() <= file) files.resize(file + 1);
+}
+
+/**
+ * @brief Appends a record to the index log
+ *
+ * @details The log is compacted first once superseded records outnumber the live ones,
+ *          so the rewrites cost a constant amount per record appended. The entry isn't
+ *          in the index yet (or is about to be replaced), so it is never written twice.
+ */
+void storage::BlockStore::AppendIndexRecord(const BlockIndexEntry& entry) {
+      if (indexRecords - index.size() > index.size()) {
+            CompactIndex();
+      }
+
+      buffer.Clear();
+      serialize::Serialize(buffer, entry);
+
+      indexFile.write(reinterpret_cast<const char*>(buffer.Data()), static_cast<std::streamsize>(buffer.Size()));
+      if (!indexFile) {
+            throw StorageException("Could not write to the block index");
+      }
+      indexRecords++;
+}
+
+/**
+ * @brief Rewrites the index log with one record per indexed block
+ *
+ * @details The records are written to a temporary file that then replaces the log, so a
+ *          crash leaves either the old log or the compacted one.
+ *
+ * @throws StorageException If the log can't be rewritten
+ */
+void storage::BlockStore::CompactIndex() {
+      const std::string path = (std::filesystem::path(directory) / INDEX_FILE_NAME).string();
+      const std::string compacted = path + ".tmp";
+
+      if (indexFile.is_open()) indexFile.close();
+      {
+            std::ofstream file(compacted, std::ios::binary | std::ios::trunc);
+            for (const auto& [hash, entry] : index) {
+                  buffer.Clear();
+                  serialize::Serialize(buffer, entry);
+                  file.write(reinterpret_cast<const char*>(buffer.Data()), static_cast<std::streamsize>(buffer.Size()));
+            }
+
+            file.flush();
+            if (!file) {
+                  throw StorageException("Could not compact the block index " + path);
+            }
+      }
+
+      std::error_code error;
+      std::filesystem::rename(compacted, path, error);
+      if (error) {
+            throw StorageException("Could not replace the block index " + path + ": " + error.message());
+      }
+      indexRecords = index.size();
+
+      indexFile.open(path, std::ios::binary | std::ios::app);
+      if (!indexFile) {
+            throw StorageException("Could not open the block index " + path);
+      }
+}
+
+/**
+ * @brief Makes entry the tip if it is the highest main chain block seen so far
+ *        (the latest one wins at equal heights)
+ */
+void storage::BlockStore::UpdateTip(const BlockIndexEntry& entry) {
+      if (!(entry.status & BLOCK_MAIN_CHAIN)) return;
+      if (tip == nullptr || entry.height >= tip->height) {
+            tip = &entry;
+      }
+}
+
+/**
+ * @brief Appends a block to the current block file and indexes it
+ *
+ * @details The block is written and flushed before its index record, so a crash can
+ *          leave unindexed bytes in a block file but never an index record pointing
+ *          to missing data.
+ *
+ * @param block The block
+ * @param height The height of the block
+ * @param status The BlockStatus flags of the block
+ * @return const BlockIndexEntry& The index entry of the block
+ */
+const storage::BlockIndexEntry& storage::BlockStore::WriteBlock(const skynet::Block& block, uint32_t height, uint8_t status) {
+      buffer.Clear();
+      serialize::Serialize(buffer, block);
+      const auto size = static_cast<uint32_t>(buffer.Size());
+
+      if (currentFileSize > 0 && currentFileSize + BLOCK_RECORD_HEADER_SIZE + size > maxFileSize) {
+            OpenBlockFile(currentFile + 1);
+      }
+
+      byte prefix[BLOCK_RECORD_HEADER_SIZE];
+      serialize::WriteLE32(prefix, BLOCK_FILE_MAGIC);
+      serialize::WriteLE32(prefix + 4, size);
+
+      blockFile.write(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+      blockFile.write(reinterpret_cast<const char*>(buffer.Data()), size);
+      blockFile.flush();
+      if (!blockFile) {
+            throw StorageException("Could not write to block file " + BlockFilePath(currentFile));
+      }
+
+      BlockIndexEntry entry;
+      entry.hash = block.Hash();
+      entry.header = block.GetHeader();
+      entry.height = height;
+      entry.location = { currentFile, currentFileSize + BLOCK_RECORD_HEADER_SIZE, size };
+      entry.status = status;
+      currentFileSize += BLOCK_RECORD_HEADER_SIZE + size;
+      diskUsage += BLOCK_RECORD_HEADER_SIZE + size;
+
+      BlockFileInfo& info = files[currentFile];
+      info.blocks++;
+      info.maxHeight = std::max(info.maxHeight, height);
+      info.size += BLOCK_RECORD_HEADER_SIZE + size;
+
+      AppendIndexRecord(entry);
+
+      BlockIndexEntry &stored = index[entry.hash];
+      stored = entry;
+      UpdateTip(stored);
+      return stored;
+}
+
+/**
+ * @brief Indexes a block known only by its header
+ *
+ * @param header The header of the block
+ * @param height The height of the block
+ * @param status The BlockStatus flags of the block, without BLOCK_HAVE_DATA
+ * @return const BlockIndexEntry& The index entry of the block
+ */
+const storage::BlockIndexEntry& storage::BlockStore::WriteHeader(const skynet::BlockHeader& header, uint32_t height, uint8_t status) {
+      BlockIndexEntry entry;
+      entry.hash = header.Hash();
+      entry.header = header;
+      entry.height = height;
+      entry.status = status & ~BLOCK_HAVE_DATA;
+
+      AppendIndexRecord(entry);
+
+      BlockIndexEntry &stored = index[entry.hash];
+      stored = entry;
+      UpdateTip(stored);
+      return stored;
+}
+
+/**
+ * @brief Updates the status of an indexed block
+ *
+ * @param hash The hash of the block
+ * @param status The new BlockStatus flags
+ * @throws StorageException If the block is not indexed
+ */
+void storage::BlockStore::SetStatus(const Hash256& hash, uint8_t status) {
+      SetStatus({ { hash, status } });
+}
+
+/**
+ * @brief Updates the status of several blocks
+ *
+ * @details The whole index is only scanned (once) if the tip leaves the main chain.
+ *
+ * @param updates The hashes of the blocks and their new BlockStatus flags
+ * @throws StorageException If a block is not indexed
+ */
+void storage::BlockStore::SetStatus(const std::vector<std::pair<Hash256, uint8_t>>& updates) {
+      bool tip_left = false;
+
+      for (const auto& [hash, status] : updates) {
+            auto it = index.find(hash);
+            if (it == index.end()) {
+                  throw StorageException("Block is not in the store");
+            }
+
+            it->second.status = status;
+            AppendIndexRecord(it->second);
+
+            if (tip == &it->second && !(status & BLOCK_MAIN_CHAIN)) {
+                  tip_left = true;
+            } else if (!tip_left) {
+                  UpdateTip(it->second);
+            }
+      }
+
+      /** The tip left the main chain, find the new one */
+      if (tip_left) {
+            tip = nullptr;
+            for (const auto& [key, entry] : index) {
+                  UpdateTip(entry);
+            }
+      }
+}
+
+/**
+ * @brief Appends the undo data of a block to the undo file matching its block file
+ *
+ * @details Like blocks, the data is flushed before the index record pointing to it.
+ *
+ * @param hash The hash of the block
+ * @param undo The coins the block spent
+ * @throws StorageException If the block is not indexed or the data can't be written
+ */
+void storage::BlockStore::WriteUndo(const Hash256& hash, const skynet::BlockUndo& undo) {
+      auto it = index.find(hash);
+      if (it == index.end()) {
+            throw StorageException("Block is not in the store");
+      }
+
+      const uint32_t file = it->second.location.file;
+      if (!undoFile.is_open() || currentUndoFile != file) {
+            if (undoFile.is_open()) undoFile.close();
+            undoFile.open(UndoFilePath(file), std::ios::binary | std::ios::app);
+            if (!undoFile) {
+                  throw StorageException("Could not open undo file " + UndoFilePath(file));
+            }
+            currentUndoFile = file;
+      }
+      const uint64_t offset = file_size_or_zero(UndoFilePath(file));
+
+      buffer.Clear();
+      serialize::Serialize(buffer, undo);
+      const auto size = static_cast<uint32_t>(buffer.Size());
+
+      byte prefix[BLOCK_RECORD_HEADER_SIZE];
+      serialize::WriteLE32(prefix, BLOCK_FILE_MAGIC);
+      serialize::WriteLE32(prefix + 4, size);
+
+      undoFile.write(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+      undoFile.write(reinterpret_cast<const char*>(buffer.Data()), size);
+      undoFile.flush();
+      if (!undoFile) {
+            throw StorageException("Could not write to undo file " + UndoFilePath(file));
+      }
+
+      diskUsage += BLOCK_RECORD_HEADER_SIZE + size;
+      files[file].size += BLOCK_RECORD_HEADER_SIZE + size;
+
+      it->second.undo = { file, offset + BLOCK_RECORD_HEADER_SIZE, size };
+      it->second.status |= BLOCK_HAVE_UNDO;
+      AppendIndexRecord(it->second);
+}
+
+/**
+ * @brief Deletes a block file and its undo file
+ *
+ * @details The index records dropping the data flags of their blocks are flushed first, so
+ *          a crash never leaves the index pointing into a deleted file.
+ *
+ * @param file The number of the file
+ * @return uint64_t The number of bytes freed
+ */
+uint64_t storage::BlockStore::PruneFile(uint32_t file) {
+      if (file >= currentFile) {
+            throw StorageException("The block file being appended to can't be pruned");
+      }
+
+      for (auto& [hash, entry] : index) {
+            if (!(entry.status & BLOCK_HAVE_DATA) || entry.location.file != file) continue;
+
+            entry.status &= ~(BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO);
+            AppendIndexRecord(entry);
+      }
+      indexFile.flush();
+      if (!indexFile) {
+            throw StorageException("Could not write to the block index");
+      }
+
+      if (undoFile.is_open() && currentUndoFile == file) undoFile.close();
+      reader.Clear();
+
+      const uint64_t freed = files[file].size;
+      std::error_code error;
+      std::filesystem::remove(BlockFilePath(file), error);
+      if (!error) std::filesystem::remove(UndoFilePath(file), error);
+      if (error) {
+            throw StorageException("Could not delete block file " + BlockFilePath(file) + ": " + error.message());
+      }
+
+      files[file] = BlockFileInfo{};
+      diskUsage -= std::min(diskUsage, freed);
+      return freed;
+}
+
+/**
+ * @brief Reads the undo data of a block
+ *
+ * @details Undo data is only read to disconnect blocks, it is read with a plain file read
+ *          instead of going through the mappings.
+ *
+ * @param entry The index entry of the block
+ * @throws StorageException If the block has no undo data or it can't be read
+ */
+skynet::BlockUndo storage::BlockStore::ReadUndo(const BlockIndexEntry& entry) const {
+      if (!(entry.status & BLOCK_HAVE_UNDO)) {
+            throw StorageException("Block has no undo data");
+      }
+
+      const std::string path = UndoFilePath(entry.undo.file);
+      std::vector<byte> record(BLOCK_RECORD_HEADER_SIZE + entry.undo.size);
+      std::ifstream in(path, std::ios::binary);
+      in.seekg(static_cast<std::streamoff>(entry.undo.offset - BLOCK_RECORD_HEADER_SIZE));
+      if (!in.read(reinterpret_cast<char*>(record.data()), static_cast<std::streamsize>(record.size()))) {
+            throw StorageException("Could not read undo data from " + path);
+      }
+      if (serialize::ReadLE32(record.data()) != BLOCK_FILE_MAGIC || serialize::ReadLE32(record.data() + 4) != entry.undo.size) {
+            throw StorageException("Corrupted undo record in " + path);
+      }
+
+      skynet::BlockUndo undo;
+      serialize::ReadBuffer reader(record.data() + BLOCK_RECORD_HEADER_SIZE, entry.undo.size);
+      serialize::Unserialize(reader, undo);
+      return undo;
+}
+
+/**
+ * @brief Returns a view over a stored block, straight out of the mapping of its file
+ *
+ * @param entry The index entry of the block
+ * @param pattern How the caller is walking the blocks
+ * @return MappedBlock The view, it keeps the mapping alive
+ */
+storage::MappedBlock storage::BlockStore::ReadBlockView(const BlockIndexEntry& entry, AccessPattern pattern) const {
+      return reader.Read(entry.location, pattern);
+}
+
+std::vector<byte> storage::BlockStore::ReadBlockBytes(const BlockIndexEntry& entry) const {
+      const MappedBlock block = ReadBlockView(entry);
+      return std::vector<byte>(block.view.Data(), block.view.Data() + block.view.Size());
+}
+
+skynet::Block storage::BlockStore::ReadBlock(const BlockIndexEntry& entry) const {
+      return ReadBlockView(entry).view.ToBlock();
+}
+
+const storage::BlockIndexEntry* storage::BlockStore::Lookup(const Hash256& hash) const {
+      auto it = index.find(hash);
+      return it == index.end() ? nullptr : &it->second;
+}
+
+const storage::BlockIndexEntry* storage::BlockStore::GetTip() const {
+      return tip;
+}
+
+void storage::BlockStore::Flush() {
+      blockFile.flush();
+      if (undoFile.is_open()) undoFile.flush();
+      indexFile.flush();
+      if (!blockFile || !indexFile || (undoFile.is_open() && !undoFile)) {
+            throw StorageException("Could not flush the block store");
+      }
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
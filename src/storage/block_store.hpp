@@ -0,0 +1,328 @@
+/**
+ * @file    block_store.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   Append only block storage.
+ *
+ *          Serialized blocks are appended to flat files (blk00000.dat, blk00001.dat, ...)
+ *          that rotate once they reach a maximum size. Each block is stored as
+ *
+ *            magic (4 bytes) | size (4 bytes) | serialized block (size bytes)
+ *
+ *          A compact index (hash -> header, file, offset, size, height, status) is kept in
+ *          memory and persisted as an append only log of fixed size records (index.dat).
+ *          Only the index is read when the store is opened, blocks are read in place from
+ *          memory mapped block files on demand. Every status change appends a record, so
+ *          the log is rewritten with only the latest record of each block once most of
+ *          it is superseded records, and when the store is opened.
+ *
+ *          The undo data of connected blocks (the coins they spent) is stored the same way
+ *          in undo files (rev00000.dat, ...) numbered after the block file of their block.
+ *
+ * @date    2023-11-14
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ */
+
+#ifndef SKYNET_BLOCK_STORE_HPP
+#define SKYNET_BLOCK_STORE_HPP
+
+/** C++ Includes */
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/** Skynet Includes */
+#include <types.hpp>
+#include <block.hpp>
+#include <coins.hpp>
+#include <serialize.hpp>
+#include <storage/block_file_reader.hpp>
+
+namespace storage
+{
+      /** Marks the start of every block record in a block file */
+      constexpr uint32_t BLOCK_FILE_MAGIC = 0x4e594b53;                 /** "SKYN" */
+      /** Size of the magic and size prefix of every block record */
+      constexpr uint32_t BLOCK_RECORD_HEADER_SIZE = 8;
+      /** Block files are rotated once they would grow past this size */
+      constexpr uint64_t MAX_BLOCK_FILE_SIZE = 128 * 1024 * 1024;
+
+      /** Block status flags */
+      enum BlockStatus : uint8_t {
+            BLOCK_HAVE_DATA = 1 << 0,           /** The block is stored in a block file */
+            BLOCK_MAIN_CHAIN = 1 << 1,          /** The block is part of the main chain */
+            BLOCK_HAVE_UNDO = 1 << 2,           /** The undo data of the block is stored in an undo file */
+      };
+
+      /**
+       * @brief Where a serialized block lives
+       */
+      struct BlockFileLocation {
+            uint32_t file = 0;                  /** Number of the block file (blkNNNNN.dat) */
+            uint64_t offset = 0;                /** Offset of the serialized block in the file */
+            uint32_t size = 0;                  /** Size of the serialized block */
+      };
+
+      /**
+       * @brief A record of the block index
+       */
+      struct BlockIndexEntry {
+            Hash256 hash{};                     /** Hash of the block */
+            skynet::BlockHeader header{};       /** Header of the block, so the chain can be indexed without reading blocks */
+            uint32_t height = 0;                /** Height of the block */
+            BlockFileLocation location;         /** Where the block is stored */
+            BlockFileLocation undo;             /** Where its undo data is stored, if BLOCK_HAVE_UNDO is set */
+            uint8_t status = 0;                 /** BlockStatus flags */
+
+            /** Size of a serialized index record */
+            static constexpr std::size_t SERIALIZED_SIZE = 149;
+      };
+
+      /**
+       * @brief What a block file holds, to pick the files to prune
+       */
+      struct BlockFileInfo {
+            uint32_t blocks = 0;                /** Number of blocks stored in it, 0 once pruned */
+            uint32_t maxHeight = 0;             /** Height of the highest of them */
+            uint64_t size = 0;                  /** Bytes taken by the file and its undo file */
+      };
+
+      class StorageException : public std::runtime_error
+      {
+      public:
+            explicit StorageException(const std::string& message) : std::runtime_error(message) {}
+      };
+
+      class BlockStore
+      {
+      public:
+            using Index = std::unordered_map<Hash256, BlockIndexEntry, Hash256Hasher>;
+
+            /**
+             * @param directory The directory holding the block files and the index
+             * @param maxFileSize The size at which block files are rotated
+             */
+            explicit BlockStore(std::string directory, uint64_t maxFileSize = MAX_BLOCK_FILE_SIZE);
+            ~BlockStore();
+
+            BlockStore(const BlockStore&) = delete;
+            BlockStore& operator=(const BlockStore&) = delete;
+
+            /**
+             * @brief Creates the directory if needed and loads the index
+             * @details A partially written index record at the end of the log (from a crash
+             *          mid write) is discarded, superseded records are compacted away.
+             *
+             * @throws StorageException If the directory or the files can't be opened
+             */
+            void Open();
+
+            /**
+             * @brief Appends a block to the current block file and indexes it
+             *
+             * @param block The block
+             * @param height The height of the block
+             * @param status The BlockStatus flags of the block, part of the main chain by default
+             * @return const BlockIndexEntry& The index entry of the block
+             * @throws StorageException If the block can't be written
+             */
+            const BlockIndexEntry& WriteBlock(const skynet::Block& block, uint32_t height, uint8_t status = BLOCK_HAVE_DATA | BLOCK_MAIN_CHAIN);
+
+            /**
+             * @brief Indexes a block from its header alone, without storing any data
+             * @details For blocks known only by their header, like the history below a UTXO
+             *          snapshot. Their BLOCK_HAVE_DATA flag is never set.
+             *
+             * @param header The header of the block
+             * @param height The height of the block
+             * @param status The BlockStatus flags of the block, part of the main chain by default
+             * @return const BlockIndexEntry& The index entry of the block
+             * @throws StorageException If the index record can't be written
+             */
+            const BlockIndexEntry& WriteHeader(const skynet::BlockHeader& header, uint32_t height, uint8_t status = BLOCK_MAIN_CHAIN);
+
+            /**
+             * @brief Updates the status of an indexed block
+             * @throws StorageException If the block is not indexed
+             */
+            void SetStatus(const Hash256& hash, uint8_t status);
+
+            /**
+             * @brief Updates the status of several blocks (a reorganization), finding the tip once
+             *
+             * @param updates The hashes of the blocks and their new BlockStatus flags, applied in order
+             * @throws StorageException If a block is not indexed
+             */
+            void SetStatus(const std::vector<std::pair<Hash256, uint8_t>>& updates);
+
+            /**
+             * @brief Stores the undo data of a block, in the undo file matching its block file
+             *
+             * @param hash The hash of the block
+             * @param undo The coins the block spent
+             * @throws StorageException If the block is not indexed or the data can't be written
+             */
+            void WriteUndo(const Hash256& hash, const skynet::BlockUndo& undo);
+
+            /**
+             * @brief Reads the undo data of a block
+             *
+             * @param entry The index entry of the block
+             * @throws StorageException If the block has no undo data or it can't be read
+             * @throws serialize::SerializationError If the stored data is corrupted
+             */
+            skynet::BlockUndo ReadUndo(const BlockIndexEntry& entry) const;
+
+            /**
+             * @brief Returns a view over a stored block, without copying it
+             *
+             * @param entry The index entry of the block
+             * @param pattern How the caller is walking the blocks, SEQUENTIAL when syncing a
+             *                peer or reindexing, RANDOM for single lookups
+             * @throws StorageException If the block can't be read
+             * @throws serialize::SerializationError If the stored block is corrupted
+             */
+            MappedBlock ReadBlockView(const BlockIndexEntry& entry, AccessPattern pattern = AccessPattern::RANDOM) const;
+
+            /**
+             * @brief Reads the serialized bytes of a block
+             * @throws StorageException If the block can't be read
+             */
+            std::vector<byte> ReadBlockBytes(const BlockIndexEntry& entry) const;
+
+            /**
+             * @brief Reads and deserializes a block
+             * @throws StorageException If the block can't be read
+             * @throws serialize::SerializationError If the stored block is corrupted
+             */
+            skynet::Block ReadBlock(const BlockIndexEntry& entry) const;
+
+            /** Returns the index entry of the block with the given hash, or nullptr if it is not stored */
+            const BlockIndexEntry* Lookup(const Hash256& hash) const;
+
+            /** Returns the index entry of the highest main chain block, or nullptr if the store is empty */
+            const BlockIndexEntry* GetTip() const;
+
+            /** Returns the index entries of every stored block */
+            const Index& GetIndex() const { return index; }
+
+            /**
+             * @brief Deletes a block file and its undo file
+             * @details Their blocks stay indexed, without the BLOCK_HAVE_DATA and BLOCK_HAVE_UNDO
+             *          flags. The index records are written before the files are deleted.
+             *
+             * @param file The number of the file, older than the one being appended to
+             * @return uint64_t The number of bytes freed
+             * @throws StorageException If the file is the one being appended to or can't be deleted
+             */
+            uint64_t PruneFile(uint32_t file);
+
+            /** Returns the combined size of the block and undo files */
+            uint64_t GetDiskUsage() const { return diskUsage; }
+
+            /** Returns what every block file holds, by file number (the last one being appended to) */
+            const std::vector<BlockFileInfo>& GetFileInfo() const { return files; }
+
+            /** Writes buffered data to the files */
+            void Flush();
+
+            /** Returns the number of indexed blocks */
+            std::size_t Size() const { return index.size(); }
+            const std::string& GetDirectory() const { return directory; }
+
+            /** Returns the path of a block file */
+            std::string BlockFilePath(uint32_t file) const;
+            /** Returns the path of an undo file */
+            std::string UndoFilePath(uint32_t file) const;
+
+      private:
+            std::string directory;
+            uint64_t maxFileSize;
+
+            Index index;
+            const BlockIndexEntry *tip = nullptr;
+
+            std::ofstream blockFile;                  /** Block file being appended to */
+            uint32_t currentFile = 0;                 /** Number of that file */
+            uint64_t currentFileSize = 0;             /** Its size */
+            std::ofstream undoFile;                   /** Undo file being appended to */
+            uint32_t currentUndoFile = 0;             /** Number of that file */
+            std::ofstream indexFile;                  /** Index log */
+            uint64_t indexRecords = 0;                /** Number of records in the index log */
+            serialize::WriteBuffer buffer;            /** Reused for every serialization */
+            mutable BlockFileReader reader;           /** Mappings of the block files */
+            std::vector<BlockFileInfo> files;         /** What every block file holds */
+            uint64_t diskUsage = 0;                   /** Combined size of the block and undo files */
+
+            void OpenBlockFile(uint32_t file);
+            void AppendIndexRecord(const BlockIndexEntry& entry);
+            void CompactIndex();
+            void UpdateTip(const BlockIndexEntry& entry);
+      };
+
+} // namespace storage
+
+/**
+ * @brief Index record serialization:
+ *        hash (32) | header (80) | height (u32) | file (u32) | offset (u64) | size (u32) |
+ *        undo file (u32) | undo offset (u64) | undo size (u32) | status (u8)
+ */
+template<>
+struct serialize::Serializer<storage::BlockIndexEntry> {
+      template<typename Stream>
+      static void Write(Stream& stream, const storage::BlockIndexEntry& entry) {
+            Serialize(stream, entry.hash);
+            Serialize(stream, entry.header);
+            Serialize(stream, entry.height);
+            Serialize(stream, entry.location.file);
+            Serialize(stream, entry.location.offset);
+            Serialize(stream, entry.location.size);
+            Serialize(stream, entry.undo.file);
+            Serialize(stream, entry.undo.offset);
+            Serialize(stream, entry.undo.size);
+            Serialize(stream, entry.status);
+      }
+
+      static void Read(ReadBuffer& reader, storage::BlockIndexEntry& entry) {
+            Unserialize(reader, entry.hash);
+            Unserialize(reader, entry.header);
+            Unserialize(reader, entry.height);
+            Unserialize(reader, entry.location.file);
+            Unserialize(reader, entry.location.offset);
+            Unserialize(reader, entry.location.size);
+            Unserialize(reader, entry.undo.file);
+            Unserialize(reader, entry.undo.offset);
+            Unserialize(reader, entry.undo.size);
+            Unserialize(reader, entry.status);
+      }
+};
+
+#endif // SKYNET_BLOCK_STORE_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,427 @@
+//
+// Created by JoaoAJMatos on 19/11/2023.
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/** Skynet Includes */
+#include <storage/block_store.hpp>
+#include <storage/block_file_reader.hpp>
+
+/** Local Includes */
+#include "coins_db.hpp"
+
+
+/** Name of the log inside the database directory */
+static const char *COINS_LOG_FILE_NAME = "coins.dat";
+
+/** Record types */
+enum CoinsRecordType : uint8_t {
+      COINS_RECORD_PUT = 1,
+      COINS_RECORD_ERASE = 2,
+      COINS_RECORD_COMMIT = 3,
+};
+
+/**
+ * @brief Returns the size of the PUT record of a coin of the given serialized size
+ */
+static uint64_t put_record_size(uint32_t size) {
+      serialize::SizeComputer computer;
+      serialize::WriteCompactSize(computer, size);
+      return 1 + skynet::OutPoint::SERIALIZED_SIZE + computer.Size() + size;
+}
+
+/**
+ * @brief Returns the size of a file, 0 if it doesn't exist
+ */
+static uint64_t file_size_or_zero(const std::filesystem::path& path) {
+      std::error_code error;
+      const auto size = std::filesystem::file_size(path, error);
+      return error ? 0 : static_cast<uint64_t>(size);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+storage::CoinsDatabase::CoinsDatabase(std::string directory, uint64_t minCompactionSize)
+      : directory(std::move(directory)), minCompactionSize(minCompactionSize) {}
+
+storage::CoinsDatabase::~CoinsDatabase() {
+      if (out.is_open()) out.flush();
+}
+
+std::string storage::CoinsDatabase::LogPath() const {
+      return (std::filesystem::path(directory) / COINS_LOG_FILE_NAME).string();
+}
+
+void storage::CoinsDatabase::OpenStreams() {
+      if (out.is_open()) out.close();
+      if (in.is_open()) in.close();
+
+      out.open(LogPath(), std::ios::binary | std::ios::app);
+      in.open(LogPath(), std::ios::binary);
+      if (!out || !in) {
+            throw StorageException("Could not open the coins database " + LogPath());
+      }
+}
+
+/**
+ * @brief Creates the directory if needed and replays the log
+ *
+ * @details The records of a batch are staged until its COMMIT record, anything after the
+ *          last COMMIT (a batch cut short by a crash) is discarded and cut off the log.
+ *
+ * @throws StorageException If the directory or the log can't be opened
+ */
+void storage::CoinsDatabase::Open() {
+      std::error_code error;
+      std::filesystem::create_directories(directory, error);
+      if (error) {
+            throw StorageException("Could not create the coins database directory " + directory + ": " + error.message());
+      }
+
+      index.clear();
+      bestBlock = Hash256{};
+      liveSize = 0;
+
+      const std::string path = LogPath();
+      uint64_t committed = 0;
+
+      if (file_size_or_zero(path) > 0) {
+            const MappedFile log(path);
+            log.Advise(0, log.Size(), AccessPattern::SEQUENTIAL);
+
+            serialize::ReadBuffer reader(log.Data(), static_cast<std::size_t>(log.Size()));
+            std::vector<std::pair<skynet::OutPoint, std::optional<Location>>> batch;
+
+            try {
+                  while (!reader.Empty()) {
+                        uint8_t type;
+                        serialize::Unserialize(reader, type);
+
+                        if (type == COINS_RECORD_PUT || type == COINS_RECORD_ERASE) {
+                              skynet::OutPoint outpoint;
+                              serialize::Unserialize(reader, outpoint);
+                              if (type == COINS_RECORD_ERASE) {
+                                    batch.emplace_back(outpoint, std::nullopt);
+                                    continue;
+                              }
+
+                              const auto size = static_cast<uint32_t>(serialize::ReadCompactSize(reader));
+                              const uint64_t offset = reader.Position();
+                              reader.View(size);
+                              batch.emplace_back(outpoint, Location{ offset, size });
+                        } else if (type == COINS_RECORD_COMMIT) {
+                              serialize::Unserialize(reader, bestBlock);
+                              for (const auto& [outpoint, location] : batch) {
+                                    auto it = index.find(outpoint);
+                                    if (it != index.end()) {
+                                          liveSize -= put_record_size(it->second.size);
+                                          index.erase(it);
+                                    }
+                                    if (location) {
+                                          index.emplace(outpoint, *location);
+                                          liveSize += put_record_size(location->size);
+                                    }
+                              }
+                              batch.clear();
+                              committed = reader.Position();
+                        } else {
+                              break;
+                        }
+                  }
+            } catch (const serialize::SerializationError&) {
+                  /** A torn record, dropped below with the rest of its batch */
+            }
+
+            if (committed < log.Size()) {
+                  std::filesystem::resize_file(path, committed, error);
+                  if (error) {
+                        throw StorageException("Could not repair the coins database " + path + ": " + error.message());
+                  }
+            }
+      }
+
+      logSize = committed;
+      OpenStreams();
+}
+
+/**
+ * @brief Reads a coin from the log
+ *
+ * @throws StorageException If the coin can't be read
+ * @throws serialize::SerializationError If the stored coin is corrupted
+ */
+bool storage::CoinsDatabase::GetCoin(const skynet::OutPoint& outpoint, skynet::Coin& coin) const {
+      auto it = index.find(outpoint);
+      if (it == index.end()) return false;
+
+      ReadCoin(it->second, coin);
+      return true;
+}
+
+/**
+ * @brief Reads the coin stored at a location of the log
+ *
+ * @throws StorageException If the coin can't be read
+ * @throws serialize::SerializationError If the stored coin is corrupted
+ */
+void storage::CoinsDatabase::ReadCoin(const Location& location, skynet::Coin& coin) const {
+      std::vector<byte> bytes(location.size);
+      in.clear();
+      in.seekg(static_cast<std::streamoff>(location.offset));
+      if (!in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()))) {
+            throw StorageException("Could not read a coin from " + LogPath());
+      }
+
+      serialize::ReadBuffer reader(bytes);
+      serialize::Unserialize(reader, coin);
+}
+
+bool storage::CoinsDatabase::HaveCoin(const skynet::OutPoint& outpoint) const {
+      return index.count(outpoint) > 0;
+}
+
+/**
+ * @brief Cursor of a CoinsDatabase: walks the ordered key index, reading each coin from the
+ *        log only when asked for it
+ */
+class storage::CoinsDatabase::IndexCursor : public skynet::CoinsCursor
+{
+public:
+      explicit IndexCursor(const CoinsDatabase& database) : database(database), it(database.index.begin()) {}
+
+      bool Valid() const override { return it != database.index.end(); }
+      const skynet::OutPoint& GetKey() const override { return it->first; }
+      void GetValue(skynet::Coin& coin) const override { database.ReadCoin(it->second, coin); }
+      void Next() override { ++it; }
+
+private:
+      const CoinsDatabase& database;
+      std::map<skynet::OutPoint, Location>::const_iterator it;
+};
+
+std::unique_ptr<skynet::CoinsCursor> storage::CoinsDatabase::Cursor() const {
+      return std::make_unique<IndexCursor>(*this);
+}
+
+/**
+ * @brief Appends the dirty entries of a cache as a single batch
+ *
+ * @details The batch is built in memory and written with one call, its COMMIT record last,
+ *          so a crash part way through loses the batch as a whole. Spent coins the database
+ *          never had are skipped.
+ *
+ * @param coins The entries of the cache
+ * @param bestBlock The block the entries bring the database up to
+ * @throws StorageException If the batch can't be written
+ */
+void storage::CoinsDatabase::BatchWrite(skynet::CoinsMap& coins, const Hash256& bestBlock) {
+      buffer.Clear();
+      std::vector<std::pair<skynet::OutPoint, std::optional<Location>>> batch;
+      serialize::WriteBuffer value;
+
+      for (const auto& [outpoint, entry] : coins) {
+            if (!(entry.flags & skynet::CoinsCacheEntry::DIRTY)) continue;
+
+            if (entry.coin.spent) {
+                  if (!HaveCoin(outpoint)) continue;
+                  serialize::Serialize(buffer, uint8_t(COINS_RECORD_ERASE));
+                  serialize::Serialize(buffer, outpoint);
+                  batch.emplace_back(outpoint, std::nullopt);
+                  continue;
+            }
+
+            value.Clear();
+            serialize::Serialize(value, entry.coin);
+            const auto size = static_cast<uint32_t>(value.Size());
+
+            serialize::Serialize(buffer, uint8_t(COINS_RECORD_PUT));
+            serialize::Serialize(buffer, outpoint);
+            serialize::WriteCompactSize(buffer, size);
+            batch.emplace_back(outpoint, Location{ logSize + buffer.Size(), size });
+            buffer.Write(value.Data(), size);
+      }
+
+      serialize::Serialize(buffer, uint8_t(COINS_RECORD_COMMIT));
+      serialize::Serialize(buffer, bestBlock);
+
+      out.write(reinterpret_cast<const char*>(buffer.Data()), static_cast<std::streamsize>(buffer.Size()));
+      out.flush();
+      if (!out) {
+            throw StorageException("Could not write to the coins database " + LogPath());
+      }
+      logSize += buffer.Size();
+
+      for (const auto& [outpoint, location] : batch) {
+            auto it = index.find(outpoint);
+            if (it != index.end()) {
+                  liveSize -= put_record_size(it->second.size);
+                  index.erase(it);
+            }
+            if (location) {
+                  index.emplace(outpoint, *location);
+                  liveSize += put_record_size(location->size);
+            }
+      }
+      this->bestBlock = bestBlock;
+
+      if (logSize > minCompactionSize && logSize > 2 * liveSize) {
+            Compact();
+      }
+}
+
+/**
+ * @brief Appends the coins of a snapshot as a single batch
+ *
+ * @details Chunks are appended as they are read, so the snapshot is never in memory as a
+ *          whole. The COMMIT record is only written after the last chunk, once the reader
+ *          checked the snapshot against its commitment; before that, a crash or a corrupted
+ *          chunk leaves an uncommitted batch, which is cut off the log.
+ *
+ * @param snapshot The snapshot
+ * @throws StorageException If the database isn't empty, the snapshot is corrupted or the
+ *                          coins can't be written
+ */
+void storage::CoinsDatabase::Import(UtxoSnapshotReader& snapshot) {
+      if (!index.empty() || bestBlock != Hash256{}) {
+            throw StorageException("Snapshots can only be imported into an empty coins database");
+      }
+
+      const uint64_t start = logSize;
+      std::vector<std::pair<skynet::OutPoint, Location>> imported;
+      std::vector<std::pair<skynet::OutPoint, skynet::Coin>> coins;
+      serialize::WriteBuffer value;
+
+      try {
+            while (snapshot.ReadChunk(coins)) {
+                  buffer.Clear();
+                  for (const auto& [outpoint, coin] : coins) {
+                        value.Clear();
+                        serialize::Serialize(value, coin);
+                        const auto size = static_cast<uint32_t>(value.Size());
+
+                        serialize::Serialize(buffer, uint8_t(COINS_RECORD_PUT));
+                        serialize::Serialize(buffer, outpoint);
+                        serialize::WriteCompactSize(buffer, size);
+                        imported.emplace_back(outpoint, Location{ logSize + buffer.Size(), size });
+                        buffer.Write(value.Data(), size);
+                  }
+
+                  out.write(reinterpret_cast<const char*>(buffer.Data()), static_cast<std::streamsize>(buffer.Size()));
+                  if (!out) {
+                        throw StorageException("Could not write to the coins database " + LogPath());
+                  }
+                  logSize += buffer.Size();
+            }
+
+            buffer.Clear();
+            serialize::Serialize(buffer, uint8_t(COINS_RECORD_COMMIT));
+            serialize::Serialize(buffer, snapshot.GetMetadata().baseBlock);
+            out.write(reinterpret_cast<const char*>(buffer.Data()), static_cast<std::streamsize>(buffer.Size()));
+            out.flush();
+            if (!out) {
+                  throw StorageException("Could not write to the coins database " + LogPath());
+            }
+      } catch (...) {
+            out.close();
+            std::error_code error;
+            std::filesystem::resize_file(LogPath(), start, error);
+            logSize = start;
+            OpenStreams();
+            throw;
+      }
+      logSize += buffer.Size();
+
+      for (const auto& [outpoint, location] : imported) {
+            index.emplace_hint(index.end(), outpoint, location);
+            liveSize += put_record_size(location.size);
+      }
+      bestBlock = snapshot.GetMetadata().baseBlock;
+}
+
+/**
+ * @brief Rewrites the log with only the live coins, in a single batch
+ *
+ * @details The new log is written next to the old one and renamed over it, a crash
+ *          leaves either of them in place.
+ */
+void storage::CoinsDatabase::Compact() {
+      const std::string path = LogPath();
+      const std::string compacted = path + ".tmp";
+
+      /** Copy the coins in log order, the old log is read front to back */
+      std::vector<std::pair<skynet::OutPoint, Location*>> live;
+      live.reserve(index.size());
+      for (auto& [outpoint, location] : index) live.emplace_back(outpoint, &location);
+      std::sort(live.begin(), live.end(), [](const auto& a, const auto& b) { return a.second->offset < b.second->offset; });
+
+      std::vector<Location> moved;
+      moved.reserve(live.size());
+      uint64_t size = 0;
+      {
+            const MappedFile log(path);
+            log.Advise(0, log.Size(), AccessPattern::SEQUENTIAL);
+
+            std::ofstream file(compacted, std::ios::binary | std::ios::trunc);
+            for (const auto& [outpoint, location] : live) {
+                  buffer.Clear();
+                  serialize::Serialize(buffer, uint8_t(COINS_RECORD_PUT));
+                  serialize::Serialize(buffer, outpoint);
+                  serialize::WriteCompactSize(buffer, location->size);
+                  moved.push_back({ size + buffer.Size(), location->size });
+                  buffer.Write(log.Data() + location->offset, location->size);
+
+                  file.write(reinterpret_cast<const char*>(buffer.Data()), static_cast<std::streamsize>(buffer.Size()));
+                  size += buffer.Size();
+            }
+
+            buffer.Clear();
+            serialize::Serialize(buffer, uint8_t(COINS_RECORD_COMMIT));
+            serialize::Serialize(buffer, bestBlock);
+            file.write(reinterpret_cast<const char*>(buffer.Data()), static_cast<std::streamsize>(buffer.Size()));
+            size += buffer.Size();
+
+            file.flush();
+            if (!file) {
+                  throw StorageException("Could not compact the coins database " + path);
+            }
+      }
+
+      std::error_code error;
+      std::filesystem::rename(compacted, path, error);
+      if (error) {
+            throw StorageException("Could not replace the coins database " + path + ": " + error.message());
+      }
+
+      for (std::size_t i = 0; i < live.size(); i++) *live[i].second = moved[i];
+      logSize = size;
+      OpenStreams();
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,153 @@
+/**
+ * @file    coins_db.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   On disk UTXO set.
+ *
+ *          The coins live in a single append only log (coins.dat) of records
+ *
+ *            PUT     type (1) | outpoint (36) | size (CompactSize) | coin (size bytes)
+ *            ERASE   type (1) | outpoint (36)
+ *            COMMIT  type (1) | best block hash (32)
+ *
+ *          A batch is only applied once its COMMIT record is read back, so a crash in
+ *          the middle of a write leaves the set as it was after the previous batch. Only
+ *          the keys (and where their latest record is) are kept in memory, in outpoint
+ *          order so the set can be walked by a cursor. Coins are read from the log on
+ *          demand. The log is rewritten with only the live records once most of it is
+ *          garbage.
+ *
+ * @date    2023-11-19
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ */
+
+#ifndef SKYNET_COINS_DB_HPP
+#define SKYNET_COINS_DB_HPP
+
+/** C++ Includes */
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** Skynet Includes */
+#include <types.hpp>
+#include <coins.hpp>
+#include <serialize.hpp>
+#include <storage/utxo_snapshot.hpp>
+
+namespace storage
+{
+      /** The log is only compacted once it is at least this large */
+      constexpr uint64_t MIN_COINS_LOG_COMPACTION_SIZE = 16 * 1024 * 1024;
+
+      class CoinsDatabase : public skynet::CoinsView
+      {
+      public:
+            /**
+             * @param directory The directory holding the log
+             * @param minCompactionSize The size below which the log is never compacted
+             */
+            explicit CoinsDatabase(std::string directory, uint64_t minCompactionSize = MIN_COINS_LOG_COMPACTION_SIZE);
+            ~CoinsDatabase() override;
+
+            CoinsDatabase(const CoinsDatabase&) = delete;
+            CoinsDatabase& operator=(const CoinsDatabase&) = delete;
+
+            /**
+             * @brief Creates the directory if needed and replays the log
+             * @details A batch without its COMMIT record at the end of the log is discarded.
+             *
+             * @throws StorageException If the log can't be opened
+             */
+            void Open();
+
+            /**
+             * @throws StorageException If the coin can't be read
+             * @throws serialize::SerializationError If the stored coin is corrupted
+             */
+            bool GetCoin(const skynet::OutPoint& outpoint, skynet::Coin& coin) const override;
+            bool HaveCoin(const skynet::OutPoint& outpoint) const override;
+            Hash256 GetBestBlock() const override { return bestBlock; }
+            /** Returns a cursor walking the keys in order, reading each coin from the log */
+            std::unique_ptr<skynet::CoinsCursor> Cursor() const override;
+
+            /**
+             * @brief Appends the dirty entries as a single batch, then compacts the log if
+             *        most of it is garbage
+             * @throws StorageException If the batch can't be written
+             */
+            void BatchWrite(skynet::CoinsMap& coins, const Hash256& bestBlock) override;
+
+            /**
+             * @brief Fills an empty database with the coins of a snapshot
+             * @details The coins are appended in snapshot (outpoint) order as a single batch,
+             *          committed once the whole snapshot matched its commitment. A snapshot
+             *          that turns out to be corrupted leaves the database empty.
+             *
+             * @param snapshot The snapshot, with no chunk read yet
+             * @throws StorageException If the database isn't empty, the snapshot is corrupted or
+             *                          the coins can't be written
+             */
+            void Import(UtxoSnapshotReader& snapshot);
+
+            /** Returns the number of unspent coins */
+            std::size_t Size() const { return index.size(); }
+
+            /** Returns the path of the log */
+            std::string LogPath() const;
+
+      private:
+            /** Where the latest record of a coin is */
+            struct Location {
+                  uint64_t offset;                    /** Offset of the serialized coin */
+                  uint32_t size;                      /** Its size */
+            };
+
+            std::string directory;
+            uint64_t minCompactionSize;
+            std::map<skynet::OutPoint, Location> index;
+            Hash256 bestBlock{};
+
+            std::ofstream out;                        /** Appends to the log */
+            mutable std::ifstream in;                 /** Reads coins from the log */
+            uint64_t logSize = 0;                     /** Size of the log */
+            uint64_t liveSize = 0;                    /** Bytes of the log taken by live records */
+            serialize::WriteBuffer buffer;            /** Reused for every batch */
+
+            class IndexCursor;
+
+            void OpenStreams();
+            void ReadCoin(const Location& location, skynet::Coin& coin) const;
+            void Compact();
+      };
+
+} // namespace storage
+
+#endif // SKYNET_COINS_DB_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
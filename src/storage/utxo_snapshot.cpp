@@ -0,0 +1,234 @@
+//
+// Created by JoaoAJMatos on 23/11/2023.
+//
+
+/** C++ Includes */
+#include <algorithm>
+#include <filesystem>
+
+/** Skynet Includes */
+#include <storage/block_store.hpp>
+
+/** Local Includes */
+#include "utxo_snapshot.hpp"
+
+
+/** Size of the header and the footer */
+static constexpr std::size_t SNAPSHOT_HEADER_SIZE = 4 + 4 + 32 + 4;
+static constexpr std::size_t SNAPSHOT_FOOTER_SIZE = 8 + 32;
+
+/**
+ * @brief Serializes the header of a snapshot
+ */
+static serialize::WriteBuffer serialize_header(const storage::UtxoSnapshotMetadata& metadata) {
+      serialize::WriteBuffer header(SNAPSHOT_HEADER_SIZE);
+      serialize::Serialize(header, storage::UTXO_SNAPSHOT_MAGIC);
+      serialize::Serialize(header, storage::UTXO_SNAPSHOT_VERSION);
+      serialize::Serialize(header, metadata.baseBlock);
+      serialize::Serialize(header, metadata.height);
+      return header;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+storage::UtxoSnapshotWriter::UtxoSnapshotWriter(std::string path, const Hash256& baseBlock, uint32_t height, std::size_t chunkSize)
+      : path(std::move(path)), chunkSize(chunkSize == 0 ? 1 : chunkSize) {
+      metadata.baseBlock = baseBlock;
+      metadata.height = height;
+
+      file.open(this->path + ".tmp", std::ios::binary | std::ios::trunc);
+      if (!file) {
+            throw StorageException("Could not create the snapshot " + this->path);
+      }
+
+      const serialize::WriteBuffer header = serialize_header(metadata);
+      Write(header.Data(), header.Size());
+      commitment.Write(header.Data(), header.Size());
+}
+
+void storage::UtxoSnapshotWriter::Write(const byte *data, std::size_t size) {
+      file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+      if (!file) {
+            throw StorageException("Could not write to the snapshot " + path);
+      }
+}
+
+void storage::UtxoSnapshotWriter::Add(const skynet::OutPoint& outpoint, const skynet::Coin& coin) {
+      if (last && !(*last < outpoint)) {
+            throw StorageException("Snapshot coins must be added in increasing outpoint order");
+      }
+      last = outpoint;
+
+      serialize::Serialize(chunk, outpoint);
+      serialize::Serialize(chunk, coin);
+      metadata.coinCount++;
+      if (++chunkCoins == chunkSize) WriteChunk();
+}
+
+/**
+ * @brief Writes the current chunk and its hash, adding the hash to the commitment
+ */
+void storage::UtxoSnapshotWriter::WriteChunk() {
+      if (chunkCoins == 0) return;
+
+      byte prefix[8];
+      serialize::WriteLE32(prefix, chunkCoins);
+      serialize::WriteLE32(prefix + 4, static_cast<uint32_t>(chunk.Size()));
+
+      Hash256 hash;
+      crypto::hashing::SHA256(chunk.Data(), chunk.Size(), hash.data());
+
+      Write(prefix, sizeof(prefix));
+      Write(chunk.Data(), chunk.Size());
+      Write(hash.data(), hash.size());
+      commitment.Write(hash.data(), hash.size());
+
+      chunk.Clear();
+      chunkCoins = 0;
+}
+
+storage::UtxoSnapshotMetadata storage::UtxoSnapshotWriter::Finish() {
+      WriteChunk();
+
+      byte end[4 + 8];
+      serialize::WriteLE32(end, 0);
+      serialize::WriteLE64(end + 4, metadata.coinCount);
+      commitment.Write(end + 4, 8);
+      commitment.Final(metadata.commitment.data());
+
+      Write(end, sizeof(end));
+      Write(metadata.commitment.data(), metadata.commitment.size());
+      file.close();
+      if (!file) {
+            throw StorageException("Could not write to the snapshot " + path);
+      }
+
+      std::error_code error;
+      std::filesystem::rename(path + ".tmp", path, error);
+      if (error) {
+            throw StorageException("Could not move the snapshot to " + path + ": " + error.message());
+      }
+      return metadata;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+storage::UtxoSnapshotReader::UtxoSnapshotReader(const std::string& path) : path(path) {
+      file.open(path, std::ios::binary);
+      if (!file) {
+            throw StorageException("Could not open the snapshot " + path);
+      }
+
+      file.seekg(0, std::ios::end);
+      const auto size = static_cast<uint64_t>(file.tellg());
+      if (size < SNAPSHOT_HEADER_SIZE + 4 + SNAPSHOT_FOOTER_SIZE) {
+            throw StorageException("The snapshot " + path + " is truncated");
+      }
+      dataEnd = size - SNAPSHOT_FOOTER_SIZE;
+
+      byte footer[SNAPSHOT_FOOTER_SIZE];
+      file.seekg(static_cast<std::streamoff>(dataEnd));
+      Read(footer, sizeof(footer));
+      metadata.coinCount = serialize::ReadLE64(footer);
+      std::copy(footer + 8, footer + sizeof(footer), metadata.commitment.begin());
+
+      byte header[SNAPSHOT_HEADER_SIZE];
+      file.seekg(0);
+      Read(header, sizeof(header));
+      if (serialize::ReadLE32(header) != UTXO_SNAPSHOT_MAGIC || serialize::ReadLE32(header + 4) != UTXO_SNAPSHOT_VERSION) {
+            throw StorageException(path + " is not a supported UTXO snapshot");
+      }
+      std::copy(header + 8, header + 40, metadata.baseBlock.begin());
+      metadata.height = serialize::ReadLE32(header + 40);
+      commitment.Write(header, sizeof(header));
+}
+
+void storage::UtxoSnapshotReader::Read(byte *data, std::size_t size) {
+      if (!file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size))) {
+            throw StorageException("The snapshot " + path + " is truncated");
+      }
+}
+
+bool storage::UtxoSnapshotReader::ReadChunk(std::vector<std::pair<skynet::OutPoint, skynet::Coin>>& coins) {
+      coins.clear();
+      if (finished) return false;
+
+      byte count[4];
+      Read(count, sizeof(count));
+      const uint32_t chunkCoins = serialize::ReadLE32(count);
+
+      if (chunkCoins == 0) {
+            Hash256 computed;
+            byte total[8];
+            serialize::WriteLE64(total, coinsRead);
+            commitment.Write(total, sizeof(total));
+            commitment.Final(computed.data());
+
+            if (static_cast<uint64_t>(file.tellg()) != dataEnd || coinsRead != metadata.coinCount || computed != metadata.commitment) {
+                  throw StorageException("The snapshot " + path + " doesn't match its commitment");
+            }
+            finished = true;
+            return false;
+      }
+
+      byte size[4];
+      Read(size, sizeof(size));
+      const uint32_t chunkSize = serialize::ReadLE32(size);
+      if (chunkSize > MAX_UTXO_SNAPSHOT_CHUNK_BYTES || chunkCoins > chunkSize / skynet::OutPoint::SERIALIZED_SIZE ||
+          static_cast<uint64_t>(file.tellg()) + chunkSize + 32 > dataEnd) {
+            throw StorageException("The snapshot " + path + " has an oversized chunk");
+      }
+
+      Hash256 hash, computed;
+      chunk.resize(chunkSize);
+      Read(chunk.data(), chunk.size());
+      Read(hash.data(), hash.size());
+      crypto::hashing::SHA256(chunk.data(), chunk.size(), computed.data());
+      if (computed != hash) {
+            throw StorageException("A chunk of the snapshot " + path + " doesn't match its hash");
+      }
+      commitment.Write(hash.data(), hash.size());
+
+      try {
+            serialize::ReadBuffer reader(chunk);
+            coins.resize(chunkCoins);
+            for (auto& [outpoint, coin] : coins) {
+                  serialize::Unserialize(reader, outpoint);
+                  serialize::Unserialize(reader, coin);
+                  if (last && !(*last < outpoint)) {
+                        throw StorageException("The snapshot " + path + " has coins out of order");
+                  }
+                  last = outpoint;
+            }
+            if (!reader.Empty()) {
+                  throw serialize::SerializationError("Trailing bytes");
+            }
+      } catch (const serialize::SerializationError&) {
+            throw StorageException("A chunk of the snapshot " + path + " is corrupted");
+      }
+
+      coinsRead += chunkCoins;
+      return true;
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,174 @@
+/**
+ * @file    utxo_snapshot.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   UTXO set snapshots, to bootstrap a node without replaying the chain.
+ *
+ *          A snapshot holds the UTXO set as of one block, sorted by outpoint and split
+ *          in chunks that are hashed on their own:
+ *
+ *            header  magic (u32) | version (u32) | base block hash (32) | height (u32)
+ *            chunk   coins (u32) | size (u32) | (outpoint | coin) * coins | SHA256 of the coins (32)
+ *            end     0 (u32)
+ *            footer  coins (u64) | commitment (32)
+ *
+ *          The commitment is the SHA256 of the header, every chunk hash in order and
+ *          the number of coins. It is what a node is told out of band to trust: two
+ *          snapshots of the same UTXO set written with the same chunk size have the
+ *          same commitment.
+ *          Snapshots are written and read one chunk at a time, so neither side needs
+ *          the whole set in memory.
+ *
+ * @date    2023-11-23
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ */
+
+#ifndef SKYNET_UTXO_SNAPSHOT_HPP
+#define SKYNET_UTXO_SNAPSHOT_HPP
+
+/** C++ Includes */
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Skynet Includes */
+#include <types.hpp>
+#include <coins.hpp>
+#include <serialize.hpp>
+
+namespace storage
+{
+      /** Marks the start of a snapshot */
+      constexpr uint32_t UTXO_SNAPSHOT_MAGIC = 0x534e4150;               /** "PANS" */
+      constexpr uint32_t UTXO_SNAPSHOT_VERSION = 1;
+      /** Number of coins in a chunk */
+      constexpr std::size_t UTXO_SNAPSHOT_CHUNK_SIZE = 4096;
+      /** Chunks larger than this are rejected before being read */
+      constexpr uint32_t MAX_UTXO_SNAPSHOT_CHUNK_BYTES = 64 * 1024 * 1024;
+
+      /**
+       * @brief What a snapshot is of
+       */
+      struct UtxoSnapshotMetadata {
+            Hash256 baseBlock{};                /** The block the set is up to date with */
+            uint32_t height = 0;                /** Its height */
+            uint64_t coinCount = 0;             /** Number of coins */
+            Hash256 commitment{};               /** Commitment to the whole snapshot */
+      };
+
+      /**
+       * @brief Streams a UTXO set to a snapshot file
+       *
+       * @details The snapshot is written next to its path and renamed over it by Finish(),
+       *          an unfinished snapshot never shows up under the path.
+       */
+      class UtxoSnapshotWriter
+      {
+      public:
+            /**
+             * @param path Where the snapshot goes
+             * @param baseBlock The block the set is up to date with
+             * @param height Its height
+             * @param chunkSize The number of coins in a chunk
+             * @throws StorageException If the file can't be created
+             */
+            UtxoSnapshotWriter(std::string path, const Hash256& baseBlock, uint32_t height, std::size_t chunkSize = UTXO_SNAPSHOT_CHUNK_SIZE);
+
+            /**
+             * @brief Adds a coin, coins must come in increasing outpoint order
+             * @throws StorageException If the coin is out of order or can't be written
+             */
+            void Add(const skynet::OutPoint& outpoint, const skynet::Coin& coin);
+
+            /**
+             * @brief Writes the last chunk and the footer, then moves the snapshot into place
+             * @return UtxoSnapshotMetadata What was written, with its commitment
+             * @throws StorageException If the snapshot can't be written
+             */
+            UtxoSnapshotMetadata Finish();
+
+      private:
+            std::string path;
+            std::size_t chunkSize;
+            std::ofstream file;
+            UtxoSnapshotMetadata metadata;
+            serialize::HashWriter commitment;
+            serialize::WriteBuffer chunk;             /** Serialized coins of the current chunk */
+            uint32_t chunkCoins = 0;                  /** Number of coins in it */
+            std::optional<skynet::OutPoint> last;     /** The last coin added */
+
+            void WriteChunk();
+            void Write(const byte *data, std::size_t size);
+      };
+
+      /**
+       * @brief Streams the coins of a snapshot file, checking every chunk against its hash
+       *        and the whole snapshot against its commitment
+       */
+      class UtxoSnapshotReader
+      {
+      public:
+            /**
+             * @brief Opens a snapshot and reads its header and footer
+             * @throws StorageException If the file can't be read or isn't a snapshot
+             */
+            explicit UtxoSnapshotReader(const std::string& path);
+
+            /** Returns what the snapshot is of, as its header and footer claim */
+            const UtxoSnapshotMetadata& GetMetadata() const { return metadata; }
+
+            /**
+             * @brief Reads the next chunk
+             *
+             * @param coins Set to the coins of the chunk, in increasing outpoint order
+             * @return false Once every chunk was read, the snapshot then matches its commitment
+             * @throws StorageException If the snapshot is truncated, a chunk doesn't match its
+             *                          hash, coins are out of order, or the snapshot doesn't
+             *                          match its commitment
+             */
+            bool ReadChunk(std::vector<std::pair<skynet::OutPoint, skynet::Coin>>& coins);
+
+      private:
+            std::string path;
+            std::ifstream file;
+            uint64_t dataEnd = 0;                     /** Where the footer starts */
+            UtxoSnapshotMetadata metadata;
+            serialize::HashWriter commitment;
+            std::vector<byte> chunk;                  /** Reused for every chunk */
+            uint64_t coinsRead = 0;
+            std::optional<skynet::OutPoint> last;
+            bool finished = false;
+
+            void Read(byte *data, std::size_t size);
+      };
+
+} // namespace storage
+
+#endif // SKYNET_UTXO_SNAPSHOT_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
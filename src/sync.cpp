@@ -0,0 +1,308 @@
+//
+// Created by JoaoAJMatos on 21/11/2023.
+//
+
+/** C++ Includes */
+#include <chrono>
+#include <future>
+#include <list>
+#include <map>
+#include <set>
+#include <utility>
+
+/** Skynet Includes */
+#include <threading/threadpool.hpp>
+
+/** Local Includes */
+#include "sync.hpp"
+
+
+/** How long the download loop waits for the oldest request before checking the others */
+static constexpr std::chrono::milliseconds DOWNLOAD_POLL_INTERVAL(5);
+
+/**
+ * @brief A header chain downloaded from a peer
+ */
+struct HeaderChain {
+      std::vector<skynet::BlockHeader> headers;       /** The headers the chain is missing, in order */
+      std::vector<Hash256> hashes;                    /** Their hashes */
+      uint32_t firstHeight = 0;                       /** Height of the first one */
+      skynet::ChainWork work;                         /** Total work of the chain ending in the last one */
+};
+
+/**
+ * @brief Downloads the header chain of a peer, checking every header as it comes in
+ *
+ * @details Headers the chain already knows are skipped, the first new one must build on
+ *          a known block and every other one on the header before it. Each header must
+ *          meet its own difficulty target. A full batch has to get past the locator it
+ *          answers, with a new header or a higher known one, or the peer could keep the
+ *          download going forever.
+ *
+ * @param chain The chain being synced
+ * @param peer The peer
+ * @param progress Set to the height of the last checked header
+ * @return HeaderChain The new headers
+ * @throws skynet::SyncException If the peer sends an invalid header chain or stalls
+ */
+static HeaderChain download_header_chain(const skynet::Chain& chain, skynet::SyncPeer& peer, std::atomic<uint32_t>& progress) {
+      HeaderChain result;
+      std::vector<Hash256> locator = chain.GetLocator();
+      const skynet::BlockNode *known = nullptr;
+
+      for (;;) {
+            /** Where the request starts from */
+            const skynet::BlockNode *requested = known;
+            const std::size_t downloaded = result.headers.size();
+
+            const std::vector<skynet::BlockHeader> batch = peer.GetHeaders(locator, skynet::MAX_HEADERS_PER_REQUEST);
+            if (batch.size() > skynet::MAX_HEADERS_PER_REQUEST) {
+                  throw skynet::SyncException("Peer sent too many headers");
+            }
+
+            for (const skynet::BlockHeader& header : batch) {
+                  const Hash256 hash = header.Hash();
+
+                  if (result.headers.empty()) {
+                        if (const skynet::BlockNode *node = chain.LookupBlock(hash)) {
+                              known = node;
+                              continue;
+                        }
+
+                        const skynet::BlockNode *parent = chain.LookupBlock(header.prevHash);
+                        if (parent == nullptr && !(header.prevHash == Hash256{} && chain.Size() == 0)) {
+                              throw skynet::SyncException("Headers don't connect to the chain");
+                        }
+                        result.firstHeight = parent ? parent->height + 1 : 0;
+                        if (parent) result.work = parent->chainWork;
+                  } else if (header.prevHash != result.hashes.back()) {
+                        throw skynet::SyncException("Headers are not linked");
+                  }
+
+                  if (!skynet::MeetsDifficultyTarget(hash, header.difficultyTarget)) {
+                        throw skynet::SyncException("Header doesn't meet its difficulty target");
+                  }
+
+                  result.headers.push_back(header);
+                  result.hashes.push_back(hash);
+                  result.work += skynet::ChainWork::ForTarget(header.difficultyTarget);
+                  progress = result.firstHeight + static_cast<uint32_t>(result.headers.size()) - 1;
+            }
+
+            if (batch.size() < skynet::MAX_HEADERS_PER_REQUEST) break;
+            if (result.headers.size() == downloaded && requested != nullptr && known->height <= requested->height) {
+                  throw skynet::SyncException("Peer keeps sending headers the chain already knows");
+            }
+            locator = { result.hashes.empty() ? known->hash : result.hashes.back() };
+      }
+
+      return result;
+}
+
+/**
+ * @brief Downloads a run of blocks from a peer and checks them against their headers
+ *
+ * @details Runs on the download threads, so the context free checks of the blocks (the
+ *          bulk of it being TXID and Merkle hashing) are spread across them. The chain
+ *          is told they passed, so it doesn't run them again.
+ *
+ * @param peer The peer
+ * @param hashes The hashes of the blocks
+ * @return std::vector<skynet::Block> The blocks, in order
+ * @throws skynet::SyncException If the peer sends other blocks or malformed ones
+ */
+static std::vector<skynet::Block> download_blocks(skynet::SyncPeer& peer, const std::vector<Hash256>& hashes) {
+      std::vector<skynet::Block> blocks = peer.GetBlocks(hashes);
+      if (blocks.size() != hashes.size()) {
+            throw skynet::SyncException("Peer sent the wrong number of blocks");
+      }
+
+      for (std::size_t i = 0; i < blocks.size(); i++) {
+            if (blocks[i].Hash() != hashes[i] || !blocks[i].HasValidContent()) {
+                  throw skynet::SyncException("Peer sent a block that doesn't match its header");
+            }
+      }
+      return blocks;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+skynet::BlockSync::BlockSync(Chain& chain, std::vector<std::shared_ptr<SyncPeer>> peers, std::size_t window, std::size_t blocksPerRequest)
+      : chain(chain), peers(std::move(peers)), window(window == 0 ? 1 : window), blocksPerRequest(blocksPerRequest == 0 ? 1 : blocksPerRequest) {}
+
+skynet::SyncProgress skynet::BlockSync::GetProgress() const {
+      SyncProgress progress;
+      progress.headerHeight = headerHeight;
+      progress.blockHeight = blockHeight;
+      progress.blocksDownloaded = blocksDownloaded;
+      progress.failedRequests = failedRequests;
+      progress.assumedValidBlocks = assumedValidBlocks;
+      return progress;
+}
+
+skynet::SyncProgress skynet::BlockSync::Run() {
+      const BlockNode *tip = chain.GetTip();
+      headerHeight = blockHeight = tip ? tip->height : 0;
+
+      DownloadBlocks(DownloadHeaders());
+      return GetProgress();
+}
+
+/**
+ * @brief Downloads the header chain from the first peer that serves a valid one with more
+ *        work than the chain
+ *
+ * @return std::vector<skynet::BlockHeader> The new headers, empty if no peer is ahead
+ * @throws SyncException If every peer failed
+ */
+std::vector<skynet::BlockHeader> skynet::BlockSync::DownloadHeaders() {
+      bool answered = false;
+
+      for (const auto& peer : peers) {
+            HeaderChain headers;
+            try {
+                  headers = download_header_chain(chain, *peer, headerHeight);
+            } catch (const std::exception&) {
+                  failedRequests++;
+                  continue;
+            }
+            answered = true;
+
+            const BlockNode *tip = chain.GetTip();
+            if (!headers.headers.empty() && (tip == nullptr || tip->chainWork < headers.work)) {
+                  return headers.headers;
+            }
+      }
+
+      if (!answered) {
+            throw SyncException("No peer served a valid header chain");
+      }
+      return {};
+}
+
+/**
+ * @brief Downloads the blocks of a header chain and connects them in height order
+ *
+ * @details Every idle peer gets the next BLOCKS_PER_REQUEST blocks of the window, each peer
+ *          working on a single request at a time. Blocks that come in ahead of the next one
+ *          to connect wait in a reorder buffer, which the window keeps bounded. A failed
+ *          request goes to the next idle peer, and a peer that failed MAX_PEER_FAILURES
+ *          times is no longer used.
+ *
+ * @param headers The headers, in order
+ * @throws SyncException If every peer failed or a block is rejected by the chain
+ */
+void skynet::BlockSync::DownloadBlocks(const std::vector<BlockHeader>& headers) {
+      if (headers.empty()) return;
+
+      std::vector<Hash256> hashes;
+      hashes.reserve(headers.size());
+      for (const BlockHeader& header : headers) hashes.push_back(header.Hash());
+
+      const BlockNode *parent = chain.LookupBlock(headers.front().prevHash);
+      const uint32_t firstHeight = parent ? parent->height + 1 : 0;
+
+      /** Ancestors of the assume-valid block skip their signature checks */
+      chain.AddAssumeValidHeaders(headers);
+      const std::size_t assumedBefore = chain.GetAssumedValidBlocks();
+
+      struct Request {
+            std::size_t start;
+            std::size_t count;
+            std::size_t peer;
+            std::future<std::vector<Block>> blocks;
+      };
+
+      threading::ThreadPool pool(peers.size());
+      pool.Init();
+
+      std::list<Request> inFlight;
+      std::set<std::pair<std::size_t, std::size_t>> retries;     /** Failed runs (start, count) */
+      std::map<std::size_t, Block> received;                     /** Reorder buffer */
+      std::vector<bool> busy(peers.size(), false);
+      std::vector<std::size_t> failures(peers.size(), 0);
+      std::size_t next = 0, connected = 0;
+
+      while (connected < hashes.size()) {
+            /** Hand out runs of blocks to the idle peers, failed runs first */
+            for (std::size_t peer = 0; peer < peers.size(); peer++) {
+                  if (busy[peer] || failures[peer] >= MAX_PEER_FAILURES) continue;
+
+                  std::pair<std::size_t, std::size_t> run;
+                  if (!retries.empty()) {
+                        run = *retries.begin();
+                        retries.erase(retries.begin());
+                  } else if (next < hashes.size() && next < connected + window) {
+                        run = { next, std::min({ blocksPerRequest, hashes.size() - next, connected + window - next }) };
+                        next += run.second;
+                  } else {
+                        break;
+                  }
+
+                  std::vector<Hash256> wanted(hashes.begin() + run.first, hashes.begin() + run.first + run.second);
+                  busy[peer] = true;
+                  inFlight.push_back({ run.first, run.second, peer, pool.Enqueue([target = peers[peer], wanted = std::move(wanted)]() {
+                        return download_blocks(*target, wanted);
+                  }) });
+            }
+
+            if (inFlight.empty()) {
+                  throw SyncException("No peer left to download blocks from");
+            }
+
+            /** Collect whatever came in */
+            inFlight.front().blocks.wait_for(DOWNLOAD_POLL_INTERVAL);
+            for (auto it = inFlight.begin(); it != inFlight.end(); ) {
+                  if (it->blocks.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                        ++it;
+                        continue;
+                  }
+
+                  busy[it->peer] = false;
+                  try {
+                        std::vector<Block> blocks = it->blocks.get();
+                        for (std::size_t i = 0; i < blocks.size(); i++) received.emplace(it->start + i, std::move(blocks[i]));
+                        blocksDownloaded += blocks.size();
+                  } catch (const std::exception&) {
+                        failures[it->peer]++;
+                        failedRequests++;
+                        retries.emplace(it->start, it->count);
+                  }
+                  it = inFlight.erase(it);
+            }
+
+            /** Connect the blocks that are next in line */
+            for (auto it = received.begin(); it != received.end() && it->first == connected; it = received.erase(it)) {
+                  try {
+                        chain.AddBlock(it->second, true);
+                  } catch (const ChainException& exception) {
+                        throw SyncException("Block " + std::to_string(firstHeight + it->first) + " is invalid: " + exception.what());
+                  }
+                  connected++;
+                  blockHeight = chain.GetTip()->height;
+                  assumedValidBlocks = chain.GetAssumedValidBlocks() - assumedBefore;
+            }
+      }
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,174 @@
+/**
+ * @file    sync.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   Headers first initial block download.
+ *
+ *          Syncing runs in two phases:
+ *
+ *            1. The header chain is downloaded from a single peer. Headers are 80 bytes,
+ *               so the whole chain comes in a few round trips, and each one is checked
+ *               (linkage and proof of work) before a single block is requested.
+ *            2. The blocks of the header chain are requested from every peer in parallel,
+ *               a few at a time, inside a sliding window ahead of the last connected
+ *               block. Blocks are connected in height order as soon as they are in, while
+ *               the requests further up the window keep downloading.
+ *
+ *          Ancestors of the chain's assume-valid block (Chain::SetAssumeValid) found in
+ *          the header chain are connected without checking their signatures.
+ *
+ *          Peers sit behind the SyncPeer interface, so the sync doesn't depend on how
+ *          they are reached.
+ *
+ * @date    2023-11-21
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ */
+
+#ifndef SKYNET_SYNC_HPP
+#define SKYNET_SYNC_HPP
+
+/** C++ Includes */
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/** Skynet Includes */
+#include <types.hpp>
+#include <block.hpp>
+#include <blockchain.hpp>
+
+namespace skynet
+{
+      /** Maximum number of headers asked for at once */
+      constexpr std::size_t MAX_HEADERS_PER_REQUEST = 2000;
+      /** Number of blocks asked for in a single request */
+      constexpr std::size_t BLOCKS_PER_REQUEST = 16;
+      /** How far past the last connected block requests may go */
+      constexpr std::size_t BLOCK_DOWNLOAD_WINDOW = 1024;
+      /** Failed requests after which a peer is no longer used */
+      constexpr std::size_t MAX_PEER_FAILURES = 3;
+
+      class SyncException : public std::runtime_error
+      {
+      public:
+            explicit SyncException(const std::string& message) : std::runtime_error(message) {}
+      };
+
+      /**
+       * @brief A peer blocks are downloaded from
+       *
+       * @details Calls come from the download threads, at most one at a time per peer.
+       *          Implementations are expected to time out on their own and throw.
+       */
+      class SyncPeer
+      {
+      public:
+            virtual ~SyncPeer() = default;
+
+            /**
+             * @brief Returns the headers of the peer's best chain following the first hash of
+             *        the locator it knows (from its genesis block if it knows none)
+             *
+             * @param locator Hashes of our chain, newest first (Chain::GetLocator)
+             * @param max The maximum number of headers to return
+             */
+            virtual std::vector<BlockHeader> GetHeaders(const std::vector<Hash256>& locator, std::size_t max) = 0;
+
+            /**
+             * @brief Returns the blocks with the given hashes, in order
+             */
+            virtual std::vector<Block> GetBlocks(const std::vector<Hash256>& hashes) = 0;
+      };
+
+      /**
+       * @brief How far a sync got
+       */
+      struct SyncProgress {
+            uint32_t headerHeight = 0;          /** Height of the last downloaded header */
+            uint32_t blockHeight = 0;           /** Height of the tip of the chain */
+            std::size_t blocksDownloaded = 0;   /** Blocks received from peers */
+            std::size_t failedRequests = 0;     /** Requests that failed and were sent to another peer */
+            std::size_t assumedValidBlocks = 0; /** Blocks connected without checking their signatures */
+      };
+
+      /**
+       * @brief Brings a chain up to the best chain of a set of peers
+       */
+      class BlockSync
+      {
+      public:
+            /**
+             * @param chain The chain to sync
+             * @param peers The peers to download from
+             * @param window How far past the last connected block requests may go
+             * @param blocksPerRequest The number of blocks asked for in a single request
+             */
+            BlockSync(Chain& chain, std::vector<std::shared_ptr<SyncPeer>> peers,
+                      std::size_t window = BLOCK_DOWNLOAD_WINDOW, std::size_t blocksPerRequest = BLOCKS_PER_REQUEST);
+
+            /**
+             * @brief Downloads the header chain, then its blocks, connecting them as they come in
+             *
+             * @return SyncProgress Where the sync ended
+             * @throws SyncException If no peer could serve a valid header chain, every peer failed
+             *                       while downloading blocks, or a downloaded block is invalid
+             */
+            SyncProgress Run();
+
+            /** Returns how far the sync got so far, safe to call while it runs */
+            SyncProgress GetProgress() const;
+
+      private:
+            Chain& chain;
+            std::vector<std::shared_ptr<SyncPeer>> peers;
+            std::size_t window;
+            std::size_t blocksPerRequest;
+
+            std::atomic<uint32_t> headerHeight{ 0 };
+            std::atomic<uint32_t> blockHeight{ 0 };
+            std::atomic<std::size_t> blocksDownloaded{ 0 };
+            std::atomic<std::size_t> failedRequests{ 0 };
+            std::atomic<std::size_t> assumedValidBlocks{ 0 };
+
+            /**
+             * @brief Downloads and checks the header chain from the first peer that serves a valid one
+             * @return std::vector<BlockHeader> The headers of the blocks the chain is missing, in order
+             */
+            std::vector<BlockHeader> DownloadHeaders();
+
+            /**
+             * @brief Downloads the blocks of a header chain from every peer and connects them in order
+             */
+            void DownloadBlocks(const std::vector<BlockHeader>& headers);
+      };
+
+} // namespace skynet
+
+#endif // SKYNET_SYNC_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -9,7 +9,7 @@ threading::ThreadPool::ThreadPool(const size_t thread_count) {
       this->running_ = false;
 }
 
-inline threading::ThreadPool::~ThreadPool() { this->Stop(false); }
+threading::ThreadPool::~ThreadPool() { this->Stop(false); }
 
 
 /**
@@ -18,6 +18,7 @@ inline threading::ThreadPool::~ThreadPool() { this->Stop(false); }
 void threading::ThreadPool::Init() {
       std::call_once(this->once_flag_, [this]() {
             LOCK_MUTEX_WRITE(this->mutex_);
+            this->running_ = true;
             workers_.reserve(this->thread_count_);
             for (size_t i = 0; i < this->thread_count_; ++i) {
                   this->workers_.emplace_back(std::bind(&ThreadPool::Spawn, this));
@@ -32,7 +33,11 @@ void threading::ThreadPool::Init() {
  */
 void threading::ThreadPool::Stop(const bool wait) {
       if (!running_) return;
-      running_ = false;
+      {
+            /* Flip the flag under the lock so no worker misses the wake up */
+            LOCK_MUTEX_WRITE(mutex_);
+            running_ = false;
+      }
       if (!wait) {
             tasks_.Clear(); 
       }
@@ -62,26 +67,6 @@ void threading::ThreadPool::Spawn() {
       }
 }
 
-/**
- * @brief Enqueue a task to be processed by a thread.
- * @param f | The function to be processed.
- * @param args | The arguments to be passed to the function.
- * @return std::future | The result of the function.
- */
-template <class F, class... Args>
-auto threading::ThreadPool::Enqueue(F &&f, Args &&... args) const -> std::future<decltype(f(args...))> {
-      using return_type = decltype(f(args...));
-      auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-      std::future<return_type> result = task->get_future();
-      {
-            LOCK_MUTEX_WRITE(mutex_);
-            tasks_.Push([task]() { (*task)(); });
-      }
-      condition_.notify_one();
-      return result;
-}
-
 /* GETTERS AND OBSERVABLES */
 bool threading::ThreadPool::IsRunning() const { return running_; }
 size_t threading::ThreadPool::GetThreadCount() const { return thread_count_; }
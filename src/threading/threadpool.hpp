@@ -25,6 +25,8 @@
 #include <vector>
 #include <shared_mutex>
 #include <condition_variable>
+#include <atomic>
+#include <memory>
 
 /* Local includes */
 #include "blocking_queue.hpp"
@@ -62,7 +64,7 @@ namespace threading
 
             /* MEMBER VARIABLES */
             size_t thread_count_;
-            bool running_;
+            std::atomic<bool> running_;
             mutable std::shared_mutex mutex_;
             mutable std::condition_variable_any condition_;
             mutable std::once_flag once_flag_;
@@ -71,6 +73,27 @@ namespace threading
       };
 }
 
+/**
+ * @brief Enqueue a task to be processed by a thread.
+ * @details Defined in the header so it can be instantiated by every caller.
+ * @param f | The function to be processed.
+ * @param args | The arguments to be passed to the function.
+ * @return std::future | The result of the function.
+ */
+template <class F, class... Args>
+auto threading::ThreadPool::Enqueue(F &&f, Args &&... args) const -> std::future<decltype(f(args...))> {
+      using return_type = decltype(f(args...));
+      auto task = std::make_shared<std::packaged_task<return_type()>>(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+      std::future<return_type> result = task->get_future();
+      {
+            LOCK_MUTEX_WRITE(mutex_);
+            tasks_.Push([task]() { (*task)(); });
+      }
+      condition_.notify_one();
+      return result;
+}
+
 #endif //SKYNET_THREADPOOL_HPP
 
 
@@ -0,0 +1,124 @@
+//
+// Created by JoaoAJMatos on 09/11/2023.
+//
+
+/** C++ Includes */
+#include <cstring>
+
+/** Skynet Includes */
+#include <time.hpp>
+#include <consensus.hpp>
+
+/** Local Includes */
+#include "transaction.hpp"
+
+
+skynet::Transaction::Transaction() : timestamp(0), locktime(0), version(consensus::VERSION) {}
+
+/**
+ * @brief Creates a transaction, spendable right away
+ *
+ * @param input The input of the transaction
+ * @param output The output of the transaction
+ */
+skynet::Transaction::Transaction(TransactionInput input, TransactionOutput output)
+      : input(input), output(output) {
+      this->timestamp = util::time::timestamp();
+      this->locktime = this->timestamp;
+      this->version = consensus::VERSION;
+}
+
+skynet::Transaction::~Transaction() = default;
+
+/**
+ * @brief Returns the hash of the transaction (TXID)
+ *
+ * @details The serialization is streamed straight into the hash on the first call,
+ *          later calls return the cached hash.
+ *
+ * @return const TransactionHash& The hash of the transaction
+ */
+const skynet::TransactionHash& skynet::Transaction::Hash() const {
+      if (txidCached) return txid;
+
+      serialize::HashWriter writer;
+      serialize::Serialize(writer, *this);
+      writer.Final(txid.data());
+
+      txidCached = true;
+      return txid;
+}
+
+/**
+ * @brief Returns the hash signed by the sender
+ *
+ * @details The fields are streamed into the hash one by one (with a blank copy of the
+ *          input) instead of copying the transaction, so the cached TXID is never read
+ *          and other threads can call Hash() meanwhile.
+ *
+ * @return skynet::TransactionHash The SHA-256 of the transaction with a blank signature
+ */
+skynet::TransactionHash skynet::Transaction::SignatureHash() const {
+      TransactionInput unsigned_input(this->input);
+      memset(unsigned_input.signature, 0, sizeof(unsigned_input.signature));
+
+      TransactionHash hash;
+      serialize::HashWriter writer;
+      serialize::Serialize(writer, this->version);
+      serialize::Serialize(writer, static_cast<int64_t>(this->timestamp));
+      serialize::Serialize(writer, unsigned_input);
+      serialize::Serialize(writer, this->output);
+      serialize::Serialize(writer, static_cast<int64_t>(this->locktime));
+      writer.Final(hash.data());
+      return hash;
+}
+
+/**
+ * @brief Signs the transaction on behalf of the owner of a key pair
+ *
+ * @param context The ECDSA context
+ * @param keyPair The key pair of the sender
+ */
+void skynet::Transaction::Sign(crypto::ecdsa::Context context, crypto::ecdsa::KeyPair *keyPair) {
+      memcpy(this->input.sender, keyPair->public_key, sizeof(this->input.sender));
+
+      TransactionHash hash = SignatureHash();
+      crypto::ecdsa::sign(context, keyPair, hash.data(), this->input.signature);
+      InvalidateHash();
+}
+
+bool skynet::Transaction::HasValidSignature() const {
+      const TransactionHash hash = SignatureHash();
+      return crypto::ecdsa::verify(nullptr, hash.data(), this->input.signature, this->input.sender);
+}
+
+/** Transactions are identified by their hash */
+bool skynet::Transaction::operator==(const Transaction &transaction) const {
+      return this->Hash() == transaction.Hash();
+}
+
+bool skynet::Transaction::operator!=(const Transaction &transaction) const {
+      return !(*this == transaction);
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -20,13 +20,14 @@
 
 /** Skynet includes */
 #include <types.hpp>
+#include <serialize.hpp>
 #include <crypto/ecdsa.hpp>
 #include <crypto/sha256.hpp>
 
 namespace skynet
 {
       /** Type Alaises */
-      using TransactionHash = byte[crypto::hashing::SHA256_HASH_SIZE];
+      using TransactionHash = Hash256;
 
       /**
        * @brief The TransactionInput struct represents a single input in a transaction.
@@ -41,7 +42,9 @@ namespace skynet
             crypto::ecdsa::Signature signature;           /** The signature of the sender */
             int sequence;                                 /** The sequence number */
 
-            /** Constructor */
+            /** Constructors */
+            TransactionInput() : prevTransactionOutput{}, prevTransactionOutputIndex(0), sender{}, signature{}, sequence(0) {}
+
             TransactionInput(
                   byte prevTransactionOutput[crypto::hashing::SHA256_HASH_SIZE], 
                   int prevTransactionOutputIndex, 
@@ -50,7 +53,7 @@ namespace skynet
                   int sequence
             ) 
             {
-                  memcpy(this->prevTransactionOutput, prevTransactionOutput, crypto::hashing::SHA256_HASH_SIZE);
+                  memcpy(this->prevTransactionOutput.data(), prevTransactionOutput, crypto::hashing::SHA256_HASH_SIZE);
                   this->prevTransactionOutputIndex = prevTransactionOutputIndex;
                   memcpy(this->sender, sender, crypto::ecdsa::COMPRESSED_PUBLIC_KEY_SIZE);
                   memcpy(this->signature, signature, crypto::ecdsa::SERIALIZED_SIGNATURE_SIZE);
@@ -63,6 +66,8 @@ namespace skynet
             int value;                                          /** The amount of coins to be sent */
             crypto::ecdsa::PublicKey recipient;                 /** The recipients wallet address */
 
+            TransactionOutput() : value(0), recipient{} {}
+
             TransactionOutput(int value, crypto::ecdsa::PublicKey recipient) {
                   this->value = value;
                   memcpy(this->recipient, recipient, crypto::ecdsa::COMPRESSED_PUBLIC_KEY_SIZE);
@@ -76,6 +81,8 @@ namespace skynet
       class Transaction
       {
       public:
+            /** Creates an empty transaction, to be filled by Unserialize */
+            Transaction();
             Transaction(TransactionInput input, TransactionOutput output);
             ~Transaction();
 
@@ -89,11 +96,39 @@ namespace skynet
             bool IsValid();
  
             /**
-             * @brief Returns the hash of the transaction
+             * @brief Returns the hash of the transaction (TXID), the SHA-256 of its serialization
+             * @details Computed on the first call and cached with the transaction, so each
+             *          transaction is hashed at most once. Call it once before sharing the
+             *          transaction across threads, the first call fills the cache.
              * 
-             * @return std::unique_ptr<byte[]> 
+             * @return const TransactionHash& The cached hash
+             */
+            const TransactionHash& Hash() const;
+
+            /**
+             * @brief Returns the hash the sender signs: the SHA-256 of the serialization with
+             *        an all zero signature
+             * @details Not cached, it is only needed to sign and to verify the transaction.
+             */
+            [[nodiscard]] TransactionHash SignatureHash() const;
+
+            /**
+             * @brief Makes the owner of a key pair the sender and signs the transaction
+             *
+             * @param context The ECDSA context (created for signing)
+             * @param keyPair The key pair of the sender
+             * @throws crypto::ecdsa::Exception If the transaction can't be signed
+             */
+            void Sign(crypto::ecdsa::Context context, crypto::ecdsa::KeyPair *keyPair);
+
+            /**
+             * @brief Checks the signature of the input against its sender
+             * @details Thread safe, only reads the fields of the transaction (not its cached
+             *          hash), so it can run while another thread calls Hash().
+             *
+             * @return true If the input is signed by the sender
              */
-            std::unique_ptr<byte[]> Hash() const;
+            [[nodiscard]] bool HasValidSignature() const;
             
             /**
              * @brief Calculates the fee earnings of the miner
@@ -110,6 +145,12 @@ namespace skynet
              */
             std::string ToString() const;
 
+            /**
+             * @brief Returns whether the transaction mints new coins instead of spending an output
+             * @details Coinbase transactions don't reference a previous output (all zero TXID).
+             */
+            [[nodiscard]] bool IsCoinbase() const { return input.prevTransactionOutput == TransactionHash{}; }
+
             /** Operators */
             bool operator==(const Transaction &transaction) const;
             bool operator!=(const Transaction &transaction) const;
@@ -119,6 +160,9 @@ namespace skynet
             [[nodiscard]] TransactionOutput GetOutput() const { return output; }
             [[nodiscard]] time_t GetLocktime() const { return locktime; }
             [[nodiscard]] float GetVersion() const { return version; }
+
+            /** Setters */
+            void SetLocktime(time_t locktime) { this->locktime = locktime; InvalidateHash(); }
             
       private:
             time_t timestamp;             /** The timestamp of the transaction */
@@ -126,7 +170,85 @@ namespace skynet
             TransactionOutput output;     /** The output of the transaction */
             time_t locktime;              /** The time when the transaction can be added to a block */
             float version;                /** The version of the protocol when the transaction was created */
+
+            mutable TransactionHash txid;       /** Cached hash of the transaction */
+            mutable bool txidCached = false;    /** Whether txid holds the hash of the current fields */
+
+            /** Drops the cached hash, must be called by anything that changes the fields above */
+            void InvalidateHash() { txidCached = false; }
+
+            friend struct serialize::Serializer<Transaction>;
       };
 }
 
+/**
+ * @brief Transaction serialization
+ *
+ *        input:  prevTransactionOutput (32) | prevTransactionOutputIndex (int32) | sender (33) | signature (64) | sequence (int32)
+ *        output: value (int32) | recipient (33)
+ *        transaction: version (float) | timestamp (int64) | input | output | locktime (int64)
+ */
+template<>
+struct serialize::Serializer<skynet::TransactionInput> {
+      template<typename Stream>
+      static void Write(Stream& stream, const skynet::TransactionInput& input) {
+            Serialize(stream, input.prevTransactionOutput);
+            Serialize(stream, static_cast<int32_t>(input.prevTransactionOutputIndex));
+            Serialize(stream, input.sender);
+            Serialize(stream, input.signature);
+            Serialize(stream, static_cast<int32_t>(input.sequence));
+      }
+
+      static void Read(ReadBuffer& reader, skynet::TransactionInput& input) {
+            int32_t index, sequence;
+            Unserialize(reader, input.prevTransactionOutput);
+            Unserialize(reader, index);
+            Unserialize(reader, input.sender);
+            Unserialize(reader, input.signature);
+            Unserialize(reader, sequence);
+            input.prevTransactionOutputIndex = index;
+            input.sequence = sequence;
+      }
+};
+
+template<>
+struct serialize::Serializer<skynet::TransactionOutput> {
+      template<typename Stream>
+      static void Write(Stream& stream, const skynet::TransactionOutput& output) {
+            Serialize(stream, static_cast<int32_t>(output.value));
+            Serialize(stream, output.recipient);
+      }
+
+      static void Read(ReadBuffer& reader, skynet::TransactionOutput& output) {
+            int32_t value;
+            Unserialize(reader, value);
+            Unserialize(reader, output.recipient);
+            output.value = value;
+      }
+};
+
+template<>
+struct serialize::Serializer<skynet::Transaction> {
+      template<typename Stream>
+      static void Write(Stream& stream, const skynet::Transaction& transaction) {
+            Serialize(stream, transaction.version);
+            Serialize(stream, static_cast<int64_t>(transaction.timestamp));
+            Serialize(stream, transaction.input);
+            Serialize(stream, transaction.output);
+            Serialize(stream, static_cast<int64_t>(transaction.locktime));
+      }
+
+      static void Read(ReadBuffer& reader, skynet::Transaction& transaction) {
+            int64_t timestamp, locktime;
+            Unserialize(reader, transaction.version);
+            Unserialize(reader, timestamp);
+            Unserialize(reader, transaction.input);
+            Unserialize(reader, transaction.output);
+            Unserialize(reader, locktime);
+            transaction.timestamp = static_cast<time_t>(timestamp);
+            transaction.locktime = static_cast<time_t>(locktime);
+            transaction.InvalidateHash();
+      }
+};
+
 #endif // SKYNET_TRANSACTION_HPP
@@ -5,8 +5,25 @@
 #ifndef SKYNET_TYPES_HPP
 #define SKYNET_TYPES_HPP
 
+#include <array>
+#include <cstddef>
+#include <cstring>
+
 using byte = unsigned char;
 using word = unsigned int;
 using uuid = unsigned char[16];
+using Hash256 = std::array<byte, 32>;
+
+/**
+ * Hashes are already uniformly distributed, so their bytes make a good bucket key.
+ * The last bytes are used, block hashes start with the zeros of their difficulty.
+ */
+struct Hash256Hasher {
+      std::size_t operator()(const Hash256& hash) const noexcept {
+            std::size_t key;
+            memcpy(&key, hash.data() + hash.size() - sizeof(key), sizeof(key));
+            return key;
+      }
+};
 
 #endif //SKYNET_TYPES_HPP
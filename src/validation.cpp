@@ -0,0 +1,100 @@
+//
+// Created by JoaoAJMatos on 20/11/2023.
+//
+
+/** Skynet Includes */
+#include <threading/threadpool.hpp>
+
+/** Local Includes */
+#include "validation.hpp"
+
+
+/**
+ * @brief Verifies a batch of signatures, giving up as soon as one of them (in any batch) fails
+ *
+ * @param transactions The transactions to check
+ * @param failed Set when a signature is invalid, checked before each verification
+ */
+static void check_signatures(const std::vector<const skynet::Transaction*>& transactions, std::atomic<bool>& failed) {
+      for (const skynet::Transaction *transaction : transactions) {
+            if (failed.load(std::memory_order_relaxed)) return;
+            if (!transaction->HasValidSignature()) {
+                  failed.store(true, std::memory_order_relaxed);
+                  return;
+            }
+      }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+
+skynet::CheckQueueControl::CheckQueueControl(const threading::ThreadPool *pool, std::size_t batchSize)
+      : pool(pool), batchSize(batchSize == 0 ? 1 : batchSize) {
+      batch.reserve(this->batchSize);
+}
+
+skynet::CheckQueueControl::~CheckQueueControl() {
+      /** The batches refer to the transactions and to this control */
+      for (auto& result : pending) {
+            if (result.valid()) result.wait();
+      }
+}
+
+void skynet::CheckQueueControl::Add(const Transaction *transaction) {
+      if (failed.load(std::memory_order_relaxed)) return;
+
+      batch.push_back(transaction);
+      if (batch.size() >= batchSize) Dispatch();
+}
+
+/**
+ * @brief Hands the current batch to the pool, or checks it right away without one
+ */
+void skynet::CheckQueueControl::Dispatch() {
+      if (batch.empty()) return;
+
+      if (pool == nullptr || pool->GetThreadCount() < 2) {
+            check_signatures(batch, failed);
+            batch.clear();
+            return;
+      }
+
+      pending.push_back(pool->Enqueue([this, transactions = std::move(batch)]() { check_signatures(transactions, failed); }));
+      batch.clear();
+      batch.reserve(batchSize);
+}
+
+/**
+ * @brief Checks what is left on the calling thread, then waits for the pool
+ *
+ * @return true If every queued signature is valid
+ */
+bool skynet::CheckQueueControl::Wait() {
+      check_signatures(batch, failed);
+      batch.clear();
+
+      for (auto& result : pending) result.get();
+      pending.clear();
+      return !failed.load();
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
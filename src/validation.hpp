@@ -0,0 +1,113 @@
+/**
+ * @file    validation.hpp
+ * @author  JoaoAJMatos
+ *
+ * @brief   Parallel signature checks for block validation.
+ *
+ *          Blocks are validated in stages, cheapest first:
+ *
+ *            1. Context free checks (Block::HasValidContent), when the block is accepted:
+ *               transaction count, proof of work, duplicate TXIDs and the Merkle root.
+ *            2. UTXO checks, when the block is connected: every input must spend an
+ *               unspent output owned by its sender.
+ *            3. Signature checks, fanned out to a thread pool in batches while stage 2
+ *               walks the rest of the block.
+ *
+ *          A CheckQueueControl collects the signature checks of a block and reports
+ *          whether they all passed. The first failing check stops the batches that
+ *          haven't started yet, so an invalid block is rejected without verifying the
+ *          remaining signatures.
+ *
+ * @date    2023-11-20
+ *
+ * @copyright Copyright (c) 2023
+ * @license MIT
+ */
+
+#ifndef SKYNET_VALIDATION_HPP
+#define SKYNET_VALIDATION_HPP
+
+/** C++ Includes */
+#include <atomic>
+#include <future>
+#include <vector>
+
+/** Skynet Includes */
+#include <transaction.hpp>
+
+namespace threading { class ThreadPool; }
+
+namespace skynet
+{
+      /** Number of signature checks handed to a thread at once */
+      constexpr std::size_t SIGNATURE_CHECK_BATCH_SIZE = 32;
+
+      /**
+       * @brief Aggregates the signature checks of a block and runs them on a thread pool
+       *
+       * @details Checks are queued in batches as they are added, so the pool verifies
+       *          signatures while the caller is still walking the block. The transactions
+       *          must outlive the control (Wait() is called on destruction). Not thread
+       *          safe, one control per block being connected.
+       */
+      class CheckQueueControl
+      {
+      public:
+            /**
+             * @param pool The pool to run the checks on, nullptr to run them on the calling thread
+             * @param batchSize The number of checks per batch
+             */
+            explicit CheckQueueControl(const threading::ThreadPool *pool, std::size_t batchSize = SIGNATURE_CHECK_BATCH_SIZE);
+            ~CheckQueueControl();
+
+            CheckQueueControl(const CheckQueueControl&) = delete;
+            CheckQueueControl& operator=(const CheckQueueControl&) = delete;
+
+            /**
+             * @brief Queues the signature check of a transaction
+             * @details Does nothing once a check failed.
+             */
+            void Add(const Transaction *transaction);
+
+            /**
+             * @brief Runs the remaining checks and waits for every batch
+             * @return true If every signature is valid
+             */
+            bool Wait();
+
+      private:
+            const threading::ThreadPool *pool;
+            std::size_t batchSize;
+
+            std::vector<const Transaction*> batch;    /** Checks not dispatched yet */
+            std::vector<std::future<void>> pending;   /** Batches running on the pool */
+            std::atomic<bool> failed{ false };        /** Set by the first failing check */
+
+            void Dispatch();
+      };
+
+} // namespace skynet
+
+#endif // SKYNET_VALIDATION_HPP
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,187 @@
+/**
+ * @file   block_test.hpp
+ * @author JoaoAJMatos
+ *
+ * @brief Block unit tests
+ *
+ * @version 0.1
+ * @date 2023-11-10
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+
+/* Skynet Includes */
+#include <block.hpp>
+#include <block_index.hpp>
+#include <crypto/sha256.hpp>
+
+/* C++ Includes */
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+/* Local Includes */
+#include "unipp.hpp"
+
+
+/** A header with every field set to something recognizable */
+static skynet::BlockHeader MakeTestHeader() {
+      Hash256 prev, merkle;
+      for (std::size_t i = 0; i < prev.size(); i++) {
+            prev[i] = static_cast<byte>(i);
+            merkle[i] = static_cast<byte>(0xff - i);
+      }
+      return skynet::BlockHeader(1, prev, merkle, 0x65432100, 20, 0xdeadbeef);
+}
+
+/** A block on top of prev that meets its difficulty target, shared by the storage, chain and sync tests */
+static skynet::Block MineTestBlock(const Hash256& prev, uint32_t difficultyTarget, std::vector<skynet::Transaction> transactions) {
+      skynet::BlockHeader header(1, prev, skynet::CalculateMerkleRoot(transactions), 1700000000, difficultyTarget, 0);
+      while (!skynet::MeetsDifficultyTarget(header.Hash(), difficultyTarget)) header.nonce++;
+      return skynet::Block(header, std::move(transactions));
+}
+
+/**
+ * A chain of length blocks, each holding a single coinbase transaction whose
+ * locktime is seed plus its height. It branches off base after its first blocks.
+ */
+static std::vector<skynet::Block> MakeTestChain(std::size_t length, const std::vector<skynet::Block>& base = {}, time_t seed = 0) {
+      std::vector<skynet::Block> chain(base.begin(), base.begin() + std::min(base.size(), length));
+      while (chain.size() < length) {
+            crypto::ecdsa::PublicKey recipient{};
+            skynet::Transaction coinbase(skynet::TransactionInput(), skynet::TransactionOutput(50, recipient));
+            coinbase.SetLocktime(seed + static_cast<time_t>(chain.size()));
+
+            const Hash256 prev = chain.empty() ? Hash256{} : chain.back().Hash();
+            chain.push_back(MineTestBlock(prev, chain.empty() ? 0 : 1, { coinbase }));
+      }
+      return chain;
+}
+
+
+/**
+ * Checks the canonical header layout (80 bytes, little endian integers,
+ * nonce last), the round trip and that the hash covers exactly those bytes.
+ */
+void BlockHeaderSerializationTest() {
+      const skynet::BlockHeader header = MakeTestHeader();
+      byte serialized[skynet::BlockHeader::SERIALIZED_SIZE];
+      header.Serialize(serialized);
+
+      const byte version[] = { 0x01, 0x00, 0x00, 0x00 };
+      const byte timestamp[] = { 0x00, 0x21, 0x43, 0x65 };
+      const byte nonce[] = { 0xef, 0xbe, 0xad, 0xde };
+      ASSERT_TRUE(memcmp(serialized, version, 4) == 0, "Version should be little endian at offset 0");
+      ASSERT_TRUE(memcmp(serialized + 4, header.prevHash.data(), 32) == 0, "Previous hash should be at offset 4");
+      ASSERT_TRUE(memcmp(serialized + 36, header.merkleRoot.data(), 32) == 0, "Merkle root should be at offset 36");
+      ASSERT_TRUE(memcmp(serialized + 68, timestamp, 4) == 0, "Timestamp should be little endian at offset 68");
+      ASSERT_EQUAL(int(serialized[72]), 20, "Difficulty target should be at offset 72");
+      ASSERT_TRUE(memcmp(serialized + skynet::BlockHeader::NONCE_OFFSET, nonce, 4) == 0, "Nonce should be the last field");
+
+      ASSERT_TRUE(skynet::BlockHeader::Deserialize(serialized) == header, "Header round trip failed");
+
+      Hash256 expected;
+      crypto::hashing::DoubleSHA256(serialized, sizeof(serialized), expected.data());
+      ASSERT_TRUE(header.Hash() == expected, "Header hash should be the double SHA-256 of its serialization");
+
+      skynet::BlockHeader copy = header;
+      copy.nonce++;
+      ASSERT_TRUE(copy.Hash() != header.Hash(), "Changing the nonce should change the hash");
+}
+
+/**
+ * Checks that the block hash is the (cached) header hash and that replacing
+ * the header invalidates it.
+ */
+void BlockHashTest() {
+      skynet::BlockHeader header = MakeTestHeader();
+      skynet::Block block(header, {});
+
+      const Hash256& hash = block.Hash();
+      ASSERT_TRUE(hash == header.Hash(), "Block hash should be the hash of its header");
+      ASSERT_TRUE(&block.Hash() == &hash, "Block hash should be cached");
+
+      skynet::Block same(header, {});
+      ASSERT_TRUE(block == same, "Blocks with the same header should be equal");
+
+      header.nonce++;
+      block.SetHeader(header);
+      ASSERT_TRUE(block.Hash() == header.Hash(), "Setting the header should invalidate the cached hash");
+      ASSERT_TRUE(block != same, "Blocks with different headers should differ");
+}
+
+/**
+ * Checks the leading zero bits difficulty rule.
+ */
+void DifficultyTargetTest() {
+      Hash256 hash{};
+      hash[2] = 0x10;   // 19 leading zero bits
+
+      ASSERT_TRUE(skynet::MeetsDifficultyTarget(hash, 0), "Every hash meets difficulty 0");
+      ASSERT_TRUE(skynet::MeetsDifficultyTarget(hash, 16), "Hash should meet difficulty 16");
+      ASSERT_TRUE(skynet::MeetsDifficultyTarget(hash, 19), "Hash should meet difficulty 19");
+      ASSERT_FALSE(skynet::MeetsDifficultyTarget(hash, 20), "Hash should not meet difficulty 20");
+      ASSERT_FALSE(skynet::MeetsDifficultyTarget(hash, 300), "No hash meets a difficulty above 256");
+}
+
+/**
+ * Checks the block index: lookups across table growth, nodes that don't
+ * move, and hashes that share the bytes the table is keyed on.
+ */
+void BlockIndexTest() {
+      skynet::BlockIndex index(4);
+      std::vector<Hash256> hashes(1000);
+      std::vector<skynet::BlockNode*> nodes;
+
+      for (std::size_t i = 0; i < hashes.size(); i++) {
+            hashes[i] = Hash256{};
+            /** Every other hash only differs in its first bytes, so their table keys collide */
+            const uint32_t seed = static_cast<uint32_t>(i / 2);
+            std::memcpy(hashes[i].data() + hashes[i].size() - sizeof(seed), &seed, sizeof(seed));
+            hashes[i][0] = static_cast<byte>(i % 2);
+
+            const auto [node, inserted] = index.Insert(hashes[i]);
+            ASSERT_TRUE(inserted, "A new hash should add a node");
+            node->height = static_cast<uint32_t>(i);
+            nodes.push_back(node);
+      }
+      ASSERT_EQUAL(index.Size(), hashes.size(), "Every hash should be indexed");
+
+      for (std::size_t i = 0; i < hashes.size(); i++) {
+            ASSERT_TRUE(index.Find(hashes[i]) == nodes[i], "Nodes should not move when the table grows");
+            ASSERT_EQUAL(index.Find(hashes[i])->height, static_cast<uint32_t>(i), "Lookups should find their own node");
+      }
+
+      const auto [node, inserted] = index.Insert(hashes[10]);
+      ASSERT_TRUE(!inserted && node == nodes[10], "Inserting a known hash should return its node");
+
+      Hash256 unknown{};
+      unknown[5] = 1;
+      ASSERT_NULL(index.Find(unknown), "Unknown hashes should not be found");
+
+      index.Clear();
+      ASSERT_NULL(index.Find(hashes[0]), "A cleared index should be empty");
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,672 @@
+/**
+ * @file   chain_test.hpp
+ * @author JoaoAJMatos
+ *
+ * @brief Block tree and chain selection unit tests
+ *
+ * @version 0.1
+ * @date 2023-11-17
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+
+/* Skynet Includes */
+#include <block.hpp>
+#include <blockchain.hpp>
+#include <coins.hpp>
+#include <consensus.hpp>
+#include <mempool.hpp>
+#include <orphan_pool.hpp>
+#include <validation.hpp>
+#include <crypto/ecdsa.hpp>
+#include <threading/threadpool.hpp>
+
+/* C++ Includes */
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* Local Includes */
+#include "unipp.hpp"
+
+
+/** The signing context and the key owning every output of the chain tests */
+static crypto::ecdsa::Context ChainContext() {
+      static crypto::ecdsa::Context context = secp256k1_context_create(SECP256K1_CONTEXT_NONE);
+      return context;
+}
+
+static crypto::ecdsa::KeyPair* ChainKey() {
+      static crypto::ecdsa::KeyPair key = [] {
+            crypto::ecdsa::KeyPair generated;
+            crypto::ecdsa::generate_key_pair(ChainContext(), &generated);
+            return generated;
+      }();
+      return &key;
+}
+
+/** A coinbase transaction paying value to the chain key */
+static skynet::Transaction MakeCoinbaseTransaction(int value, time_t seed) {
+      skynet::Transaction transaction(skynet::TransactionInput(), skynet::TransactionOutput(value, ChainKey()->public_key));
+      transaction.SetLocktime(seed);
+      return transaction;
+}
+
+/** A coinbase transaction paying the block subsidy to the chain key, that only differs from the others by its locktime */
+static skynet::Transaction MakeChainTransaction(time_t seed) {
+      return MakeCoinbaseTransaction(50, seed);
+}
+
+/** A transaction spending the output of prev, signed by the chain key */
+static skynet::Transaction MakeSpendingTransaction(const skynet::Transaction& prev, int value) {
+      skynet::TransactionInput input;
+      input.prevTransactionOutput = prev.Hash();
+      input.prevTransactionOutputIndex = 0;
+
+      skynet::Transaction transaction(input, skynet::TransactionOutput(value, ChainKey()->public_key));
+      transaction.Sign(ChainContext(), ChainKey());
+      return transaction;
+}
+
+/** A chain from the genesis block minting one of mints per block, as a block holds a single coinbase */
+static std::vector<skynet::Block> MakeMintingChain(const std::vector<skynet::Transaction>& mints) {
+      std::vector<skynet::Block> blocks;
+      for (const auto& mint : mints) blocks.push_back(MineTestBlock(blocks.empty() ? Hash256{} : blocks.back().Hash(), 0, { mint }));
+      return blocks;
+}
+
+/** Returns whether the output of a transaction is unspent in the main chain */
+static bool ChainHasCoin(const skynet::Chain& chain, const skynet::Transaction& transaction) {
+      skynet::Coin coin;
+      return chain.GetCoin({ transaction.Hash(), 0 }, coin);
+}
+
+/** Adds a block to a chain, returning whether it was rejected */
+static bool ChainRejects(skynet::Chain& chain, const skynet::Block& block) {
+      try { chain.AddBlock(block); } catch (const skynet::ChainException&) { return true; }
+      return false;
+}
+
+
+/**
+ * Checks that the chain follows the branch with the most work (not the
+ * longest one), reorganizing several blocks at once and sending the
+ * transactions of the old branch that can still be mined back to the
+ * mempool: not its coinbases, not the ones the new branch includes and
+ * not the ones spending coins only the old branch had.
+ */
+void ChainReorganizationTest() {
+      auto mempool = std::make_shared<skynet::MemPool>();
+      skynet::Chain chain(mempool);
+
+      const skynet::Transaction mint = MakeChainTransaction(0), a1_mint = MakeChainTransaction(1);
+      const skynet::Transaction shared = MakeSpendingTransaction(mint, 30);
+      const skynet::Transaction displaced = MakeSpendingTransaction(shared, 20), chained = MakeSpendingTransaction(displaced, 10);
+      const skynet::Transaction stranded = MakeSpendingTransaction(a1_mint, 40);
+
+      const skynet::Block genesis = MineTestBlock(Hash256{}, 0, { mint });
+      const skynet::Block a1 = MineTestBlock(genesis.Hash(), 1, { a1_mint, shared });
+      const skynet::Block a2 = MineTestBlock(a1.Hash(), 1, { MakeChainTransaction(2), displaced, stranded });
+      const skynet::Block a3 = MineTestBlock(a2.Hash(), 1, { MakeChainTransaction(3), chained });
+      const skynet::Block b1 = MineTestBlock(genesis.Hash(), 2, { MakeChainTransaction(4), shared });
+      const skynet::Block b2 = MineTestBlock(b1.Hash(), 2, { MakeChainTransaction(5) });
+      const skynet::Block c2 = MineTestBlock(b1.Hash(), 2, { MakeChainTransaction(6) });
+
+      for (const skynet::Block *block : { &genesis, &a1, &a2, &a3 }) chain.AddBlock(*block);
+      ASSERT_TRUE(chain.GetLastBlock() == a3, "Blocks extending the tip should be connected");
+
+      /** 1 + 4 does not beat 1 + 2 + 2 + 2 */
+      chain.AddBlock(b1);
+      ASSERT_TRUE(chain.GetLastBlock() == a3, "A branch with less work should not become the main chain");
+      ASSERT_NOT_NULL(chain.LookupBlock(b1.Hash()), "Side branches should stay in the block tree");
+      ASSERT_TRUE(!chain.IsInMainChain(*chain.LookupBlock(b1.Hash())), "Side branches should not be in the main chain");
+
+      /** 1 + 4 + 4 does */
+      chain.AddBlock(b2);
+      ASSERT_TRUE(chain.GetLastBlock() == b2, "The branch with the most work should become the main chain");
+      ASSERT_EQUAL(chain.Size(), std::size_t(3), "The shorter branch should replace the longer one");
+      ASSERT_TRUE(chain.GetBlockNode(1) == chain.LookupBlock(b1.Hash()), "The whole branch should be connected");
+      ASSERT_TRUE(!chain.IsInMainChain(*chain.LookupBlock(a3.Hash())), "The old branch should be disconnected");
+      ASSERT_TRUE(chain.GetTip()->chainWork == skynet::ChainWork::ForTarget(0) + skynet::ChainWork::ForTarget(2) + skynet::ChainWork::ForTarget(2), "The tip should carry the work of its chain");
+
+      /** displaced spends a coin of the new branch, chained a coin displaced creates */
+      const std::vector<skynet::Transaction> returned = mempool->GetTransactions();
+      ASSERT_EQUAL(returned.size(), std::size_t(2), "Only the transactions that can still be mined should go back to the mempool");
+      ASSERT_TRUE(returned[0] == displaced && returned[1] == chained, "Transactions should go back to the mempool in chain order");
+      ASSERT_TRUE(std::none_of(returned.begin(), returned.end(), [](const skynet::Transaction& transaction) { return transaction.IsCoinbase(); }), "Coinbases should not go back to the mempool");
+
+      /** Same work as the tip, the first block seen wins */
+      chain.AddBlock(c2);
+      ASSERT_TRUE(chain.GetLastBlock() == b2, "A branch with equal work should not replace the main chain");
+
+      ASSERT_TRUE(ChainRejects(chain, b2), "Known blocks should be rejected");
+}
+
+/**
+ * Checks that blocks arriving before their parent wait in the orphan
+ * pool and are connected in a cascade once the parent shows up, even
+ * when that takes the chain to another branch.
+ */
+void ChainOrphanTest() {
+      skynet::Chain chain;
+
+      const skynet::Block genesis = MineTestBlock(Hash256{}, 0, {});
+      const skynet::Block a1 = MineTestBlock(genesis.Hash(), 0, { MakeChainTransaction(1) });
+      const skynet::Block a2 = MineTestBlock(a1.Hash(), 0, { MakeChainTransaction(2) });
+      const skynet::Block a3 = MineTestBlock(a2.Hash(), 0, { MakeChainTransaction(3) });
+      const skynet::Block b1 = MineTestBlock(genesis.Hash(), 1, {});
+      const skynet::Block b2 = MineTestBlock(b1.Hash(), 1, {});
+      const skynet::Block b3 = MineTestBlock(b2.Hash(), 1, {});
+
+      chain.AddBlock(genesis);
+      chain.AddBlock(a3);
+      chain.AddBlock(a2);
+      ASSERT_EQUAL(chain.GetOrphans().Size(), std::size_t(2), "Blocks without their parent should wait in the orphan pool");
+      ASSERT_NULL(chain.LookupBlock(a3.Hash()), "Orphans should not be in the block tree");
+      ASSERT_TRUE(ChainRejects(chain, a3), "Orphans should count as known blocks");
+
+      chain.AddBlock(a1);
+      ASSERT_EQUAL(chain.GetOrphans().Size(), std::size_t(0), "Connecting the parent should take its descendants out of the pool");
+      ASSERT_TRUE(chain.GetLastBlock() == a3, "Every waiting descendant should be connected");
+      ASSERT_EQUAL(chain.Size(), std::size_t(4), "The cascade should extend the main chain");
+
+      /** A heavier branch delivered backwards */
+      chain.AddBlock(b3);
+      chain.AddBlock(b2);
+      ASSERT_TRUE(chain.GetLastBlock() == a3, "Orphans should not move the tip");
+      chain.AddBlock(b1);
+      ASSERT_TRUE(chain.GetLastBlock() == b3, "A cascade that overtakes the tip should reorganize the chain");
+      ASSERT_TRUE(!chain.IsInMainChain(*chain.LookupBlock(a1.Hash())), "The lighter branch should be disconnected");
+}
+
+/**
+ * Checks the orphan pool on its own: children found by parent, and
+ * eviction by age and by size.
+ */
+void OrphanPoolTest() {
+      const skynet::Block parent = MineTestBlock(Hash256{}, 0, {});
+      const auto first = std::make_shared<const skynet::Block>(MineTestBlock(parent.Hash(), 0, { MakeChainTransaction(1) }));
+      const auto second = std::make_shared<const skynet::Block>(MineTestBlock(parent.Hash(), 0, { MakeChainTransaction(2) }));
+      const auto third = std::make_shared<const skynet::Block>(MineTestBlock(first->Hash(), 0, {}));
+
+      skynet::OrphanPool pool(2, 60);
+      ASSERT_TRUE(pool.Add(first, 1000), "New orphans should be added");
+      ASSERT_TRUE(!pool.Add(first, 1000), "Orphans should only be added once");
+      ASSERT_TRUE(pool.Add(second, 1010), "Siblings should be added");
+
+      const auto children = pool.TakeChildren(parent.Hash());
+      ASSERT_EQUAL(children.size(), std::size_t(2), "Every child of the parent should be taken");
+      ASSERT_TRUE(children[0] == first && children[1] == second, "Children should come out oldest first");
+      ASSERT_EQUAL(pool.Size(), std::size_t(0), "Taken children should leave the pool");
+
+      /** A full pool evicts its oldest orphan */
+      pool.Add(first, 1000);
+      pool.Add(second, 1010);
+      pool.Add(third, 1020);
+      ASSERT_TRUE(!pool.Contains(first->Hash()) && pool.Contains(third->Hash()), "The oldest orphan should be evicted");
+      ASSERT_EQUAL(pool.TakeChildren(first->Hash()).size(), std::size_t(1), "Orphans should be found by parent after an eviction");
+
+      /** Orphans expire */
+      pool.Expire(1070);
+      ASSERT_EQUAL(pool.Size(), std::size_t(0), "Old orphans should expire");
+      ASSERT_EQUAL(pool.TakeChildren(parent.Hash()).size(), std::size_t(0), "Expired orphans should not be found by parent");
+}
+
+/**
+ * Checks that the block tree, the chain work and the main chain survive
+ * being reloaded from a block store after a reorganization.
+ */
+void ChainStoreReorganizationTest() {
+      const auto directory = (std::filesystem::temp_directory_path() / "skynet_chain_reorganization_test").string();
+      std::filesystem::remove_all(directory);
+
+      const skynet::Block genesis = MineTestBlock(Hash256{}, 0, {});
+      const skynet::Block a1 = MineTestBlock(genesis.Hash(), 0, { MakeChainTransaction(1) });
+      const skynet::Block a2 = MineTestBlock(a1.Hash(), 0, { MakeChainTransaction(2) });
+      const skynet::Block b1 = MineTestBlock(genesis.Hash(), 2, {});
+
+      {
+            skynet::Chain chain;
+            chain.AddBlock(genesis);
+            chain.SaveChain(directory);
+            for (const skynet::Block *block : { &a1, &a2, &b1 }) chain.AddBlock(*block);
+            ASSERT_TRUE(chain.GetLastBlock() == b1, "The heavier branch should win");
+      }
+
+      skynet::Chain chain;
+      chain.LoadChain(directory);
+      ASSERT_EQUAL(chain.Size(), std::size_t(2), "The reloaded main chain should end in the heavier branch");
+      ASSERT_TRUE(chain.GetLastBlock() == b1, "The reloaded tip should be read back");
+      ASSERT_TRUE(chain.GetTip()->chainWork == skynet::ChainWork::ForTarget(0) + skynet::ChainWork::ForTarget(2), "Chain work should be rebuilt from the stored headers");
+
+      const skynet::BlockNode *old_tip = chain.LookupBlock(a2.Hash());
+      ASSERT_NOT_NULL(old_tip, "Disconnected blocks should be reloaded into the block tree");
+      ASSERT_TRUE(old_tip->parent == chain.LookupBlock(a1.Hash()), "Parents should be linked when reloading");
+      ASSERT_TRUE(*chain.GetBlock(*old_tip) == a2, "Disconnected blocks should be read back from the store");
+
+      std::filesystem::remove_all(directory);
+}
+
+/**
+ * Checks that connecting blocks spends and creates coins, that a block
+ * spending a missing output is marked invalid without touching the
+ * chain, and that reorganizations restore the coins of the old branch.
+ */
+void ChainCoinsTest() {
+      skynet::Chain chain;
+
+      const skynet::Transaction mint = MakeChainTransaction(1);
+      const skynet::Transaction first = MakeSpendingTransaction(mint, 1);
+      const skynet::Transaction second = MakeSpendingTransaction(mint, 2);
+      const skynet::Transaction chained = MakeSpendingTransaction(second, 1);
+
+      const skynet::Block genesis = MineTestBlock(Hash256{}, 0, { mint });
+      const skynet::Block a1 = MineTestBlock(genesis.Hash(), 0, { first });
+      const skynet::Block a2 = MineTestBlock(a1.Hash(), 0, { second });
+      const skynet::Block b1 = MineTestBlock(genesis.Hash(), 1, { second, chained });
+      const skynet::Block c1 = MineTestBlock(genesis.Hash(), 2, { MakeSpendingTransaction(first, 1) });
+      const skynet::Block c2 = MineTestBlock(c1.Hash(), 2, {});
+      const skynet::Block a3 = MineTestBlock(a1.Hash(), 2, { MakeChainTransaction(2) });
+
+      chain.AddBlock(genesis);
+      chain.AddBlock(a1);
+      ASSERT_TRUE(!ChainHasCoin(chain, mint) && ChainHasCoin(chain, first), "Connecting a block should spend its inputs and add its outputs");
+
+      skynet::Coin coin;
+      ASSERT_TRUE(chain.GetCoin({ first.Hash(), 0 }, coin) && coin.height == 1 && !coin.coinbase, "Coins should know where they come from");
+
+      /** Double spend */
+      ASSERT_TRUE(ChainRejects(chain, a2), "A block spending a spent output should be rejected");
+      ASSERT_TRUE(chain.GetLastBlock() == a1, "An invalid block should leave the tip alone");
+      ASSERT_TRUE(chain.LookupBlock(a2.Hash())->invalid, "An invalid block should be marked as such");
+      ASSERT_TRUE(ChainRejects(chain, MineTestBlock(a2.Hash(), 0, {})), "Children of invalid blocks should be rejected");
+
+      /** A heavier branch spending the same output, with a spend of an output it creates */
+      chain.AddBlock(b1);
+      ASSERT_TRUE(chain.GetLastBlock() == b1, "The heavier branch should win");
+      ASSERT_TRUE(!ChainHasCoin(chain, first), "Outputs of the old branch should be gone");
+      ASSERT_TRUE(!ChainHasCoin(chain, second) && ChainHasCoin(chain, chained), "Outputs spent in their own block should be spent");
+
+      /** An even heavier branch that is invalid */
+      ASSERT_TRUE(ChainRejects(chain, c1), "A heavier branch spending a missing output should be rejected");
+      ASSERT_TRUE(chain.GetLastBlock() == b1 && ChainHasCoin(chain, chained), "A failed reorganization should change nothing");
+      ASSERT_TRUE(ChainRejects(chain, c2), "Extending an invalid branch should be rejected");
+
+      /** Back to the first branch */
+      chain.AddBlock(a3);
+      ASSERT_TRUE(chain.GetLastBlock() == a3, "The first branch should take over again");
+      ASSERT_TRUE(ChainHasCoin(chain, first) && !ChainHasCoin(chain, chained) && !ChainHasCoin(chain, mint), "Disconnecting should restore the spent coins");
+}
+
+/**
+ * Checks the value rules of connecting a block: outputs can't be negative
+ * or worth more than what they spend, and a block has at most one
+ * coinbase, first, paying at most the block subsidy plus the fees.
+ */
+void ChainValueTest() {
+      skynet::Chain chain;
+
+      const skynet::Transaction mint = MakeChainTransaction(0);
+      const skynet::Block genesis = MineTestBlock(Hash256{}, 0, { mint });
+      chain.AddBlock(genesis);
+
+      const skynet::Transaction spend = MakeSpendingTransaction(mint, 10);
+      ASSERT_TRUE(ChainRejects(chain, MineTestBlock(genesis.Hash(), 0, { MakeSpendingTransaction(mint, 51) })), "Spending more than the spent output should be rejected");
+      ASSERT_TRUE(ChainRejects(chain, MineTestBlock(genesis.Hash(), 0, { MakeSpendingTransaction(mint, -1) })), "Negative outputs should be rejected");
+      ASSERT_TRUE(ChainRejects(chain, MineTestBlock(genesis.Hash(), 0, { MakeCoinbaseTransaction(-1, 1) })), "Negative coinbase outputs should be rejected");
+
+      ASSERT_TRUE(ChainRejects(chain, MineTestBlock(genesis.Hash(), 0, { MakeChainTransaction(1), MakeChainTransaction(2) })), "Blocks with two coinbases should be rejected");
+      ASSERT_TRUE(ChainRejects(chain, MineTestBlock(genesis.Hash(), 0, { spend, MakeChainTransaction(1) })), "Coinbases after the first transaction should be rejected");
+
+      /** The subsidy is 50 and the spend leaves 40 in fees */
+      const int subsidy = skynet::consensus::GetBlockSubsidy(1);
+      ASSERT_TRUE(ChainRejects(chain, MineTestBlock(genesis.Hash(), 0, { MakeCoinbaseTransaction(subsidy + 41, 1), spend })), "Coinbases paying more than the subsidy and fees should be rejected");
+      ASSERT_TRUE(chain.GetLastBlock() == genesis && ChainHasCoin(chain, mint), "Rejected blocks should leave the chain alone");
+
+      const skynet::Transaction coinbase = MakeCoinbaseTransaction(subsidy + 40, 1);
+      chain.AddBlock(MineTestBlock(genesis.Hash(), 0, { coinbase, spend }));
+      ASSERT_EQUAL(chain.Size(), std::size_t(2), "Coinbases may claim the subsidy and the fees");
+      ASSERT_TRUE(ChainHasCoin(chain, coinbase) && ChainHasCoin(chain, spend), "The coinbase and the spend should be connected");
+}
+
+/**
+ * Checks that the UTXO set survives reloading the chain, whether the
+ * cache was written back before the last blocks or not.
+ */
+void ChainStoreCoinsTest() {
+      const auto directory = (std::filesystem::temp_directory_path() / "skynet_chain_coins_test").string();
+      std::filesystem::remove_all(directory);
+
+      const skynet::Transaction mint = MakeChainTransaction(1);
+      const skynet::Transaction first = MakeSpendingTransaction(mint, 1);
+      const skynet::Transaction second = MakeSpendingTransaction(mint, 2);
+
+      const skynet::Block genesis = MineTestBlock(Hash256{}, 0, { mint });
+      const skynet::Block a1 = MineTestBlock(genesis.Hash(), 0, { first });
+      const skynet::Block b1 = MineTestBlock(genesis.Hash(), 1, { second });
+      const skynet::Block a2 = MineTestBlock(a1.Hash(), 1, {});
+
+      {
+            skynet::Chain chain;
+            chain.AddBlock(genesis);
+            chain.SaveChain(directory);
+            chain.AddBlock(a1);
+      }
+
+      {
+            /** The cache was only written back with the genesis block */
+            skynet::Chain chain;
+            chain.LoadChain(directory);
+            ASSERT_TRUE(!ChainHasCoin(chain, mint) && ChainHasCoin(chain, first), "Blocks past the coins database should be replayed");
+
+            chain.SetCoinsCacheSize(0);
+            chain.AddBlock(b1);
+            ASSERT_TRUE(ChainHasCoin(chain, second) && !ChainHasCoin(chain, first), "A stored block should be disconnected with its undo data");
+      }
+
+      skynet::Chain chain;
+      chain.LoadChain(directory);
+      ASSERT_TRUE(chain.GetLastBlock() == b1 && ChainHasCoin(chain, second), "A written back UTXO set should be reloaded as is");
+
+      chain.AddBlock(a2);
+      ASSERT_TRUE(ChainHasCoin(chain, first) && !ChainHasCoin(chain, second), "Reloaded undo data should restore spent coins");
+
+      std::filesystem::remove_all(directory);
+}
+
+/**
+ * Checks exporting the UTXO set at an earlier height and at the tip,
+ * bootstrapping empty chains from the snapshots (in memory and backed
+ * by a store), extending and reloading them, and rejecting snapshots
+ * that don't match their commitment or headers.
+ */
+void ChainSnapshotTest() {
+      const auto directory = std::filesystem::temp_directory_path() / "skynet_chain_snapshot_test";
+      std::filesystem::remove_all(directory);
+      std::filesystem::create_directories(directory);
+      const std::string early = (directory / "early.dat").string(), tip = (directory / "tip.dat").string();
+
+      const skynet::Transaction mint = MakeChainTransaction(1), other = MakeChainTransaction(2);
+      const skynet::Transaction spend = MakeSpendingTransaction(mint, 1);
+      const skynet::Block genesis = MineTestBlock(Hash256{}, 0, { mint });
+      const skynet::Block b1 = MineTestBlock(genesis.Hash(), 0, { other });
+      const skynet::Block b2 = MineTestBlock(b1.Hash(), 0, { MakeChainTransaction(3), spend });
+      const skynet::Block b3 = MineTestBlock(b2.Hash(), 0, { MakeChainTransaction(4), MakeSpendingTransaction(other, 2) });
+      const std::vector<skynet::BlockHeader> headers{ genesis.GetHeader(), b1.GetHeader(), b2.GetHeader() };
+
+      skynet::Chain source;
+      for (const skynet::Block *block : { &genesis, &b1, &b2 }) source.AddBlock(*block);
+
+      const storage::UtxoSnapshotMetadata before = source.ExportSnapshot(early, 1);
+      const storage::UtxoSnapshotMetadata after = source.ExportSnapshot(tip, 2);
+      ASSERT_EQUAL(before.coinCount, uint64_t(2), "An earlier snapshot should hold the coins as of its block");
+      ASSERT_EQUAL(after.coinCount, uint64_t(3), "A tip snapshot should hold the current coins");
+      ASSERT_TRUE(before.commitment != after.commitment, "Different sets should have different commitments");
+      ASSERT_TRUE(ChainHasCoin(source, spend) && !ChainHasCoin(source, mint), "Exporting should leave the chain as it was");
+
+      /** A chain synced from the genesis block commits to the same set */
+      skynet::Chain replayed;
+      for (const skynet::Block *block : { &genesis, &b1 }) replayed.AddBlock(*block);
+      ASSERT_TRUE(replayed.ExportSnapshot((directory / "replayed.dat").string(), 1).commitment == before.commitment, "The same set should have the same commitment");
+
+      /** In memory */
+      skynet::Chain loaded;
+      loaded.LoadSnapshot(tip, headers, after.commitment);
+      ASSERT_EQUAL(loaded.Size(), std::size_t(3), "The header chain should become the main chain");
+      ASSERT_TRUE(loaded.GetTip()->hash == b2.Hash() && loaded.GetTip()->chainWork == source.GetTip()->chainWork, "The base block should be the tip");
+      ASSERT_TRUE(ChainHasCoin(loaded, spend) && !ChainHasCoin(loaded, mint), "The coins of the snapshot should be the UTXO set");
+      loaded.AddBlock(b3);
+      ASSERT_TRUE(loaded.GetLastBlock() == b3 && !ChainHasCoin(loaded, other), "Blocks should connect on top of the base block");
+
+      /** Backed by a store, then reloaded */
+      const std::string store = (directory / "store").string();
+      {
+            skynet::Chain chain;
+            chain.LoadChain(store);
+            chain.LoadSnapshot(tip, headers, after.commitment);
+            chain.AddBlock(b3);
+            chain.SaveChain(store);
+      }
+      skynet::Chain reloaded;
+      reloaded.LoadChain(store);
+      ASSERT_TRUE(reloaded.Size() == 4 && reloaded.GetLastBlock() == b3, "A bootstrapped chain should reload");
+      ASSERT_TRUE(ChainHasCoin(reloaded, spend) && !ChainHasCoin(reloaded, other), "Its UTXO set should reload");
+      ASSERT_NULL(reloaded.GetBlock(*reloaded.GetBlockNode(1)), "History below the base block has no block data");
+
+      /** Rejections */
+      skynet::Chain rejected;
+      bool threw = false;
+      try { rejected.LoadSnapshot(tip, headers, before.commitment); } catch (const skynet::ChainException&) { threw = true; }
+      ASSERT_TRUE(threw, "A snapshot that doesn't match the trusted commitment should be rejected");
+
+      threw = false;
+      try { rejected.LoadSnapshot(early, headers, before.commitment); } catch (const skynet::ChainException&) { threw = true; }
+      ASSERT_TRUE(threw, "Headers past the base block should be rejected");
+      ASSERT_EQUAL(rejected.Size(), std::size_t(0), "A rejected snapshot should leave the chain empty");
+
+      threw = false;
+      try { loaded.LoadSnapshot(tip, headers, after.commitment); } catch (const skynet::ChainException&) { threw = true; }
+      ASSERT_TRUE(threw, "Snapshots should only be loaded into empty chains");
+
+      std::filesystem::remove_all(directory);
+}
+
+/**
+ * Checks pruning a chain backed by a store: the oldest block files go
+ * once the target is exceeded, the blocks near the tip, the UTXO set and
+ * the block index stay, shallow reorganizations still work and the
+ * pruned chain reloads.
+ */
+void ChainPruneTest() {
+      const auto directory = (std::filesystem::temp_directory_path() / "skynet_chain_prune_test").string();
+      std::filesystem::remove_all(directory);
+
+      std::vector<skynet::Transaction> mints;
+      std::vector<skynet::Block> blocks{ MineTestBlock(Hash256{}, 0, { MakeChainTransaction(0) }) };
+      for (int i = 1; i < 30; i++) {
+            mints.push_back(MakeChainTransaction(i));
+            blocks.push_back(MineTestBlock(blocks.back().Hash(), 1, { mints.back() }));
+      }
+
+      skynet::Chain chain;
+      chain.SetBlockFileSize(1024);
+      chain.SaveChain(directory);
+      for (const auto& block : blocks) chain.AddBlock(block);
+
+      const auto block_files = [&]() {
+            std::size_t count = 0;
+            for (const auto& file : std::filesystem::directory_iterator(directory)) count += file.path().filename().string().rfind("blk", 0) == 0;
+            return count;
+      };
+      const std::size_t before = block_files();
+      ASSERT_TRUE(before > 3, "The blocks should be spread over several files");
+
+      chain.SetPruneTarget(1, 5);
+      ASSERT_EQUAL(block_files(), before, "The target should be in MB");
+
+      chain.SetPruneTargetBytes(1, 5);
+      ASSERT_TRUE(block_files() < before, "The oldest block files should be pruned");
+      ASSERT_NULL(chain.GetBlock(*chain.GetBlockNode(1)), "Pruned blocks should have no data");
+      for (std::size_t height = 24; height < 30; height++) {
+            ASSERT_NOT_NULL(chain.GetBlock(*chain.GetBlockNode(height)), "Blocks within the prune depth should be kept");
+      }
+      ASSERT_EQUAL(chain.Size(), std::size_t(30), "The block index should be kept");
+      ASSERT_TRUE(ChainHasCoin(chain, mints.front()), "The UTXO set should be kept");
+
+      /** A reorganization within the depth */
+      const skynet::Block fork1 = MineTestBlock(blocks[27].Hash(), 1, { MakeChainTransaction(100) });
+      const skynet::Block fork2 = MineTestBlock(fork1.Hash(), 1, {});
+      const skynet::Block fork3 = MineTestBlock(fork2.Hash(), 1, {});
+      for (const skynet::Block *block : { &fork1, &fork2, &fork3 }) chain.AddBlock(*block);
+      ASSERT_TRUE(chain.GetLastBlock() == fork3 && !ChainHasCoin(chain, mints.back()), "Reorganizations within the depth should work");
+
+      /** One deeper than what is kept */
+      skynet::Block deep = MineTestBlock(blocks[2].Hash(), 6, {});
+      ASSERT_TRUE(ChainRejects(chain, deep), "Reorganizations below the pruned blocks should fail");
+      ASSERT_TRUE(chain.GetLastBlock() == fork3, "A failed reorganization should leave the chain as it was");
+
+      /** The blocks the fork replaced get pruned too, extending them can't connect */
+      chain.SetPruneTargetBytes(1, 0);
+      ASSERT_NULL(chain.GetBlock(*chain.LookupBlock(blocks[29].Hash())), "Side branch blocks should be pruned");
+      const skynet::Block revived1 = MineTestBlock(blocks[29].Hash(), 1, {});
+      const skynet::Block revived2 = MineTestBlock(revived1.Hash(), 1, {});
+      chain.AddBlock(revived1);
+      ASSERT_TRUE(ChainRejects(chain, revived2), "Connecting a pruned side branch should fail");
+      ASSERT_TRUE(chain.GetLastBlock() == fork3, "A branch missing block data should leave the chain as it was");
+      chain.SaveChain(directory);
+
+      skynet::Chain reloaded;
+      reloaded.SetBlockFileSize(1024);
+      reloaded.LoadChain(directory);
+      ASSERT_TRUE(reloaded.GetLastBlock() == fork3, "A pruned chain should reload");
+      ASSERT_TRUE(ChainHasCoin(reloaded, mints.front()) && !ChainHasCoin(reloaded, mints.back()), "Its UTXO set should reload");
+
+      std::filesystem::remove_all(directory);
+}
+
+/**
+ * Checks the signature checks of a block on a thread pool: a block full
+ * of valid spends connects, a single bad signature or a spend by someone
+ * else than the owner gets the block rejected.
+ */
+void ChainSignatureTest() {
+      skynet::Chain chain;
+      chain.SetValidationThreads(4);
+
+      std::vector<skynet::Transaction> mints, spends;
+      for (int i = 0; i < 100; i++) mints.push_back(MakeChainTransaction(i));
+      for (const auto& mint : mints) spends.push_back(MakeSpendingTransaction(mint, 1));
+
+      const std::vector<skynet::Block> minting = MakeMintingChain(mints);
+      for (const auto& block : minting) chain.AddBlock(block);
+      const skynet::Block& funded = minting.back();
+
+      /** The last spend carries a signature that doesn't match it */
+      std::vector<skynet::Transaction> forged(spends.begin(), spends.end() - 1);
+      skynet::TransactionInput input = spends.back().GetInput();
+      input.signature[10] ^= 1;
+      forged.emplace_back(input, spends.back().GetOutput());
+      ASSERT_TRUE(ChainRejects(chain, MineTestBlock(funded.Hash(), 0, forged)), "A block with an invalid signature should be rejected");
+      ASSERT_TRUE(chain.GetLastBlock() == funded, "A rejected block should not be connected");
+
+      /** Another key spending the chain key's output */
+      crypto::ecdsa::KeyPair thief;
+      crypto::ecdsa::generate_key_pair(ChainContext(), &thief);
+      skynet::Transaction stolen(spends.front().GetInput(), spends.front().GetOutput());
+      stolen.Sign(ChainContext(), &thief);
+      ASSERT_TRUE(stolen.HasValidSignature(), "The thief's signature is valid on its own");
+      ASSERT_TRUE(ChainRejects(chain, MineTestBlock(funded.Hash(), 0, { stolen })), "Spending someone else's output should be rejected");
+
+      chain.AddBlock(MineTestBlock(funded.Hash(), 0, spends));
+      ASSERT_EQUAL(chain.Size(), minting.size() + 1, "A block of valid spends should connect");
+      ASSERT_TRUE(!ChainHasCoin(chain, mints[42]) && ChainHasCoin(chain, spends[42]), "Every spend should be applied");
+
+      /** Context free checks */
+      ASSERT_TRUE(ChainRejects(chain, MineTestBlock(chain.GetLastBlock().Hash(), 0, { spends[0], spends[0] })), "A block with duplicate transactions should be rejected");
+}
+
+/**
+ * Checks that ancestors of the assume-valid block skip their signature
+ * checks, found through a header chain or through the block tree, while
+ * their spends are still checked and its descendants are fully checked.
+ */
+void ChainAssumeValidTest() {
+      std::vector<skynet::Transaction> mints;
+      for (int i = 0; i < 3; i++) mints.push_back(MakeChainTransaction(i));
+
+      std::vector<skynet::Transaction> forged;
+      for (const auto& mint : mints) {
+            skynet::TransactionInput input = MakeSpendingTransaction(mint, 1).GetInput();
+            input.signature[10] ^= 1;
+            forged.emplace_back(input, skynet::TransactionOutput(1, ChainKey()->public_key));
+      }
+
+      const std::vector<skynet::Block> minting = MakeMintingChain(mints);
+      const skynet::Block& funded = minting.back();
+      const skynet::Block b1 = MineTestBlock(funded.Hash(), 0, { forged[0] });
+      const skynet::Block b2 = MineTestBlock(b1.Hash(), 0, { forged[1] });
+      const skynet::Block b3 = MineTestBlock(b2.Hash(), 0, { forged[2] });
+
+      /** Ancestors known from their headers */
+      skynet::Chain chain;
+      chain.SetAssumeValid(b2.Hash());
+      std::vector<skynet::BlockHeader> headers;
+      for (const skynet::Block *block : { &minting[0], &minting[1], &minting[2], &b1, &b2, &b3 }) headers.push_back(block->GetHeader());
+      ASSERT_EQUAL(chain.AddAssumeValidHeaders(headers), std::size_t(5), "Headers up to the assume-valid block should be marked");
+      for (const skynet::Block *block : { &minting[0], &minting[1], &minting[2], &b1, &b2 }) chain.AddBlock(*block);
+      ASSERT_TRUE(chain.GetLastBlock() == b2, "Ancestors of the assume-valid block should skip their signature checks");
+      ASSERT_EQUAL(chain.GetAssumedValidBlocks(), std::size_t(5), "Skipped blocks should be counted");
+      ASSERT_TRUE(ChainRejects(chain, b3), "Blocks past the assume-valid block should be fully checked");
+
+      /** Ancestors known from the block tree, the assume-valid block arriving first */
+      skynet::Chain tree;
+      tree.SetAssumeValid(b2.Hash());
+      for (const auto& block : minting) tree.AddBlock(block);
+      tree.AddBlock(b2);
+      tree.AddBlock(b1);
+      ASSERT_TRUE(tree.GetLastBlock() == b2, "Ancestors in the block tree should skip their signature checks");
+      ASSERT_EQUAL(tree.GetAssumedValidBlocks(), std::size_t(2), "Only the blocks connected after the assume-valid block is known should be skipped");
+
+      /** Spends are still checked */
+      const skynet::Block missing = MineTestBlock(minting[0].Hash(), 0, { MakeSpendingTransaction(MakeChainTransaction(99), 1) });
+      skynet::Chain spends;
+      spends.SetAssumeValid(missing.Hash());
+      spends.AddAssumeValidHeaders({ minting[0].GetHeader(), missing.GetHeader() });
+      spends.AddBlock(minting[0]);
+      ASSERT_TRUE(ChainRejects(spends, missing), "Ancestors of the assume-valid block should still spend existing outputs");
+
+      bool threw = false;
+      try { chain.AddAssumeValidHeaders({ minting[0].GetHeader(), b2.GetHeader() }); } catch (const skynet::ChainException&) { threw = true; }
+      ASSERT_TRUE(threw, "Header chains that are not linked should be rejected");
+}
+
+/**
+ * Checks the check queue on its own, on a thread pool and inline.
+ */
+void CheckQueueTest() {
+      threading::ThreadPool pool(4);
+      pool.Init();
+
+      std::vector<skynet::Transaction> spends;
+      for (int i = 0; i < 50; i++) spends.push_back(MakeSpendingTransaction(MakeChainTransaction(i), i));
+
+      const std::vector<const threading::ThreadPool*> runners { &pool, nullptr };
+      for (const threading::ThreadPool *runner : runners) {
+            skynet::CheckQueueControl valid(runner, 8);
+            for (const auto& spend : spends) valid.Add(&spend);
+            ASSERT_TRUE(valid.Wait(), "Valid signatures should pass");
+
+            skynet::TransactionInput input = spends[20].GetInput();
+            input.signature[0] ^= 1;
+            const skynet::Transaction forged(input, spends[20].GetOutput());
+
+            skynet::CheckQueueControl invalid(runner, 8);
+            for (std::size_t i = 0; i < spends.size(); i++) invalid.Add(i == 20 ? &forged : &spends[i]);
+            ASSERT_TRUE(!invalid.Wait(), "A single invalid signature should fail the whole queue");
+      }
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,300 @@
+/**
+ * @file   coins_test.hpp
+ * @author JoaoAJMatos
+ *
+ * @brief UTXO set unit tests
+ *
+ * @version 0.1
+ * @date 2023-11-19
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+
+/* Skynet Includes */
+#include <coins.hpp>
+#include <storage/coins_db.hpp>
+#include <storage/utxo_snapshot.hpp>
+
+/* C++ Includes */
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Local Includes */
+#include "unipp.hpp"
+
+
+/** An outpoint of a made up transaction */
+static skynet::OutPoint MakeOutPoint(byte seed, uint32_t index = 0) {
+      skynet::TransactionHash txid{};
+      txid[0] = seed;
+      txid[31] = seed;
+      return skynet::OutPoint(txid, index);
+}
+
+/** A coin holding the given value */
+static skynet::Coin MakeCoin(int value, uint32_t height, bool coinbase = false) {
+      skynet::TransactionOutput output;
+      output.value = value;
+      output.recipient[0] = 0x02;
+      return skynet::Coin(output, height, coinbase);
+}
+
+
+/**
+ * Checks the flags of a cache stacked on another: coins created and
+ * spent above never reach the view below, spends of coins from below
+ * do, and flushing empties the cache.
+ */
+void CoinsCacheTest() {
+      skynet::CoinsCache base;
+      skynet::CoinsCache cache(&base);
+      const skynet::OutPoint a = MakeOutPoint(1), b = MakeOutPoint(2), c = MakeOutPoint(3, 7);
+
+      cache.AddCoin(a, MakeCoin(10, 1), false);
+      cache.AddCoin(b, MakeCoin(20, 1), false);
+      ASSERT_TRUE(cache.HaveCoin(a) && cache.HaveCoin(b), "Added coins should be unspent");
+      ASSERT_TRUE(!base.HaveCoin(a), "Added coins should stay in the cache until it is flushed");
+
+      bool threw = false;
+      try { cache.AddCoin(a, MakeCoin(10, 1), false); } catch (const std::logic_error&) { threw = true; }
+      ASSERT_TRUE(threw, "Adding a coin over an unspent one should be rejected");
+
+      skynet::Coin spent;
+      ASSERT_TRUE(cache.SpendCoin(a, &spent), "Unspent coins should be spendable");
+      ASSERT_EQUAL(spent.output.value, 10, "Spending should hand back the spent coin");
+      ASSERT_TRUE(!cache.SpendCoin(a), "Coins should only be spent once");
+      ASSERT_EQUAL(cache.Size(), std::size_t(1), "A fresh coin spent in the cache should be forgotten");
+
+      cache.SetBestBlock(Hash256{ 1 });
+      cache.Flush();
+      ASSERT_EQUAL(cache.Size(), std::size_t(0), "Flushing should empty the cache");
+      ASSERT_TRUE(base.HaveCoin(b) && !base.HaveCoin(a), "Only the unspent coin should be written back");
+      ASSERT_TRUE(base.GetBestBlock() == Hash256{ 1 }, "The best block should be written back");
+      ASSERT_TRUE(cache.GetBestBlock() == Hash256{ 1 }, "An empty cache should report the best block below");
+
+      /** Coins from below */
+      skynet::Coin coin;
+      ASSERT_TRUE(cache.GetCoin(b, coin) && coin.output.value == 20, "Lookups should go through to the view below");
+      ASSERT_TRUE(cache.SpendCoin(b), "Coins from below should be spendable");
+      ASSERT_TRUE(!cache.HaveCoin(b) && base.HaveCoin(b), "The spend should stay in the cache until it is flushed");
+      ASSERT_TRUE(!cache.SpendCoin(c), "Missing coins should not be spendable");
+
+      /** A coinbase output overwriting an unspent one */
+      cache.AddCoin(c, MakeCoin(30, 2, true), false);
+      cache.AddCoin(c, MakeCoin(40, 3, true), true);
+      cache.Flush();
+      ASSERT_TRUE(!base.HaveCoin(b), "Spends should be written back");
+      ASSERT_TRUE(base.GetCoin(c, coin) && coin.output.value == 40 && coin.height == 3 && coin.coinbase, "The overwriting coin should win");
+
+      /** A cursor merging both: c is overwritten, b spent, d only cached, e only below */
+      const skynet::OutPoint d = MakeOutPoint(4), e = MakeOutPoint(5);
+      base.AddCoin(b, MakeCoin(20, 1), false);
+      base.AddCoin(e, MakeCoin(50, 1), false);
+      cache.SpendCoin(b);
+      cache.AddCoin(c, MakeCoin(41, 4, true), true);
+      cache.AddCoin(d, MakeCoin(60, 4), false);
+
+      std::vector<std::pair<skynet::OutPoint, int>> walked;
+      for (auto cursor = cache.Cursor(); cursor->Valid(); cursor->Next()) {
+            cursor->GetValue(coin);
+            walked.emplace_back(cursor->GetKey(), coin.output.value);
+      }
+      const std::vector<std::pair<skynet::OutPoint, int>> expected{ { c, 41 }, { d, 60 }, { e, 50 } };
+      ASSERT_TRUE(walked == expected, "The cursor should merge the cache over the view below, in order");
+}
+
+/**
+ * Checks the coins database: batches written from a cache, lookups
+ * after reopening, a batch cut short by a crash, and compaction.
+ */
+void CoinsDatabaseTest() {
+      const auto directory = (std::filesystem::temp_directory_path() / "skynet_coins_database_test").string();
+      std::filesystem::remove_all(directory);
+      const skynet::OutPoint a = MakeOutPoint(1), b = MakeOutPoint(2, 1), c = MakeOutPoint(3);
+
+      {
+            storage::CoinsDatabase database(directory);
+            database.Open();
+            ASSERT_EQUAL(database.Size(), std::size_t(0), "A new database should be empty");
+
+            skynet::CoinsCache cache(&database);
+            cache.AddCoin(a, MakeCoin(10, 1), false);
+            cache.AddCoin(b, MakeCoin(20, 300, true), false);
+            cache.AddCoin(c, MakeCoin(30, 1), false);
+            cache.SpendCoin(c);
+            cache.SetBestBlock(Hash256{ 1 });
+            cache.Flush();
+            ASSERT_EQUAL(database.Size(), std::size_t(2), "Coins spent in the cache should never be written");
+
+            cache.SpendCoin(a);
+            cache.SetBestBlock(Hash256{ 2 });
+            cache.Flush();
+            ASSERT_TRUE(!database.HaveCoin(a), "Spent coins should be erased");
+      }
+
+      /** A batch cut short: a PUT without its COMMIT */
+      const auto log_size = std::filesystem::file_size(directory + "/coins.dat");
+      {
+            std::ofstream log(directory + "/coins.dat", std::ios::binary | std::ios::app);
+            const char torn[] = { 1, 5, 5, 5 };
+            log.write(torn, sizeof(torn));
+      }
+
+      {
+            storage::CoinsDatabase database(directory);
+            database.Open();
+            ASSERT_EQUAL(std::filesystem::file_size(directory + "/coins.dat"), log_size, "The torn batch should be cut off the log");
+            ASSERT_EQUAL(database.Size(), std::size_t(1), "Reopened database should hold the committed coins");
+            ASSERT_TRUE(database.GetBestBlock() == Hash256{ 2 }, "The best block should survive reopening");
+
+            skynet::Coin coin;
+            ASSERT_TRUE(database.GetCoin(b, coin), "Committed coins should read back");
+            ASSERT_TRUE(coin.output.value == 20 && coin.height == 300 && coin.coinbase && coin.output.recipient[0] == 0x02, "Coins should read back whole");
+      }
+
+      /** Churn until the log is mostly garbage */
+      {
+            storage::CoinsDatabase database(directory, 256);
+            database.Open();
+            skynet::CoinsCache cache(&database);
+            for (int i = 0; i < 20; i++) {
+                  cache.AddCoin(a, MakeCoin(i, 1), false);
+                  cache.Flush();
+                  cache.SpendCoin(a);
+                  cache.Flush();
+            }
+            ASSERT_TRUE(std::filesystem::file_size(database.LogPath()) < 256, "The log should be compacted");
+
+            skynet::Coin coin;
+            ASSERT_TRUE(database.GetCoin(b, coin) && coin.output.value == 20, "Compaction should keep the live coins");
+      }
+
+      storage::CoinsDatabase database(directory);
+      database.Open();
+      ASSERT_TRUE(database.Size() == 1 && database.HaveCoin(b) && !database.HaveCoin(a), "A compacted log should reopen");
+      ASSERT_TRUE(database.GetBestBlock() == Hash256{ 2 }, "Compaction should keep the best block");
+
+      std::filesystem::remove_all(directory);
+}
+
+/**
+ * Checks a snapshot round trip over several chunks, its import into an
+ * empty coins database, and that corrupted or truncated snapshots are
+ * rejected without leaving anything behind.
+ */
+void UtxoSnapshotTest() {
+      const auto directory = std::filesystem::temp_directory_path() / "skynet_utxo_snapshot_test";
+      std::filesystem::remove_all(directory);
+      std::filesystem::create_directories(directory);
+      const std::string path = (directory / "snapshot.dat").string();
+
+      storage::UtxoSnapshotMetadata written;
+      {
+            storage::UtxoSnapshotWriter writer(path, Hash256{ 7 }, 42, 3);
+            for (byte i = 1; i <= 10; i++) writer.Add(MakeOutPoint(i, i), MakeCoin(i * 10, i, i == 1));
+
+            bool threw = false;
+            try { writer.Add(MakeOutPoint(1), MakeCoin(1, 1)); } catch (const storage::StorageException&) { threw = true; }
+            ASSERT_TRUE(threw, "Coins out of order should be rejected");
+
+            ASSERT_TRUE(!std::filesystem::exists(path), "An unfinished snapshot should not show up under its path");
+            written = writer.Finish();
+      }
+      ASSERT_EQUAL(written.coinCount, uint64_t(10), "Every coin should be counted");
+
+      {
+            storage::UtxoSnapshotReader reader(path);
+            ASSERT_TRUE(reader.GetMetadata().baseBlock == Hash256{ 7 } && reader.GetMetadata().height == 42, "The header should read back");
+            ASSERT_TRUE(reader.GetMetadata().commitment == written.commitment, "The footer should read back");
+
+            std::vector<std::pair<skynet::OutPoint, skynet::Coin>> chunk;
+            std::size_t chunks = 0, coins = 0;
+            while (reader.ReadChunk(chunk)) {
+                  chunks++;
+                  for (const auto& [outpoint, coin] : chunk) {
+                        coins++;
+                        ASSERT_TRUE(outpoint == MakeOutPoint(static_cast<byte>(coins), static_cast<uint32_t>(coins)), "Coins should read back in order");
+                        ASSERT_TRUE(coin.output.value == static_cast<int>(coins * 10) && coin.height == coins && coin.coinbase == (coins == 1), "Coins should read back whole");
+                  }
+            }
+            ASSERT_EQUAL(chunks, std::size_t(4), "Coins should be split in chunks");
+            ASSERT_EQUAL(coins, std::size_t(10), "Every coin should read back");
+      }
+
+      {
+            storage::UtxoSnapshotReader reader(path);
+            storage::CoinsDatabase database((directory / "chainstate").string());
+            database.Open();
+            database.Import(reader);
+      }
+
+      storage::CoinsDatabase database((directory / "chainstate").string());
+      database.Open();
+      skynet::Coin coin;
+      ASSERT_EQUAL(database.Size(), std::size_t(10), "Imported coins should be committed");
+      ASSERT_TRUE(database.GetBestBlock() == Hash256{ 7 }, "The base block should become the best block");
+      ASSERT_TRUE(database.GetCoin(MakeOutPoint(5, 5), coin) && coin.output.value == 50, "Imported coins should read back");
+      std::size_t walked = 0;
+      for (auto cursor = database.Cursor(); cursor->Valid(); cursor->Next()) {
+            walked++;
+            cursor->GetValue(coin);
+            ASSERT_TRUE(cursor->GetKey() == MakeOutPoint(static_cast<byte>(walked), static_cast<uint32_t>(walked)) && coin.output.value == static_cast<int>(walked * 10), "The cursor should walk the coins in order");
+      }
+      ASSERT_EQUAL(walked, std::size_t(10), "The cursor should walk every coin");
+
+      /** A flipped byte in the last chunk */
+      {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(-100, std::ios::end);
+            const char flipped = 0x55;
+            file.write(&flipped, 1);
+      }
+
+      storage::CoinsDatabase empty((directory / "empty").string());
+      empty.Open();
+      bool threw = false;
+      try {
+            storage::UtxoSnapshotReader reader(path);
+            empty.Import(reader);
+      } catch (const storage::StorageException&) { threw = true; }
+      ASSERT_TRUE(threw, "A corrupted snapshot should be rejected");
+      ASSERT_TRUE(empty.Size() == 0 && std::filesystem::file_size(empty.LogPath()) == 0, "A rejected import should leave the database empty");
+
+      std::filesystem::resize_file(path, std::filesystem::file_size(path) - 50);
+      threw = false;
+      try {
+            storage::UtxoSnapshotReader reader(path);
+            std::vector<std::pair<skynet::OutPoint, skynet::Coin>> chunk;
+            while (reader.ReadChunk(chunk)) {}
+      } catch (const storage::StorageException&) { threw = true; }
+      ASSERT_TRUE(threw, "A truncated snapshot should be rejected");
+
+      std::filesystem::remove_all(directory);
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
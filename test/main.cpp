@@ -15,6 +15,14 @@
 
 /* Test Imports */
 #include "sha256_test.hpp"
+#include "merkle_test.hpp"
+#include "block_test.hpp"
+#include "serialize_test.hpp"
+#include "storage_test.hpp"
+#include "chain_test.hpp"
+#include "coins_test.hpp"
+#include "sync_test.hpp"
+#include "rpc_test.hpp"
 #include "ecdsa_test.hpp"
 #include "io_test.hpp"
 
@@ -33,8 +41,68 @@ int main(void) {
       RUN(
             SUITE("Cryptography Interface", "Tests Skynet's cryptography interface",
                   TEST("Sha-256 Test", "Tests the SHA256 hash function", HashTest),
+                  TEST("Sha-256 Streaming", "Tests the incremental SHA256 interface", HashStreamingTest),
+                  TEST("Sha-256 Midstate", "Tests hashing through a cached midstate and the double SHA256 helpers", HashMidstateTest),
+                  TEST("Sha-256 Files", "Tests hashing files from disk, sequentially and on a thread pool", HashFileTest),
+                  TEST("Sha-256 Backends", "Tests every supported SHA256 backend against the reference vectors", HashBackendTest),
+                  TEST("Sha-256 Batch", "Tests hashing batches of messages with every supported SHA256 backend", HashManyTest),
                   TEST("ECDSA Test", "Tests the ECDSA signature algorithm", EcdsaTest)
             ),
+            SUITE("Merkle Tree", "Tests Skynet's Merkle Tree construction",
+                  TEST("Merkle Root", "Tests the Merkle root against a reference construction", MerkleRootTest),
+                  TEST("Merkle In Place", "Tests the in place root computation and its edge cases", MerkleComputeRootTest),
+                  TEST("Merkle Parallel", "Tests building large trees on a thread pool", MerkleParallelTest),
+                  TEST("Merkle Branch", "Tests proving single leaves with their audit path", MerkleBranchTest),
+                  TEST("Merkle Multi Proof", "Tests proving several leaves with a single compact proof", MerkleMultiProofTest),
+                  TEST("Merkle Accumulator", "Tests the append only Merkle accumulator", MerkleAccumulatorTest),
+                  TEST("Merkle Coinbase Accumulator", "Tests replacing the coinbase of a Merkle accumulator", MerkleCoinbaseAccumulatorTest)
+            ),
+            SUITE("Blocks", "Tests Skynet's block structures",
+                  TEST("Header Serialization", "Tests the canonical 80 byte block header serialization", BlockHeaderSerializationTest),
+                  TEST("Block Hash", "Tests the cached, header only block hash", BlockHashTest),
+                  TEST("Block Index", "Tests looking blocks up by hash in the block index", BlockIndexTest),
+                  TEST("Difficulty Target", "Tests checking block hashes against a difficulty target", DifficultyTargetTest)
+            ),
+            SUITE("Serialization", "Tests Skynet's binary serialization",
+                  TEST("Integers", "Tests fixed width integers and CompactSize lengths", SerializeIntegersTest),
+                  TEST("Containers", "Tests byte vectors, strings and hashes", SerializeContainersTest),
+                  TEST("Blocks", "Tests the transaction and block round trips", SerializeBlockTest),
+                  TEST("Transaction Hash", "Tests that the cached TXID follows every change to a transaction", SerializeTransactionHashTest),
+                  TEST("Views", "Tests reading serialized blocks in place", SerializeViewTest)
+            ),
+            SUITE("Storage", "Tests Skynet's block storage",
+                  TEST("Block Store", "Tests the append only block files and their index", BlockStoreTest),
+                  TEST("Block File Reader", "Tests reading blocks in place from mapped block files", BlockFileReaderTest),
+                  TEST("Pruning", "Tests deleting block files while keeping their blocks indexed", BlockStorePruneTest),
+                  TEST("Index Compaction", "Tests rewriting the index log with only its live records", BlockStoreIndexCompactionTest)
+            ),
+            SUITE("Chain", "Tests Skynet's block tree and chain selection",
+                  TEST("Reorganization", "Tests following the branch with the most work", ChainReorganizationTest),
+                  TEST("Stored Reorganization", "Tests reloading the block tree after a reorganization", ChainStoreReorganizationTest),
+                  TEST("Orphan Blocks", "Tests connecting blocks that arrive before their parent", ChainOrphanTest),
+                  TEST("Orphan Pool", "Tests the orphan pool lookups and eviction", OrphanPoolTest),
+                  TEST("Coins", "Tests spending and restoring coins as blocks are connected and disconnected", ChainCoinsTest),
+                  TEST("Value Rules", "Tests rejecting blocks that create coins out of nothing or misplace their coinbase", ChainValueTest),
+                  TEST("Stored Coins", "Tests reloading the UTXO set with the chain", ChainStoreCoinsTest),
+                  TEST("Snapshots", "Tests exporting the UTXO set and bootstrapping chains from it", ChainSnapshotTest),
+                  TEST("Pruning", "Tests deleting old block files while keeping the chain working", ChainPruneTest),
+                  TEST("Signatures", "Tests verifying the signatures of a block on a thread pool", ChainSignatureTest),
+                  TEST("Assume Valid", "Tests skipping the signature checks of the ancestors of the assume-valid block", ChainAssumeValidTest),
+                  TEST("Check Queue", "Tests the fail fast signature check queue", CheckQueueTest)
+            ),
+            SUITE("Coins", "Tests Skynet's UTXO set",
+                  TEST("Coins Cache", "Tests the fresh and dirty flags of the write-back cache", CoinsCacheTest),
+                  TEST("Coins Database", "Tests the on disk UTXO log", CoinsDatabaseTest),
+                  TEST("UTXO Snapshots", "Tests the chunked, hashed snapshot files and their import", UtxoSnapshotTest)
+            ),
+            SUITE("Sync", "Tests Skynet's initial block download",
+                  TEST("Block Sync", "Tests downloading the header chain, then its blocks from several peers", BlockSyncTest),
+                  TEST("Rejected Chains", "Tests ending the sync on invalid header chains and blocks", BlockSyncRejectTest)
+            ),
+            SUITE("RPC", "Tests Skynet's JSON-RPC methods",
+                  TEST("Full Node Methods", "Tests fetching blocks and proving their transactions over JSON-RPC", RpcFullNodeMethodsTest),
+                  TEST("Node Types", "Tests which methods each node type registers", RpcNodeTypesTest)
+            ),
             SUITE("Input/Output Interface", "Tests Skynet's I/O interface",
                   TEST("Write to file", "Tests the filesystem interface for writing to files", WriteFileTest),
                   TEST("Read from file", "Tests the filesystem interface for reading from files", ReadFileTest),
@@ -0,0 +1,276 @@
+/**
+ * @file   merkle_test.hpp
+ * @author JoaoAJMatos
+ *
+ * @brief Merkle Tree unit tests
+ *
+ * @version 0.1
+ * @date 2023-11-06
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+
+/* Skynet Includes */
+#include <merkle_tree.hpp>
+#include <crypto/sha256.hpp>
+#include <threading/threadpool.hpp>
+
+/* C++ Includes */
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* Local Includes */
+#include "unipp.hpp"
+
+
+using MerkleNode = std::array<byte, skynet::MERKLE_NODE_SIZE>;
+
+/** Deterministic leaf hashes for the tests */
+static std::vector<MerkleNode> MakeMerkleLeaves(std::size_t count) {
+      std::vector<MerkleNode> leaves(count);
+      for (std::size_t i = 0; i < count; i++) {
+            std::string seed = "leaf " + std::to_string(i);
+            crypto::hashing::SHA256(reinterpret_cast<const byte *>(seed.data()), seed.size(), leaves[i].data());
+      }
+      return leaves;
+}
+
+/** Straightforward reference root: hash pairs into a new level, duplicating the odd node out */
+static MerkleNode ReferenceMerkleRoot(std::vector<MerkleNode> level) {
+      if (level.empty()) return MerkleNode{};
+
+      while (level.size() > 1) {
+            if (level.size() % 2 != 0) level.push_back(level.back());
+
+            std::vector<MerkleNode> parents(level.size() / 2);
+            for (std::size_t i = 0; i < parents.size(); i++) {
+                  byte pair[2 * skynet::MERKLE_NODE_SIZE];
+                  memcpy(pair, level[2 * i].data(), skynet::MERKLE_NODE_SIZE);
+                  memcpy(pair + skynet::MERKLE_NODE_SIZE, level[2 * i + 1].data(), skynet::MERKLE_NODE_SIZE);
+                  crypto::hashing::SHA256(pair, sizeof(pair), parents[i].data());
+            }
+            level = std::move(parents);
+      }
+      return level[0];
+}
+
+
+/**
+ * Builds trees of every size up to 100 leaves (plus a few larger ones)
+ * and compares their roots against the reference construction.
+ */
+void MerkleRootTest() {
+      std::vector<std::size_t> sizes;
+      for (std::size_t i = 0; i <= 100; i++) sizes.push_back(i);
+      sizes.insert(sizes.end(), { 255, 256, 257, 1000, 1023, 4097 });
+
+      for (std::size_t count : sizes) {
+            auto leaves = MakeMerkleLeaves(count);
+            MerkleNode expected = ReferenceMerkleRoot(leaves);
+
+            skynet::MerkleTree tree(count);
+            for (std::size_t i = 0; i < count; i++) {
+                  memcpy(tree.Leaf(i), leaves[i].data(), skynet::MERKLE_NODE_SIZE);
+            }
+            tree.Build();
+
+            ASSERT_EQUAL(tree.LeafCount(), count, "Wrong leaf count");
+            ASSERT_TRUE(memcmp(tree.Root(), expected.data(), skynet::MERKLE_NODE_SIZE) == 0, "Wrong root for " + std::to_string(count) + " leaves");
+      }
+}
+
+/**
+ * Checks the in place reduction and the special cases: a single leaf
+ * is its own root, and two identical leaves give the same root as
+ * one leaf duplicated by the odd node rule.
+ */
+void MerkleComputeRootTest() {
+      auto leaves = MakeMerkleLeaves(3);
+      MerkleNode root;
+
+      skynet::MerkleTree::ComputeRoot(leaves[0].data(), 1, root.data());
+      ASSERT_TRUE(root == MakeMerkleLeaves(1)[0], "A single leaf should be the root");
+
+      std::vector<MerkleNode> odd = MakeMerkleLeaves(3);
+      std::vector<MerkleNode> even = { odd[0], odd[1], odd[2], odd[2] };
+      MerkleNode odd_root, even_root;
+      skynet::MerkleTree::ComputeRoot(odd[0].data(), odd.size(), odd_root.data());
+      skynet::MerkleTree::ComputeRoot(even[0].data(), even.size(), even_root.data());
+      ASSERT_TRUE(odd_root == even_root, "The odd node out should be paired with itself");
+
+      skynet::MerkleTree::ComputeRoot(nullptr, 0, root.data());
+      ASSERT_TRUE(root == MerkleNode{}, "An empty tree should have an all zero root");
+}
+
+/**
+ * Builds large trees on a thread pool and checks that splitting them
+ * into subtrees gives the same root as the single threaded build.
+ */
+void MerkleParallelTest() {
+      threading::ThreadPool pool(4);
+      pool.Init();
+
+      for (std::size_t count : { std::size_t(10), skynet::MERKLE_PARALLEL_THRESHOLD, std::size_t(5000), std::size_t(16384), std::size_t(65539) }) {
+            auto leaves = MakeMerkleLeaves(count);
+            auto copy = leaves;
+            MerkleNode expected, root;
+
+            skynet::MerkleTree::ComputeRoot(leaves[0].data(), count, expected.data());
+            skynet::MerkleTree::ComputeRoot(copy[0].data(), count, root.data(), pool);
+
+            ASSERT_TRUE(root == expected, "Parallel root mismatch for " + std::to_string(count) + " leaves");
+      }
+
+      pool.Stop(true);
+}
+
+/**
+ * Proves every leaf of trees of several sizes with its branch, and
+ * checks that tampered branches are rejected.
+ */
+void MerkleBranchTest() {
+      for (std::size_t count : { 1, 2, 3, 5, 8, 13, 100 }) {
+            auto leaves = MakeMerkleLeaves(count);
+            MerkleNode root = ReferenceMerkleRoot(leaves);
+
+            for (std::size_t i = 0; i < count; i++) {
+                  skynet::MerkleBranch branch = skynet::MerkleTree::GetBranch(leaves[0].data(), count, i);
+                  ASSERT_TRUE(skynet::MerkleTree::VerifyBranch(leaves[i].data(), branch, root.data()),
+                              "Branch of leaf " + std::to_string(i) + " of " + std::to_string(count) + " should verify");
+
+                  /** The branch must not prove another leaf, or the same leaf at another position */
+                  const std::size_t other = (i + 1) % count;
+                  if (other != i) {
+                        ASSERT_FALSE(skynet::MerkleTree::VerifyBranch(leaves[other].data(), branch, root.data()), "Branch proved the wrong leaf");
+                        branch.index = static_cast<uint32_t>(other);
+                        ASSERT_FALSE(skynet::MerkleTree::VerifyBranch(leaves[i].data(), branch, root.data()), "Branch proved the wrong position");
+                  }
+            }
+      }
+
+      auto leaves = MakeMerkleLeaves(4);
+      skynet::MerkleBranch branch = skynet::MerkleTree::GetBranch(leaves[0].data(), 4, 0);
+      branch.hashes.pop_back();
+      ASSERT_FALSE(skynet::MerkleTree::VerifyBranch(leaves[0].data(), branch, ReferenceMerkleRoot(leaves).data()), "Short branch should be rejected");
+}
+
+/**
+ * Proves several subsets of leaves with a single multi proof and checks
+ * the recovered leaves, the proof size and that tampering is detected.
+ */
+void MerkleMultiProofTest() {
+      const std::size_t count = 37;
+      auto leaves = MakeMerkleLeaves(count);
+      MerkleNode root = ReferenceMerkleRoot(leaves);
+
+      const std::vector<std::vector<uint32_t>> subsets = { { 0 }, { 36 }, { 3, 4 }, { 35, 1, 17 }, { 0, 1, 2, 3, 4, 5, 6, 7 } };
+      for (const auto &subset : subsets) {
+            skynet::MerkleMultiProof proof = skynet::MerkleTree::GetMultiProof(leaves[0].data(), count, subset);
+
+            std::vector<skynet::MerkleLeaf> proven;
+            ASSERT_TRUE(skynet::MerkleTree::VerifyMultiProof(proof, root.data(), proven), "Multi proof should verify");
+            ASSERT_EQUAL(proven.size(), subset.size(), "Wrong number of proven leaves");
+            for (const auto &leaf : proven) {
+                  ASSERT_TRUE(leaf.hash == leaves[leaf.index], "Proven leaf does not match the tree");
+            }
+
+            /** Never more hashes than a branch per leaf */
+            ASSERT_LESS_EQUAL(proof.hashes.size(), subset.size() * 7, "Multi proof is larger than separate branches");
+
+            MerkleNode wrong_root = root;
+            wrong_root[0] ^= 1;
+            ASSERT_FALSE(skynet::MerkleTree::VerifyMultiProof(proof, wrong_root.data(), proven), "Multi proof verified against the wrong root");
+
+            proof.hashes.back()[0] ^= 1;
+            ASSERT_FALSE(skynet::MerkleTree::VerifyMultiProof(proof, root.data(), proven), "Tampered multi proof should be rejected");
+            proof.hashes.back()[0] ^= 1;
+
+            proof.flags.push_back(0);
+            ASSERT_FALSE(skynet::MerkleTree::VerifyMultiProof(proof, root.data(), proven), "Multi proof with unused flags should be rejected");
+      }
+
+      bool threw = false;
+      try { skynet::MerkleTree::GetMultiProof(leaves[0].data(), count, {}); } catch (const std::invalid_argument&) { threw = true; }
+      ASSERT_TRUE(threw, "A proof of no leaves should be rejected");
+
+      threw = false;
+      try { skynet::MerkleTree::GetMultiProof(nullptr, 0, { 0 }); } catch (const std::out_of_range&) { threw = true; }
+      ASSERT_TRUE(threw, "An empty tree has no leaves to prove");
+}
+
+/**
+ * Appends leaves one by one and checks the accumulator root against
+ * the reference construction after every append.
+ */
+void MerkleAccumulatorTest() {
+      auto leaves = MakeMerkleLeaves(300);
+      skynet::MerkleAccumulator accumulator;
+      MerkleNode root;
+
+      accumulator.Root(root.data());
+      ASSERT_TRUE(root == MerkleNode{}, "An empty accumulator should have an all zero root");
+
+      for (std::size_t i = 0; i < leaves.size(); i++) {
+            accumulator.Append(leaves[i].data());
+            accumulator.Root(root.data());
+
+            std::vector<MerkleNode> prefix(leaves.begin(), leaves.begin() + i + 1);
+            ASSERT_TRUE(root == ReferenceMerkleRoot(prefix), "Wrong accumulator root for " + std::to_string(i + 1) + " leaves");
+      }
+}
+
+/**
+ * Rolls the coinbase of accumulators of several sizes, interleaved
+ * with appends, and checks the roots against the reference construction.
+ */
+void MerkleCoinbaseAccumulatorTest() {
+      auto leaves = MakeMerkleLeaves(130);
+      auto coinbases = MakeMerkleLeaves(140);
+      skynet::CoinbaseMerkleAccumulator accumulator;
+      MerkleNode root;
+
+      for (std::size_t i = 0; i < leaves.size(); i++) {
+            accumulator.Append(leaves[i].data());
+
+            /** Roll the coinbase a few times */
+            std::vector<MerkleNode> prefix(leaves.begin(), leaves.begin() + i + 1);
+            for (std::size_t roll = 130; roll < coinbases.size(); roll += 3) {
+                  accumulator.ReplaceCoinbase(coinbases[roll].data());
+                  accumulator.Root(root.data());
+                  prefix[0] = coinbases[roll];
+                  ASSERT_TRUE(root == ReferenceMerkleRoot(prefix), "Wrong root after replacing the coinbase of " + std::to_string(i + 1) + " leaves");
+            }
+
+            /** Put the original coinbase back so later appends build on it */
+            accumulator.ReplaceCoinbase(leaves[0].data());
+      }
+
+      accumulator.Root(root.data());
+      ASSERT_TRUE(root == ReferenceMerkleRoot(leaves), "Wrong root after restoring the coinbase");
+}
+
+// MIT License
+// 
+// Copyright (c) 2023 João Matos
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,134 @@
+/**
+ * @file   rpc_test.hpp
+ * @author JoaoAJMatos
+ *
+ * @brief JSON-RPC methods unit tests
+ *
+ * @version 0.1
+ * @date 2023-11-08
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+
+/* Skynet Includes */
+#include <block.hpp>
+#include <blockchain.hpp>
+#include <merkle_tree.hpp>
+#include <rpc/json_rpc.hpp>
+#include <rpc/methods.hpp>
+
+/* C++ Includes */
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* Local Includes */
+#include "unipp.hpp"
+
+
+/** Sends a request with named parameters to a server and parses the response */
+static rpc::json CallRpc(rpc::JsonRpcServer& server, const std::string& method, const rpc::json& params) {
+      const rpc::json request{ { "jsonrpc", "2.0" }, { "id", 1 }, { "method", method }, { "params", params } };
+      return rpc::json::parse(server.HandleRequest(request.dump()));
+}
+
+/** Returns the error code of a response, 0 if it succeeded */
+static int RpcErrorCode(const rpc::json& response) {
+      return response.contains("error") ? response["error"]["code"].get<int>() : 0;
+}
+
+/** The hex encoding of a hash */
+static std::string HashToHex(const Hash256& hash) {
+      return rpc::ToHex(hash.data(), hash.size());
+}
+
+
+/**
+ * Checks the methods a full node registers: fetching main chain blocks by
+ * hash and by height, and proving transactions of a block with a proof
+ * that verifies against its header. Unknown blocks, transactions and
+ * empty requests are rejected.
+ */
+void RpcFullNodeMethodsTest() {
+      const skynet::Transaction mint0 = MakeChainTransaction(0), mint1 = MakeChainTransaction(1);
+      const skynet::Transaction spend0 = MakeSpendingTransaction(mint0, 10), spend1 = MakeSpendingTransaction(mint1, 20);
+      const skynet::Block genesis = MineTestBlock(Hash256{}, 0, { mint0 });
+      const skynet::Block b1 = MineTestBlock(genesis.Hash(), 0, { mint1 });
+      const skynet::Block b2 = MineTestBlock(b1.Hash(), 0, { MakeChainTransaction(2), spend0, spend1 });
+
+      auto chain = std::make_shared<skynet::Chain>();
+      for (const skynet::Block *block : { &genesis, &b1, &b2 }) chain->AddBlock(*block);
+
+      rpc::JsonRpc2Server server;
+      rpc::RegisterNodeMethods(server, chain, "full");
+
+      rpc::json response = CallRpc(server, "get_block_by_height", { { "height", 1 } });
+      ASSERT_TRUE(RpcErrorCode(response) == 0 && response["result"]["hash"] == HashToHex(b1.Hash()), "Blocks should be fetched by height");
+
+      response = CallRpc(server, "get_block", { { "hash", HashToHex(b2.Hash()) } });
+      ASSERT_TRUE(RpcErrorCode(response) == 0 && response["result"]["height"] == 2, "Blocks should be fetched by hash");
+      ASSERT_TRUE(response["result"]["transactions"].size() == 3 && response["result"]["transactions"][1] == HashToHex(spend0.Hash()), "Blocks should list their transactions");
+      ASSERT_TRUE(response["result"]["merkle_root"] == HashToHex(b2.GetHeader().merkleRoot), "Blocks should carry their header");
+
+      ASSERT_EQUAL(RpcErrorCode(CallRpc(server, "get_block", { { "hash", HashToHex(Hash256{ 1 }) } })), int(rpc::error_type::INVALID_PARAMS), "Unknown blocks should be rejected");
+      ASSERT_EQUAL(RpcErrorCode(CallRpc(server, "get_block_by_height", { { "height", 3 } })), int(rpc::error_type::INVALID_PARAMS), "Heights past the tip should be rejected");
+      ASSERT_EQUAL(RpcErrorCode(CallRpc(server, "get_block", { { "hash", "xyz" } })), int(rpc::error_type::INVALID_PARAMS), "Malformed hashes should be rejected");
+
+      /** A light node checks the proof against the header it trusts */
+      response = CallRpc(server, "get_merkle_proof", { { "block", HashToHex(b2.Hash()) }, { "transactions", { HashToHex(spend1.Hash()), HashToHex(spend0.Hash()) } } });
+      ASSERT_EQUAL(RpcErrorCode(response), 0, "Transactions of a block should be provable");
+      ASSERT_TRUE(response["result"]["merkle_root"] == HashToHex(b2.GetHeader().merkleRoot), "The proof should name the Merkle root it proves against");
+
+      std::vector<skynet::MerkleLeaf> proven;
+      const skynet::MerkleMultiProof proof = rpc::MerkleProofFromJson(response["result"]);
+      ASSERT_TRUE(skynet::MerkleTree::VerifyMultiProof(proof, b2.GetHeader().merkleRoot.data(), proven), "The proof should verify against the header");
+      ASSERT_TRUE(proven.size() == 2 && proven[0].index == 1 && proven[1].index == 2, "The proof should prove the asked transactions");
+      ASSERT_TRUE(proven[0].hash == spend0.Hash() && proven[1].hash == spend1.Hash(), "The proven leaves should be the transaction hashes");
+
+      ASSERT_EQUAL(RpcErrorCode(CallRpc(server, "get_merkle_proof", { { "block", HashToHex(b2.Hash()) }, { "transactions", rpc::json::array() } })), int(rpc::error_type::INVALID_PARAMS), "Empty proof requests should be rejected");
+      ASSERT_EQUAL(RpcErrorCode(CallRpc(server, "get_merkle_proof", { { "block", HashToHex(b2.Hash()) }, { "transactions", { HashToHex(mint0.Hash()) } } })), int(rpc::error_type::INVALID_PARAMS), "Transactions of other blocks should be rejected");
+}
+
+/**
+ * Checks that light and miner nodes don't expose the block methods, and
+ * that unknown node types are rejected.
+ */
+void RpcNodeTypesTest() {
+      auto chain = std::make_shared<skynet::Chain>();
+
+      for (const std::string type : { "light", "miner" }) {
+            rpc::JsonRpc2Server server;
+            rpc::RegisterNodeMethods(server, chain, type);
+            ASSERT_EQUAL(RpcErrorCode(CallRpc(server, "get_block_by_height", { { "height", 0 } })), int(rpc::error_type::METHOD_NOT_FOUND), "Only full nodes should serve blocks");
+            ASSERT_EQUAL(RpcErrorCode(CallRpc(server, "get_merkle_proof", { { "block", HashToHex(Hash256{}) }, { "transactions", rpc::json::array() } })), int(rpc::error_type::METHOD_NOT_FOUND), "Only full nodes should serve proofs");
+      }
+
+      rpc::JsonRpc2Server server;
+      bool threw = false;
+      try { rpc::RegisterNodeMethods(server, chain, "archive"); } catch (const std::invalid_argument&) { threw = true; }
+      ASSERT_TRUE(threw, "Unknown node types should be rejected");
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -0,0 +1,295 @@
+/**
+ * @file   serialize_test.hpp
+ * @author JoaoAJMatos
+ *
+ * @brief Serialization unit tests
+ *
+ * @version 0.1
+ * @date 2023-11-12
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+
+/* Skynet Includes */
+#include <serialize.hpp>
+#include <block.hpp>
+#include <block_view.hpp>
+#include <transaction.hpp>
+
+/* C++ Includes */
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* Local Includes */
+#include "unipp.hpp"
+
+
+/** Returns true if f throws a SerializationError */
+template<typename F>
+static bool ThrowsSerializationError(F&& f) {
+      try {
+            f();
+      } catch (const serialize::SerializationError&) {
+            return true;
+      }
+      return false;
+}
+
+/** A transaction with every field set to something recognizable */
+static skynet::Transaction MakeTestTransaction(byte seed) {
+      byte prev[crypto::hashing::SHA256_HASH_SIZE];
+      crypto::ecdsa::PublicKey sender, recipient;
+      crypto::ecdsa::Signature signature;
+      memset(prev, seed, sizeof(prev));
+      memset(sender, seed + 1, sizeof(sender));
+      memset(recipient, seed + 2, sizeof(recipient));
+      memset(signature, seed + 3, sizeof(signature));
+
+      skynet::Transaction transaction(
+            skynet::TransactionInput(prev, seed, sender, signature, -1),
+            skynet::TransactionOutput(1000 + seed, recipient)
+      );
+      transaction.SetLocktime(0x0102030405060708);
+      return transaction;
+}
+
+
+/**
+ * Checks the fixed width little endian integers and the CompactSize
+ * encoding at every boundary.
+ */
+void SerializeIntegersTest() {
+      serialize::WriteBuffer buffer;
+      serialize::Serialize(buffer, uint32_t(0x01020304));
+      serialize::Serialize(buffer, int16_t(-2));
+      serialize::Serialize(buffer, uint64_t(0x0102030405060708));
+
+      const byte expected[] = { 0x04, 0x03, 0x02, 0x01, 0xfe, 0xff, 0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01 };
+      ASSERT_EQUAL(buffer.Size(), sizeof(expected), "Integers should be written fixed width");
+      ASSERT_TRUE(memcmp(buffer.Data(), expected, sizeof(expected)) == 0, "Integers should be written little endian");
+
+      serialize::ReadBuffer reader(buffer.Data(), buffer.Size());
+      uint32_t a; int16_t b; uint64_t c;
+      serialize::Unserialize(reader, a);
+      serialize::Unserialize(reader, b);
+      serialize::Unserialize(reader, c);
+      ASSERT_TRUE(a == 0x01020304 && b == -2 && c == 0x0102030405060708, "Integer round trip failed");
+      ASSERT_TRUE(reader.Empty(), "Reader should be exhausted");
+      ASSERT_TRUE(ThrowsSerializationError([&]() { serialize::Unserialize(reader, a); }), "Reading past the end should throw");
+
+      const uint64_t values[] = { 0, 0xfc, 0xfd, 0xffff, 0x10000, 0xffffffff, 0x100000000 };
+      const std::size_t sizes[] = { 1, 1, 3, 3, 5, 5, 9 };
+      for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+            buffer.Clear();
+            serialize::WriteCompactSize(buffer, values[i]);
+            ASSERT_EQUAL(buffer.Size(), sizes[i], "Wrong CompactSize length for " + std::to_string(values[i]));
+
+            serialize::ReadBuffer compact(buffer.Data(), buffer.Size());
+            ASSERT_TRUE(serialize::ReadCompactSize(compact, UINT64_MAX) == values[i], "CompactSize round trip failed for " + std::to_string(values[i]));
+      }
+
+      const byte non_canonical[] = { 0xfd, 0xfc, 0x00 };
+      serialize::ReadBuffer bad(non_canonical, sizeof(non_canonical));
+      ASSERT_TRUE(ThrowsSerializationError([&]() { serialize::ReadCompactSize(bad); }), "Non canonical CompactSize should be rejected");
+
+      const byte too_large[] = { 0xfe, 0x00, 0x00, 0x00, 0x10 };
+      serialize::ReadBuffer large(too_large, sizeof(too_large));
+      ASSERT_TRUE(ThrowsSerializationError([&]() { serialize::ReadCompactSize(large); }), "CompactSize above MAX_SIZE should be rejected");
+}
+
+/**
+ * Checks byte vectors, strings and hashes, and that a bogus length
+ * can't read past the end of the data.
+ */
+void SerializeContainersTest() {
+      const std::vector<byte> bytes = { 1, 2, 3, 4, 5 };
+      const std::string text = "skynet";
+      Hash256 hash;
+      for (std::size_t i = 0; i < hash.size(); i++) hash[i] = static_cast<byte>(i);
+
+      serialize::WriteBuffer buffer;
+      serialize::Serialize(buffer, bytes);
+      serialize::Serialize(buffer, text);
+      serialize::Serialize(buffer, hash);
+      ASSERT_EQUAL(buffer.Size(), std::size_t(1 + 5 + 1 + 6 + 32), "Containers should be prefixed with their length");
+      ASSERT_EQUAL(serialize::GetSerializedSize(bytes), std::size_t(6), "GetSerializedSize should count the prefix");
+
+      serialize::ReadBuffer reader(buffer.Bytes());
+      std::vector<byte> bytes_copy;
+      std::string text_copy;
+      Hash256 hash_copy;
+      serialize::Unserialize(reader, bytes_copy);
+      serialize::Unserialize(reader, text_copy);
+      serialize::Unserialize(reader, hash_copy);
+      ASSERT_TRUE(bytes_copy == bytes && text_copy == text && hash_copy == hash, "Container round trip failed");
+
+      const byte truncated[] = { 0x10, 0x01, 0x02 };
+      serialize::ReadBuffer short_reader(truncated, sizeof(truncated));
+      ASSERT_TRUE(ThrowsSerializationError([&]() { serialize::Unserialize(short_reader, bytes_copy); }), "Truncated vector should be rejected");
+}
+
+/**
+ * Checks the transaction and block round trips, and that the hashes
+ * survive them.
+ */
+void SerializeBlockTest() {
+      const skynet::Transaction transaction = MakeTestTransaction(7);
+      ASSERT_EQUAL(serialize::GetSerializedSize(transaction), std::size_t(194), "Unexpected transaction size");
+
+      serialize::WriteBuffer buffer;
+      serialize::Serialize(buffer, transaction);
+
+      serialize::ReadBuffer reader(buffer.Data(), buffer.Size());
+      skynet::Transaction transaction_copy;
+      serialize::Unserialize(reader, transaction_copy);
+      ASSERT_TRUE(transaction_copy.Hash() == transaction.Hash(), "Transaction round trip changed the hash");
+      ASSERT_TRUE(transaction_copy.GetLocktime() == transaction.GetLocktime(), "Locktime should survive the round trip");
+
+      std::vector<skynet::Transaction> transactions = { MakeTestTransaction(1), MakeTestTransaction(2), MakeTestTransaction(3) };
+      skynet::Block block(skynet::BlockHeader(1, Hash256{}, skynet::CalculateMerkleRoot(transactions), 1700000000, 4, 42), transactions);
+
+      buffer.Clear();
+      serialize::Serialize(buffer, block);
+      ASSERT_EQUAL(buffer.Size(), skynet::BlockHeader::SERIALIZED_SIZE + 1 + 3 * 194, "Unexpected block size");
+
+      serialize::ReadBuffer block_reader(buffer.Data(), buffer.Size());
+      skynet::Block block_copy;
+      serialize::Unserialize(block_reader, block_copy);
+      ASSERT_TRUE(block_copy == block, "Block round trip changed the hash");
+      ASSERT_EQUAL(block_copy.GetTransactionCount(), 3, "Block round trip lost transactions");
+      ASSERT_TRUE(block_copy.GetTransactions()[2] == transactions[2], "Block round trip changed a transaction");
+
+      serialize::ReadBuffer truncated(buffer.Data(), buffer.Size() - 1);
+      ASSERT_TRUE(ThrowsSerializationError([&]() { serialize::Unserialize(truncated, block_copy); }), "Truncated block should be rejected");
+}
+
+/** Hashes the serialization of a transaction, bypassing its cached TXID */
+static skynet::TransactionHash UncachedHash(const skynet::Transaction& transaction) {
+      skynet::TransactionHash hash;
+      serialize::HashWriter writer;
+      serialize::Serialize(writer, transaction);
+      writer.Final(hash.data());
+      return hash;
+}
+
+/**
+ * Checks that the cached TXID follows every change to the transaction:
+ * setters, signing and deserializing over an existing object, and that
+ * copies keep a correct hash.
+ */
+void SerializeTransactionHashTest() {
+      skynet::Transaction transaction = MakeTestTransaction(7);
+      const skynet::TransactionHash original = transaction.Hash();
+      ASSERT_TRUE(original == UncachedHash(transaction), "The TXID should be the hash of the serialization");
+
+      transaction.SetLocktime(42);
+      ASSERT_TRUE(transaction.Hash() != original, "Changing the locktime should change the TXID");
+      ASSERT_TRUE(transaction.Hash() == UncachedHash(transaction), "The TXID should follow the locktime");
+
+      const skynet::Transaction copy(transaction);
+      skynet::Transaction assigned;
+      assigned.Hash();
+      assigned = transaction;
+      ASSERT_TRUE(copy.Hash() == UncachedHash(transaction) && assigned.Hash() == UncachedHash(transaction), "Copies should keep a correct TXID");
+
+      crypto::ecdsa::Context context = secp256k1_context_create(SECP256K1_CONTEXT_NONE);
+      crypto::ecdsa::KeyPair key;
+      crypto::ecdsa::generate_key_pair(context, &key);
+      const skynet::TransactionHash unsigned_hash = transaction.Hash();
+      transaction.Sign(context, &key);
+      ASSERT_TRUE(transaction.Hash() != unsigned_hash, "Signing should change the TXID");
+      ASSERT_TRUE(transaction.Hash() == UncachedHash(transaction), "The TXID should follow the signature");
+      ASSERT_TRUE(copy.Hash() == unsigned_hash, "Signing should leave copies alone");
+      ASSERT_TRUE(transaction.HasValidSignature(), "A signed transaction should verify");
+
+      /** The signature starts after version (4), timestamp (8), previous output (32 + 4) and sender (33) */
+      serialize::WriteBuffer blank;
+      serialize::Serialize(blank, transaction);
+      std::vector<byte> blank_bytes = blank.Bytes();
+      memset(blank_bytes.data() + 81, 0, 64);
+      skynet::TransactionHash blank_hash;
+      crypto::hashing::SHA256 blank_context;
+      blank_context.Update(blank_bytes.data(), blank_bytes.size());
+      blank_context.Final(blank_hash.data());
+      ASSERT_TRUE(transaction.SignatureHash() == blank_hash, "The signature hash should cover the serialization with a blank signature");
+      secp256k1_context_destroy(context);
+
+      serialize::WriteBuffer buffer;
+      serialize::Serialize(buffer, transaction);
+      skynet::Transaction reused = MakeTestTransaction(9);
+      const skynet::TransactionHash stale = reused.Hash();
+      serialize::ReadBuffer reader(buffer.Data(), buffer.Size());
+      serialize::Unserialize(reader, reused);
+      ASSERT_TRUE(reused.Hash() != stale, "Deserializing over a transaction should drop its TXID");
+      ASSERT_TRUE(reused.Hash() == transaction.Hash(), "Deserializing over a transaction should give it the new TXID");
+}
+
+/**
+ * Checks that the views read the same fields and hashes as the
+ * deserialized objects, without deserializing.
+ */
+void SerializeViewTest() {
+      std::vector<skynet::Transaction> transactions = { MakeTestTransaction(1), MakeTestTransaction(2), MakeTestTransaction(3) };
+      skynet::Block block(skynet::BlockHeader(1, Hash256{}, skynet::CalculateMerkleRoot(transactions), 1700000000, 4, 42), transactions);
+      ASSERT_EQUAL(serialize::GetSerializedSize(transactions[0]), skynet::TransactionView::SERIALIZED_SIZE, "TransactionView size out of sync with the serializer");
+
+      serialize::WriteBuffer buffer;
+      serialize::Serialize(buffer, block);
+
+      const skynet::BlockView view(buffer.Data(), buffer.Size());
+      ASSERT_TRUE(view.Header() == block.GetHeader(), "View header should match the block header");
+      ASSERT_TRUE(view.Hash() == block.Hash(), "View hash should match the block hash");
+      ASSERT_EQUAL(view.TransactionCount(), std::size_t(3), "View should see every transaction");
+
+      for (std::size_t i = 0; i < transactions.size(); i++) {
+            const skynet::TransactionView transaction = view.GetTransaction(i);
+            const skynet::TransactionInput input = transactions[i].GetInput();
+            const skynet::TransactionOutput output = transactions[i].GetOutput();
+
+            ASSERT_TRUE(transaction.Hash() == transactions[i].Hash(), "View TXID should match the transaction hash");
+            ASSERT_TRUE(transaction.Version() == transactions[i].GetVersion(), "Version mismatch");
+            ASSERT_TRUE(transaction.Locktime() == transactions[i].GetLocktime(), "Locktime mismatch");
+            ASSERT_TRUE(memcmp(transaction.PrevTransactionOutput(), input.prevTransactionOutput.data(), 32) == 0, "Previous output mismatch");
+            ASSERT_EQUAL(transaction.PrevTransactionOutputIndex(), input.prevTransactionOutputIndex, "Previous output index mismatch");
+            ASSERT_EQUAL(transaction.Sequence(), input.sequence, "Sequence mismatch");
+            ASSERT_TRUE(memcmp(transaction.Signature(), input.signature, sizeof(input.signature)) == 0, "Signature mismatch");
+            ASSERT_EQUAL(transaction.Value(), output.value, "Value mismatch");
+            ASSERT_TRUE(memcmp(transaction.Recipient(), output.recipient, sizeof(output.recipient)) == 0, "Recipient mismatch");
+            ASSERT_TRUE(transaction.ToTransaction() == transactions[i], "Materialized transaction mismatch");
+      }
+
+      bool threw = false;
+      try { view.GetTransaction(3); } catch (const std::out_of_range&) { threw = true; }
+      ASSERT_TRUE(threw, "Reading past the last transaction should throw");
+      ASSERT_TRUE(view.ToBlock() == block, "Materialized block mismatch");
+
+      std::vector<byte> padded = buffer.Bytes();
+      padded.push_back(0);
+      ASSERT_TRUE(ThrowsSerializationError([&]() { skynet::BlockView(padded.data(), padded.size()); }), "Trailing bytes should be rejected");
+      ASSERT_TRUE(ThrowsSerializationError([&]() { skynet::BlockView(buffer.Data(), buffer.Size() - 1); }), "Truncated block should be rejected");
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
@@ -14,11 +14,39 @@
 
 /* Skynet Includes */
 #include <crypto/sha256.hpp>
+#include <threading/threadpool.hpp>
+
+/* C++ Includes */
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
 
 /* Local Includes */
 #include "unipp.hpp"
 
 
+/** Every SHA-256 backend, the ones the CPU does not support are skipped by the tests */
+static const crypto::hashing::Backend SHA256_BACKENDS[] = {
+      crypto::hashing::Backend::GENERIC,
+      crypto::hashing::Backend::SHA_NI,
+      crypto::hashing::Backend::SSE4,
+      crypto::hashing::Backend::AVX2,
+};
+
+/** Converts a digest to its hex representation */
+static std::string DigestToHex(const byte *hash) {
+      static const char* digits = "0123456789abcdef";
+      std::string hex;
+      for (int i = 0; i < crypto::hashing::SHA256_HASH_SIZE; i++) {
+            hex += digits[hash[i] >> 4];
+            hex += digits[hash[i] & 0x0f];
+      }
+      return hex;
+}
+
+
 /**
  * This file tests the SHA-256 interface.
  *
@@ -37,6 +65,173 @@ void HashTest() {
       ASSERT_FALSE(crypto::hashing::SHA256::CompareHash(hash1, hash2), "Hashes should be different!");
 }
 
+/**
+ * Feeds a message to the streaming interface in chunks of every size.
+ *
+ * The digest must match the one-shot hash no matter how the input is split,
+ * and a copied context must carry on independently of the original.
+ */
+void HashStreamingTest() {
+      std::vector<byte> message(300);
+      for (size_t i = 0; i < message.size(); i++) message[i] = static_cast<byte>(i);
+
+      byte expected[crypto::hashing::SHA256_HASH_SIZE];
+      byte hash[crypto::hashing::SHA256_HASH_SIZE];
+      crypto::hashing::SHA256(message.data(), message.size(), expected);
+
+      for (size_t chunk = 1; chunk <= message.size(); chunk++) {
+            crypto::hashing::SHA256 context;
+            for (size_t offset = 0; offset < message.size(); offset += chunk) {
+                  context.Update(message.data() + offset, std::min(chunk, message.size() - offset));
+            }
+            context.Final(hash);
+            ASSERT_TRUE(crypto::hashing::SHA256::CompareHash(hash, expected), "Streaming digest mismatch with chunks of " + std::to_string(chunk) + " bytes");
+      }
+
+      crypto::hashing::SHA256 prefix;
+      prefix.Update(message.data(), 100);
+      crypto::hashing::SHA256 copy = prefix;
+      copy.Update(message.data() + 100, message.size() - 100).Final(hash);
+      ASSERT_TRUE(crypto::hashing::SHA256::CompareHash(hash, expected), "Copied context produced the wrong digest");
+
+      prefix.Update(message.data() + 100, message.size() - 100).Final(hash);
+      ASSERT_TRUE(crypto::hashing::SHA256::CompareHash(hash, expected), "Original context was affected by its copy");
+}
+
+/**
+ * Hashes messages through a midstate, changing the trailing bytes each time.
+ *
+ * Covers an 80 byte block header with a 4 byte nonce (one final block) and
+ * layouts whose tail spills into a second final block.
+ */
+void HashMidstateTest() {
+      const std::pair<size_t, size_t> layouts[] = { { 80, 4 }, { 64, 4 }, { 60, 8 }, { 119, 40 }, { 200, 50 } };
+      byte expected[crypto::hashing::SHA256_HASH_SIZE];
+      byte hash[crypto::hashing::SHA256_HASH_SIZE];
+
+      for (const auto& [len, variable] : layouts) {
+            std::vector<byte> message(len);
+            for (size_t i = 0; i < len; i++) message[i] = static_cast<byte>(i * 7);
+
+            crypto::hashing::SHA256Midstate midstate(message.data(), len, variable);
+            for (int round = 0; round < 4; round++) {
+                  for (size_t i = len - variable; i < len; i++) message[i] = static_cast<byte>(round * 13 + i);
+                  const byte* tail = message.data() + len - variable;
+
+                  crypto::hashing::SHA256(message.data(), len, expected);
+                  midstate.Hash(tail, hash);
+                  ASSERT_TRUE(crypto::hashing::SHA256::CompareHash(hash, expected), "Midstate hash mismatch for a " + std::to_string(len) + " byte message");
+
+                  crypto::hashing::SHA256(expected, crypto::hashing::SHA256_HASH_SIZE, expected);
+                  midstate.DoubleHash(tail, hash);
+                  ASSERT_TRUE(crypto::hashing::SHA256::CompareHash(hash, expected), "Midstate double hash mismatch for a " + std::to_string(len) + " byte message");
+
+                  crypto::hashing::DoubleSHA256(message.data(), len, hash);
+                  ASSERT_TRUE(crypto::hashing::SHA256::CompareHash(hash, expected), "Double hash mismatch for a " + std::to_string(len) + " byte message");
+            }
+      }
+}
+
+/**
+ * Hashes files from disk, one at a time and in parallel on a thread pool.
+ *
+ * The file digests must match the digests of the same bytes hashed in memory.
+ */
+void HashFileTest() {
+      const std::vector<std::string> filenames = { "sha256_file_test_0.bin", "sha256_file_test_1.bin", "sha256_file_test_2.bin" };
+      const size_t sizes[] = { 0, 1000, 3 * 1024 * 1024 + 17 };
+      std::vector<byte> expected(filenames.size() * crypto::hashing::SHA256_HASH_SIZE);
+
+      for (size_t i = 0; i < filenames.size(); i++) {
+            std::vector<byte> content(sizes[i]);
+            for (size_t j = 0; j < content.size(); j++) content[j] = static_cast<byte>(j * 131 + i);
+
+            std::ofstream file(filenames[i], std::ios::binary);
+            file.write(reinterpret_cast<const char*>(content.data()), content.size());
+            file.close();
+
+            crypto::hashing::SHA256(content.data(), content.size(), expected.data() + i * crypto::hashing::SHA256_HASH_SIZE);
+      }
+
+      byte hash[crypto::hashing::SHA256_HASH_SIZE];
+      for (size_t i = 0; i < filenames.size(); i++) {
+            crypto::hashing::SHA256(filenames[i], hash);
+            ASSERT_TRUE(crypto::hashing::SHA256::CompareHash(hash, expected.data() + i * crypto::hashing::SHA256_HASH_SIZE), "Wrong digest for " + filenames[i]);
+      }
+
+      threading::ThreadPool pool(2);
+      pool.Init();
+      std::vector<byte> hashes(filenames.size() * crypto::hashing::SHA256_HASH_SIZE);
+      crypto::hashing::SHA256::HashFiles(filenames, pool, hashes.data());
+      pool.Stop(true);
+      ASSERT_TRUE(hashes == expected, "Parallel file digests do not match");
+
+      for (const auto& filename : filenames) std::remove(filename.c_str());
+}
+
+/**
+ * Hashes the FIPS 180-2 test vectors with every backend the CPU supports.
+ *
+ * All backends must produce the reference digests, this catches bugs in the
+ * hardware accelerated kernels that a simple "hashes differ" test would miss.
+ */
+void HashBackendTest() {
+      const std::vector<std::pair<std::string, std::string>> vectors = {
+            { "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+            { "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+            { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+            { std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+      };
+      const crypto::hashing::Backend detected = crypto::hashing::GetBackend();
+      byte hash[crypto::hashing::SHA256_HASH_SIZE];
+
+      for (auto backend : SHA256_BACKENDS) {
+            if (!crypto::hashing::SetBackend(backend)) continue;
+
+            for (const auto& [message, digest] : vectors) {
+                  crypto::hashing::SHA256(reinterpret_cast<const byte*>(message.data()), message.size(), hash);
+                  ASSERT_EQUAL(DigestToHex(hash), digest, "Wrong digest with the " + crypto::hashing::BackendToString(backend) + " backend");
+            }
+      }
+
+      crypto::hashing::SetBackend(detected);
+}
+
+/**
+ * Hashes batches of equal length messages with every supported backend.
+ *
+ * The lengths cover the padding edge cases (tail fits in one block or spills
+ * into a second one) and the counts leave leftovers for the 8 and 4 lane kernels.
+ */
+void HashManyTest() {
+      const size_t lengths[] = { 0, 32, 55, 56, 64, 100, 200 };
+      const size_t counts[] = { 1, 3, 4, 9, 17 };
+      const crypto::hashing::Backend detected = crypto::hashing::GetBackend();
+
+      for (auto backend : SHA256_BACKENDS) {
+            if (!crypto::hashing::SetBackend(backend)) continue;
+
+            for (size_t len : lengths) {
+                  for (size_t count : counts) {
+                        std::vector<byte> messages(len * count);
+                        for (size_t i = 0; i < messages.size(); i++) messages[i] = static_cast<byte>(i * 31 + len);
+
+                        std::vector<byte> digests(count * crypto::hashing::SHA256_HASH_SIZE);
+                        crypto::hashing::SHA256::HashMany(messages.data(), len, count, digests.data());
+
+                        for (size_t i = 0; i < count; i++) {
+                              byte expected[crypto::hashing::SHA256_HASH_SIZE];
+                              crypto::hashing::SHA256(messages.data() + i * len, len, expected);
+                              ASSERT_TRUE(crypto::hashing::SHA256::CompareHash(expected, digests.data() + i * crypto::hashing::SHA256_HASH_SIZE),
+                                          "Batch digest mismatch with the " + crypto::hashing::BackendToString(backend) + " backend");
+                        }
+                  }
+            }
+      }
+
+      crypto::hashing::SetBackend(detected);
+}
+
 // MIT License
 // 
 // Copyright (c) 2023 João Matos
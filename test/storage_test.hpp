@@ -0,0 +1,261 @@
+/**
+ * @file   storage_test.hpp
+ * @author JoaoAJMatos
+ *
+ * @brief Block storage unit tests
+ *
+ * @version 0.1
+ * @date 2023-11-14
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+
+/* Skynet Includes */
+#include <block.hpp>
+#include <storage/block_store.hpp>
+#include <storage/block_file_reader.hpp>
+#include <coins.hpp>
+#include <serialize.hpp>
+
+/* C++ Includes */
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* Local Includes */
+#include "unipp.hpp"
+
+
+/** Returns an empty directory for a storage test */
+static std::string MakeStoreDirectory(const std::string& name) {
+      const auto path = std::filesystem::temp_directory_path() / ("skynet_" + name);
+      std::filesystem::remove_all(path);
+      return path.string();
+}
+
+
+/**
+ * Checks writing, reading back and reopening a store, with the block
+ * files rotating and a torn index record at the end of the log.
+ */
+void BlockStoreTest() {
+      const std::string directory = MakeStoreDirectory("block_store_test");
+      const std::vector<skynet::Block> chain = MakeTestChain(5);
+
+      {
+            /** Blocks with a coinbase take 8 + 81 + 1 + 194 bytes, two fit in a file */
+            storage::BlockStore store(directory, 600);
+            store.Open();
+            ASSERT_NULL(store.GetTip(), "A new store should be empty");
+
+            for (std::size_t i = 0; i < chain.size(); i++) {
+                  const storage::BlockIndexEntry& entry = store.WriteBlock(chain[i], static_cast<uint32_t>(i));
+                  ASSERT_EQUAL(entry.location.file, static_cast<uint32_t>(i / 2), "Block files should rotate");
+            }
+            store.Flush();
+
+            ASSERT_TRUE(store.GetTip()->hash == chain.back().Hash(), "The last block should be the tip");
+            ASSERT_TRUE(store.ReadBlock(*store.Lookup(chain[2].Hash())) == chain[2], "Stored block should read back");
+      }
+
+      /** Simulate a crash in the middle of an index write */
+      const auto index_path = std::filesystem::path(directory) / "index.dat";
+      const auto index_size = std::filesystem::file_size(index_path);
+      ASSERT_EQUAL(index_size, std::uintmax_t(5 * storage::BlockIndexEntry::SERIALIZED_SIZE), "Every block should have an index record");
+      std::filesystem::resize_file(index_path, index_size - 10);
+
+      storage::BlockStore store(directory, 600);
+      store.Open();
+      ASSERT_EQUAL(store.Size(), std::size_t(4), "The torn record should be dropped");
+      ASSERT_TRUE(store.GetTip()->hash == chain[3].Hash(), "The tip should be the last complete record");
+      ASSERT_NULL(store.Lookup(chain[4].Hash()), "The torn block should not be indexed");
+
+      for (std::size_t i = 0; i < 4; i++) {
+            const storage::BlockIndexEntry *entry = store.Lookup(chain[i].Hash());
+            ASSERT_NOT_NULL(entry, "Reopened store should index every block");
+            ASSERT_EQUAL(entry->height, static_cast<uint32_t>(i), "Height should survive reopening");
+            ASSERT_TRUE(store.ReadBlock(*entry) == chain[i], "Block should read back after reopening");
+      }
+
+      /** Appending after the repair, and leaving the main chain */
+      store.WriteBlock(chain[4], 4);
+      store.SetStatus(chain[4].Hash(), storage::BLOCK_HAVE_DATA);
+      ASSERT_TRUE(store.GetTip()->hash == chain[3].Hash(), "A block leaving the main chain should give up the tip");
+      ASSERT_TRUE(store.ReadBlock(*store.Lookup(chain[4].Hash())) == chain[4], "Blocks should read back after the repair");
+
+      std::filesystem::remove_all(directory);
+}
+
+/**
+ * Checks reading blocks in place from mapped block files: mappings are
+ * reused and evicted, views outlive their eviction, a growing file is
+ * mapped again, and offsets past 4 GB work.
+ */
+void BlockFileReaderTest() {
+      const std::string directory = MakeStoreDirectory("block_file_reader_test");
+      const std::vector<skynet::Block> chain = MakeTestChain(4);
+
+      /** Three blocks fit in a file */
+      storage::BlockStore store(directory, 900);
+      store.Open();
+      store.WriteBlock(chain[0], 0);
+      store.WriteBlock(chain[1], 1);
+
+      storage::BlockFileReader reader([&](uint32_t file) { return store.BlockFilePath(file); }, 1);
+      const storage::MappedBlock first = reader.Read(store.Lookup(chain[0].Hash())->location, storage::AccessPattern::RANDOM);
+      ASSERT_TRUE(first.view.Hash() == chain[0].Hash(), "Mapped block should match the stored block");
+
+      /** The first file grows past its mapping, then a read of the second file evicts it */
+      store.WriteBlock(chain[2], 2);
+      store.WriteBlock(chain[3], 3);
+      const storage::MappedBlock second = reader.Read(store.Lookup(chain[1].Hash())->location, storage::AccessPattern::SEQUENTIAL);
+      const storage::MappedBlock third = reader.Read(store.Lookup(chain[2].Hash())->location, storage::AccessPattern::SEQUENTIAL);
+      const storage::MappedBlock fourth = reader.Read(store.Lookup(chain[3].Hash())->location, storage::AccessPattern::SEQUENTIAL);
+      ASSERT_EQUAL(fourth.view.Data() - fourth.file->Data(), std::ptrdiff_t(storage::BLOCK_RECORD_HEADER_SIZE), "The fourth block should start the second file");
+      ASSERT_TRUE(second.view.Hash() == chain[1].Hash(), "Reused mapping should serve the second block");
+      ASSERT_TRUE(third.view.Hash() == chain[2].Hash(), "A file that grew should be mapped again");
+      ASSERT_TRUE(fourth.view.Hash() == chain[3].Hash(), "Blocks of the second file should be mapped");
+      ASSERT_TRUE(first.view.ToBlock() == chain[0], "Views should outlive the eviction of their mapping");
+      ASSERT_TRUE(store.ReadBlock(*store.Lookup(chain[2].Hash())) == chain[2], "Store reads should go through the mappings");
+
+      /** A sparse file with a block past the 4 GB mark */
+      serialize::WriteBuffer buffer;
+      serialize::Serialize(buffer, chain[1]);
+      const uint64_t offset = (uint64_t(1) << 32) + 4096;
+      byte prefix[storage::BLOCK_RECORD_HEADER_SIZE];
+      serialize::WriteLE32(prefix, storage::BLOCK_FILE_MAGIC);
+      serialize::WriteLE32(prefix + 4, static_cast<uint32_t>(buffer.Size()));
+      {
+            std::ofstream large(store.BlockFilePath(7), std::ios::binary);
+            large.seekp(static_cast<std::streamoff>(offset - sizeof(prefix)));
+            large.write(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+            large.write(reinterpret_cast<const char*>(buffer.Data()), static_cast<std::streamsize>(buffer.Size()));
+      }
+
+      storage::BlockFileLocation location;
+      location.file = 7;
+      location.offset = offset;
+      location.size = static_cast<uint32_t>(buffer.Size());
+      ASSERT_TRUE(reader.Read(location, storage::AccessPattern::RANDOM).view.Hash() == chain[1].Hash(), "Blocks past 4 GB should be readable");
+
+      location.offset -= 1;
+      bool threw = false;
+      try { reader.Read(location, storage::AccessPattern::RANDOM); } catch (const storage::StorageException&) { threw = true; }
+      ASSERT_TRUE(threw, "A location that misses the record should be rejected");
+
+      std::filesystem::remove_all(directory);
+}
+
+/**
+ * Checks pruning block files: their blocks stay indexed without their
+ * data, the disk usage goes down and survives reopening, and the file
+ * being appended to can't be pruned.
+ */
+void BlockStorePruneTest() {
+      const std::string directory = MakeStoreDirectory("block_store_prune_test");
+      const std::vector<skynet::Block> chain = MakeTestChain(5);
+
+      storage::BlockStore store(directory, 600);
+      store.Open();
+      for (std::size_t i = 0; i < chain.size(); i++) {
+            store.WriteBlock(chain[i], static_cast<uint32_t>(i));
+            store.WriteUndo(chain[i].Hash(), skynet::BlockUndo{});
+      }
+
+      const uint64_t usage = store.GetDiskUsage();
+      ASSERT_EQUAL(store.GetFileInfo().size(), std::size_t(3), "Every block file should be tracked");
+      ASSERT_TRUE(store.GetFileInfo()[1].blocks == 2 && store.GetFileInfo()[1].maxHeight == 3, "Block files should know what they hold");
+
+      const uint64_t freed = store.PruneFile(0);
+      ASSERT_TRUE(!std::filesystem::exists(store.BlockFilePath(0)) && !std::filesystem::exists(store.UndoFilePath(0)), "Pruned files should be deleted");
+      ASSERT_EQUAL(store.GetDiskUsage(), usage - freed, "Pruning should lower the disk usage");
+
+      const storage::BlockIndexEntry *pruned = store.Lookup(chain[1].Hash());
+      ASSERT_NOT_NULL(pruned, "Pruned blocks should stay indexed");
+      ASSERT_EQUAL(pruned->status, uint8_t(storage::BLOCK_MAIN_CHAIN), "Pruned blocks should lose their data flags");
+      ASSERT_TRUE(store.ReadBlock(*store.Lookup(chain[2].Hash())) == chain[2], "Blocks of other files should still read back");
+
+      bool threw = false;
+      try { store.PruneFile(2); } catch (const storage::StorageException&) { threw = true; }
+      ASSERT_TRUE(threw, "The file being appended to should not be pruned");
+
+      store.Flush();
+      storage::BlockStore reopened(directory, 600);
+      reopened.Open();
+      ASSERT_EQUAL(reopened.GetDiskUsage(), usage - freed, "The disk usage should survive reopening");
+      ASSERT_EQUAL(reopened.GetFileInfo()[0].blocks, uint32_t(0), "Pruned files should stay empty after reopening");
+      ASSERT_TRUE(!(reopened.Lookup(chain[0].Hash())->status & storage::BLOCK_HAVE_DATA), "Pruned blocks should stay pruned after reopening");
+      ASSERT_EQUAL(reopened.GetTip()->height, uint32_t(4), "Pruning should leave the tip alone");
+
+      std::filesystem::remove_all(directory);
+}
+
+/**
+ * Checks that status changes don't grow the index log without bound: it
+ * is compacted as superseded records pile up, and down to one record per
+ * block when the store is reopened, keeping the latest statuses.
+ */
+void BlockStoreIndexCompactionTest() {
+      const std::string directory = MakeStoreDirectory("block_store_index_compaction_test");
+      const std::vector<skynet::Block> chain = MakeTestChain(5);
+      const auto index_path = std::filesystem::path(directory) / "index.dat";
+      const uint64_t live_size = chain.size() * storage::BlockIndexEntry::SERIALIZED_SIZE;
+
+      {
+            storage::BlockStore store(directory, 600);
+            store.Open();
+            for (std::size_t i = 0; i < chain.size(); i++) store.WriteBlock(chain[i], static_cast<uint32_t>(i));
+
+            /** Flip the upper blocks in and out of the main chain, like repeated reorganizations */
+            for (int round = 0; round < 200; round++) {
+                  const uint8_t status = storage::BLOCK_HAVE_DATA | (round % 2 ? storage::BLOCK_MAIN_CHAIN : 0);
+                  store.SetStatus({ { chain[3].Hash(), status }, { chain[4].Hash(), status } });
+            }
+
+            store.Flush();
+            ASSERT_LESS_EQUAL(std::filesystem::file_size(index_path), 2 * live_size + storage::BlockIndexEntry::SERIALIZED_SIZE, "Superseded records should be compacted away as they pile up");
+            ASSERT_EQUAL(store.GetTip()->height, uint32_t(4), "Compacting should leave the tip alone");
+
+            store.SetStatus({ { chain[4].Hash(), storage::BLOCK_HAVE_DATA }, { chain[3].Hash(), storage::BLOCK_HAVE_DATA } });
+            store.Flush();
+      }
+
+      storage::BlockStore reopened(directory, 600);
+      reopened.Open();
+      ASSERT_EQUAL(uint64_t(std::filesystem::file_size(index_path)), live_size, "Reopening should leave one record per block");
+      ASSERT_FALSE(std::filesystem::exists(index_path.string() + ".tmp"), "Compacting should not leave its temporary file behind");
+      ASSERT_EQUAL(reopened.Size(), chain.size(), "Compacting should keep every block");
+      ASSERT_EQUAL(reopened.Lookup(chain[4].Hash())->status, uint8_t(storage::BLOCK_HAVE_DATA), "Compacting should keep the latest status");
+      ASSERT_EQUAL(reopened.GetTip()->height, uint32_t(2), "The tip should survive compacting");
+      ASSERT_TRUE(reopened.ReadBlock(*reopened.Lookup(chain[3].Hash())) == chain[3], "Blocks should still read back after compacting");
+
+      reopened.WriteHeader(MakeTestHeader(), 3);
+      reopened.Flush();
+      ASSERT_EQUAL(uint64_t(std::filesystem::file_size(index_path)), live_size + storage::BlockIndexEntry::SERIALIZED_SIZE, "The compacted log should be appended to");
+
+      std::filesystem::remove_all(directory);
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
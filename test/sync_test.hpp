@@ -0,0 +1,186 @@
+/**
+ * @file   sync_test.hpp
+ * @author JoaoAJMatos
+ *
+ * @brief Initial block download unit tests
+ *
+ * @version 0.1
+ * @date 2023-11-21
+ * @license MIT
+ * @copyright Copyright (c) 2023
+ */
+
+
+/* Skynet Includes */
+#include <block.hpp>
+#include <blockchain.hpp>
+#include <sync.hpp>
+
+/* C++ Includes */
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+/* Local Includes */
+#include "unipp.hpp"
+
+
+/** A peer serving its chain from memory, that can be told to misbehave (a repeating peer ignores the locator) */
+class MockSyncPeer : public skynet::SyncPeer
+{
+public:
+      enum class Behaviour { GOOD, FAILING, WRONG_BLOCKS, REPEATING };
+
+      MockSyncPeer(std::vector<skynet::Block> chain, Behaviour behaviour = Behaviour::GOOD)
+            : chain(std::move(chain)), behaviour(behaviour) {}
+
+      std::vector<skynet::BlockHeader> GetHeaders(const std::vector<Hash256>& locator, std::size_t max) override {
+            if (behaviour == Behaviour::FAILING) throw std::runtime_error("Timed out");
+
+            std::size_t start = 0;
+            for (const Hash256& hash : locator) {
+                  if (behaviour == Behaviour::REPEATING) break;
+                  const auto known = std::find_if(chain.begin(), chain.end(), [&](const skynet::Block& block) { return block.Hash() == hash; });
+                  if (known != chain.end()) {
+                        start = static_cast<std::size_t>(known - chain.begin()) + 1;
+                        break;
+                  }
+            }
+
+            std::vector<skynet::BlockHeader> headers;
+            for (std::size_t i = start; i < chain.size() && headers.size() < max; i++) headers.push_back(chain[i].GetHeader());
+            return headers;
+      }
+
+      std::vector<skynet::Block> GetBlocks(const std::vector<Hash256>& hashes) override {
+            if (behaviour == Behaviour::FAILING) throw std::runtime_error("Timed out");
+
+            std::vector<skynet::Block> blocks;
+            for (const Hash256& hash : hashes) {
+                  const auto found = std::find_if(chain.begin(), chain.end(), [&](const skynet::Block& block) { return block.Hash() == hash; });
+                  blocks.push_back(behaviour == Behaviour::WRONG_BLOCKS ? chain.front() : *found);
+            }
+            return blocks;
+      }
+
+private:
+      std::vector<skynet::Block> chain;
+      Behaviour behaviour;
+};
+
+
+/**
+ * Checks syncing a chain that has the first blocks of a longer one from
+ * several peers, one timing out and one sending the wrong blocks, with a
+ * window much smaller than the chain.
+ */
+void BlockSyncTest() {
+      const std::vector<skynet::Block> remote = MakeTestChain(60);
+
+      skynet::Chain chain;
+      for (std::size_t i = 0; i < 5; i++) chain.AddBlock(remote[i]);
+
+      const std::vector<Hash256> locator = chain.GetLocator();
+      ASSERT_EQUAL(locator.size(), std::size_t(5), "Short chains should be fully in the locator");
+      ASSERT_TRUE(locator.front() == remote[4].Hash() && locator.back() == remote[0].Hash(), "The locator should go from the tip to the genesis block");
+
+      std::vector<std::shared_ptr<skynet::SyncPeer>> peers{
+            std::make_shared<MockSyncPeer>(remote, MockSyncPeer::Behaviour::FAILING),
+            std::make_shared<MockSyncPeer>(remote, MockSyncPeer::Behaviour::WRONG_BLOCKS),
+            std::make_shared<MockSyncPeer>(remote)
+      };
+
+      chain.SetAssumeValid(remote[30].Hash());
+      skynet::BlockSync sync(chain, peers, 8, 3);
+      const skynet::SyncProgress progress = sync.Run();
+
+      ASSERT_EQUAL(chain.Size(), remote.size(), "Every block of the peers' chain should be connected");
+      ASSERT_TRUE(chain.GetLastBlock() == remote.back(), "The chain should end at the peers' tip");
+      ASSERT_EQUAL(progress.headerHeight, uint32_t(59), "The whole header chain should be downloaded");
+      ASSERT_EQUAL(progress.blockHeight, uint32_t(59), "The sync should end at the tip");
+      ASSERT_EQUAL(progress.blocksDownloaded, std::size_t(55), "Only the missing blocks should be downloaded");
+      ASSERT_TRUE(progress.failedRequests >= 3, "The misbehaving peers' requests should fail");
+      ASSERT_EQUAL(progress.assumedValidBlocks, std::size_t(26), "Blocks up to the assume-valid block should skip their signature checks");
+
+      const std::vector<Hash256> sparse = chain.GetLocator();
+      ASSERT_TRUE(sparse.size() < 20 && sparse.front() == remote.back().Hash() && sparse.back() == remote.front().Hash(), "Long chains should get a sparse locator");
+
+      /** Nothing left to download */
+      ASSERT_EQUAL(skynet::BlockSync(chain, peers).Run().blocksDownloaded, std::size_t(0), "A synced chain should not download anything");
+}
+
+/**
+ * Checks that header chains with less work, bad proof of work or blocks
+ * the chain rejects end the sync with an error instead of a bad chain,
+ * and that a peer repeating headers the chain knows can't stall it.
+ */
+void BlockSyncRejectTest() {
+      const std::vector<skynet::Block> remote = MakeTestChain(10);
+
+      skynet::Chain chain;
+      for (const skynet::Block& block : remote) chain.AddBlock(block);
+
+      /** A shorter branch is not worth downloading */
+      const std::vector<skynet::Block> shorter = MakeTestChain(8, remote, 100);
+      auto peer = std::make_shared<MockSyncPeer>(MakeTestChain(9, shorter, 100));
+      ASSERT_EQUAL(skynet::BlockSync(chain, { peer }).Run().blocksDownloaded, std::size_t(0), "Branches with less work should be ignored");
+
+      /** A header that doesn't meet its target */
+      std::vector<skynet::Block> forged = MakeTestChain(20, remote, 200);
+      skynet::BlockHeader header = forged[15].GetHeader();
+      header.difficultyTarget = 24;
+      forged[15] = skynet::Block(header, forged[15].GetTransactions());
+
+      bool threw = false;
+      try { skynet::BlockSync(chain, { std::make_shared<MockSyncPeer>(forged) }).Run(); } catch (const skynet::SyncException&) { threw = true; }
+      ASSERT_TRUE(threw, "Header chains with bad proof of work should be rejected");
+      ASSERT_TRUE(chain.GetLastBlock() == remote.back(), "No block of a bad header chain should be downloaded");
+
+      /** A block spending a coin that doesn't exist */
+      std::vector<skynet::Block> invalid = MakeTestChain(12, remote, 300);
+      skynet::TransactionInput input;
+      input.prevTransactionOutput[0] = 1;
+      crypto::ecdsa::PublicKey recipient{};
+      std::vector<skynet::Transaction> transactions{ skynet::Transaction(input, skynet::TransactionOutput(1, recipient)) };
+      skynet::BlockHeader spending(1, invalid.back().Hash(), skynet::CalculateMerkleRoot(transactions), 1700000000, 1, 0);
+      while (!skynet::MeetsDifficultyTarget(spending.Hash(), 1)) spending.nonce++;
+      invalid.emplace_back(spending, transactions);
+
+      threw = false;
+      try { skynet::BlockSync(chain, { std::make_shared<MockSyncPeer>(invalid) }).Run(); } catch (const skynet::SyncException&) { threw = true; }
+      ASSERT_TRUE(threw, "Blocks the chain rejects should end the sync");
+      ASSERT_TRUE(chain.GetLastBlock() == invalid[11], "The valid blocks before the invalid one should stay connected");
+
+      /** A full batch of known headers, whatever the locator */
+      const std::vector<skynet::Block> repeated = MakeTestChain(skynet::MAX_HEADERS_PER_REQUEST);
+      skynet::Chain synced;
+      for (const skynet::Block& block : repeated) synced.AddBlock(block);
+
+      threw = false;
+      try { skynet::BlockSync(synced, { std::make_shared<MockSyncPeer>(repeated, MockSyncPeer::Behaviour::REPEATING) }).Run(); } catch (const skynet::SyncException&) { threw = true; }
+      ASSERT_TRUE(threw, "Peers repeating known headers should end the sync");
+      ASSERT_EQUAL(skynet::BlockSync(synced, { std::make_shared<MockSyncPeer>(repeated) }).Run().blocksDownloaded, std::size_t(0), "A full batch of known headers that moves on should be fine");
+}
+
+// MIT License
+//
+// Copyright (c) 2023 João Matos
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.